@@ -18,6 +18,108 @@ extern const uint64_t p751p1[NWORDS_FIELD];
 extern const uint64_t p751x2[NWORDS_FIELD]; 
 
 
+#if (OS_TARGET == OS_LINUX)
+#include <cpuid.h>
+
+static void mul751_select(const felm_t a, const felm_t b, dfelm_t c);
+static void rdc751_select(const dfelm_t ma, dfelm_t mc);
+static void fp2mul751_select(const f2elm_t a, const f2elm_t b, f2elm_t c);
+static void fp2sqr751_select(const f2elm_t a, f2elm_t c);
+
+// Multiplication and reduction kernels, resolved by select_fp_kernels() at initialization or on first use
+static void (*mul751_kernel)(const felm_t a, const felm_t b, dfelm_t c) = mul751_select;
+static void (*rdc751_kernel)(const dfelm_t ma, dfelm_t mc) = rdc751_select;
+static void (*fp2mul751_kernel)(const f2elm_t a, const f2elm_t b, f2elm_t c) = fp2mul751_select;
+static void (*fp2sqr751_kernel)(const f2elm_t a, f2elm_t c) = fp2sqr751_select;
+
+
+bool select_fp_kernels(void)
+{ // Selects the MULX/ADCX/ADOX kernels if the processor supports BMI2 and ADX, and the MUL/ADC kernels otherwise.
+  // Compiling with MULX=TRUE (_MULX_) or MULX=FALSE (_NO_MULX_) forces either choice.
+    bool mulx;
+
+#if defined(_MULX_)
+    mulx = true;
+#elif defined(_NO_MULX_)
+    mulx = false;
+#else
+    unsigned int eax, ebx, ecx, edx;
+
+    mulx = __get_cpuid_count(7, 0, &eax, &ebx, &ecx, &edx) && (ebx & bit_BMI2) && (ebx & bit_ADX);
+#endif
+
+    mul751_kernel = mulx ? mul751_mulx_asm : mul751_asm;
+    rdc751_kernel = mulx ? rdc751_mulx_asm : rdc751_asm;
+    fp2mul751_kernel = mulx ? fp2mul751_mulx_asm : fp2mul751_asm;
+    fp2sqr751_kernel = mulx ? fp2sqr751_mulx_asm : fp2sqr751_asm;
+    return mulx;
+}
+
+
+#if defined(X64_IFMA_LANES)
+bool fp_x8_supported(void)
+{ // The 8-lane arithmetic needs AVX-512F and AVX-512 IFMA, and an operating system that saves the ZMM registers (XCR0 bits 1, 2 and 5 to 7)
+    unsigned int eax, ebx, ecx, edx, xcr0;
+
+    if (!__get_cpuid(1, &eax, &ebx, &ecx, &edx) || !(ecx & bit_OSXSAVE)) {
+        return false;
+    }
+    __asm__ ("xgetbv" : "=a" (xcr0), "=d" (edx) : "c" (0));
+    if ((xcr0 & 0xE6) != 0xE6) {
+        return false;
+    }
+    return __get_cpuid_count(7, 0, &eax, &ebx, &ecx, &edx) && (ebx & bit_AVX512F) && (ebx & bit_AVX512IFMA);
+}
+#endif
+
+
+static void mul751_select(const felm_t a, const felm_t b, dfelm_t c)
+{
+    select_fp_kernels();
+    mul751_kernel(a, b, c);
+}
+
+
+static void rdc751_select(const dfelm_t ma, dfelm_t mc)
+{
+    select_fp_kernels();
+    rdc751_kernel(ma, mc);
+}
+
+
+static void fp2mul751_select(const f2elm_t a, const f2elm_t b, f2elm_t c)
+{
+    select_fp_kernels();
+    fp2mul751_kernel(a, b, c);
+}
+
+
+static void fp2sqr751_select(const f2elm_t a, f2elm_t c)
+{
+    select_fp_kernels();
+    fp2sqr751_kernel(a, c);
+}
+
+
+void fp2sqr751_mont(const f2elm_t a, f2elm_t c)
+{ // GF(p751^2) squaring using Montgomery arithmetic, c = a^2 in GF(p751^2).
+  // Inputs: a = a0+a1*i, where a0, a1 are in [0, 2*p751-1]
+  // Output: c = c0+c1*i, where c0, c1 are in [0, 2*p751-1]
+
+    fp2sqr751_kernel(a, c);
+}
+
+
+void fp2mul751_mont(const f2elm_t a, const f2elm_t b, f2elm_t c)
+{ // GF(p751^2) multiplication using Montgomery arithmetic, c = a*b in GF(p751^2).
+  // Inputs: a = a0+a1*i and b = b0+b1*i, where a0, a1, b0, b1 are in [0, 2*p751-1]
+  // Output: c = c0+c1*i, where c0, c1 are in [0, 2*p751-1]
+
+    fp2mul751_kernel(a, b, c);
+}
+#endif
+
+
 __inline void fpadd751(const digit_t* a, const digit_t* b, digit_t* c)
 { // Modular addition, c = a+b mod p751.
   // Inputs: a, b in [0, 2*p751-1] 
@@ -532,7 +634,23 @@ void mp_mul(const digit_t* a, const digit_t* b, digit_t* c, const unsigned int n
 
 #elif (OS_TARGET == OS_LINUX)
     
-    mul751_asm(a, b, c);
+    mul751_kernel(a, b, c);
+
+#endif
+}
+
+
+void mp_sqr(const digit_t* a, digit_t* c, const unsigned int nwords)
+{ // Multiprecision squaring, c = a^2, where lng(a) = nwords.
+  // Cross products a[i]*a[j], i != j, are computed once and doubled.
+
+#if (OS_TARGET == OS_WIN)
+    mp_mul(a, a, c, nwords);
+
+#elif (OS_TARGET == OS_LINUX)
+
+    UNREFERENCED_PARAMETER(nwords);
+    sqr751_asm(a, c);
 
 #endif
 }
@@ -860,7 +978,7 @@ void rdc_mont(const dfelm_t ma, felm_t mc)
     
 #elif (OS_TARGET == OS_LINUX)                 
     
-    rdc751_asm(ma, mc);    
+    rdc751_kernel(ma, mc);    
 
 #endif
 }
\ No newline at end of file
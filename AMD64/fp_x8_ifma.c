@@ -0,0 +1,557 @@
+/********************************************************************************************
+* SIDH: an efficient supersingular isogeny-based cryptography library for ephemeral
+*       Diffie-Hellman key exchange.
+*
+*    Copyright (c) Microsoft Corporation. All rights reserved.
+*
+*
+* Abstract: 8-lane modular arithmetic and isogeny formulas using AVX-512 IFMA
+*
+*********************************************************************************************/
+
+#include "../SIDH_internal.h"
+
+#if defined(X64_IFMA_LANES)
+#include <immintrin.h>
+
+// Elements are kept in radix 2^52: limb i of the 8 lanes shares one vector, so that every instruction works on 8 independent
+// elements. Montgomery arithmetic uses R' = 2^780 instead of the R = 2^768 of the scalar code, and every limb of an input to
+// a multiplication must be below 2^52 (vpmadd52 ignores the upper 12 bits). Values are kept in [0, 2*p751-1] as in the scalar code.
+
+#define MASK52    0xFFFFFFFFFFFFFULL
+
+typedef __m512i vfelm_t[NLIMBS_LANES];
+
+// 2*p751 in radix 2^52
+static const uint64_t p751x2_52[NLIMBS_LANES] = { 0xFFFFFFFFFFFFE, 0xFFFFFFFFFFFFF, 0xFFFFFFFFFFFFF, 0xFFFFFFFFFFFFF, 0xFFFFFFFFFFFFF, 0xFFFFFFFFFFFFF, 0xFFFFFFFFFFFFF,
+                                                  0x93F0F151DD5FF, 0xF98EDC7D92D0A, 0xEDB52B363427E, 0x09D30CFADD7D0, 0x6A08B964AE901, 0xF2F75B8CD0AC5, 0x83EE381C25213, 0x0000000DFCBAA };
+// p751 in radix 2^52
+static const uint64_t p751_52[NLIMBS_LANES] = { 0xFFFFFFFFFFFFF, 0xFFFFFFFFFFFFF, 0xFFFFFFFFFFFFF, 0xFFFFFFFFFFFFF, 0xFFFFFFFFFFFFF, 0xFFFFFFFFFFFFF, 0xFFFFFFFFFFFFF,
+                                                0x49F878A8EEAFF, 0x7CC76E3EC9685, 0x76DA959B1A13F, 0x84E9867D6EBE8, 0xB5045CB257480, 0xF97BADC668562, 0x41F71C0E12909, 0x00000006FE5D5 };
+// p751+1 in radix 2^52, its 7 lowest limbs are zero
+static const uint64_t p751p1_52[NLIMBS_LANES] = { 0, 0, 0, 0, 0, 0, 0,
+                                                  0x49F878A8EEB00, 0x7CC76E3EC9685, 0x76DA959B1A13F, 0x84E9867D6EBE8, 0xB5045CB257480, 0xF97BADC668562, 0x41F71C0E12909, 0x00000006FE5D5 };
+// 2^792 mod p751, a Montgomery multiplication by it takes a*2^768 to a*2^780
+static const uint64_t to_lanes_52[NLIMBS_LANES] = { 0x00249AD67C3FF, 0, 0, 0, 0, 0, 0,
+                                                    0xE822291A2EB00, 0xC397715452356, 0x82A796EA41E7E, 0xC83FB3EDF886E, 0x19B40AAC77043, 0xDC309584457DC, 0xD7CA701397670, 0x000000067FAC9 };
+// 2^768 mod p751, a Montgomery multiplication by it takes a*2^780 back to a*2^768
+static const uint64_t from_lanes_52[NLIMBS_LANES] = { 0x00000000249AD, 0, 0, 0, 0, 0, 0,
+                                                      0x375C6C6683100, 0xF24D05527B1E4, 0x2E697797BF3F4, 0x89DB7B2AC5C4E, 0xB439D2076956C, 0xC7512C7E94CA4, 0xBCE5E210F7926, 0x00000002D5B24 };
+
+#define P751P1_ZERO_LIMBS    7
+
+
+static __inline void vload(const felm_x8_t a, vfelm_t va)
+{
+    unsigned int i;
+
+    for (i = 0; i < NLIMBS_LANES; i++) {
+        va[i] = _mm512_loadu_si512((const void*)a[i]);
+    }
+}
+
+
+static __inline void vstore(const vfelm_t va, felm_x8_t a)
+{
+    unsigned int i;
+
+    for (i = 0; i < NLIMBS_LANES; i++) {
+        _mm512_storeu_si512((void*)a[i], va[i]);
+    }
+}
+
+
+static __inline void vconst(const uint64_t* k, vfelm_t va)
+{ // Broadcasts a constant in radix 2^52 to the 8 lanes
+    unsigned int i;
+
+    for (i = 0; i < NLIMBS_LANES; i++) {
+        va[i] = _mm512_set1_epi64((long long)k[i]);
+    }
+}
+
+
+static __inline void vcarry(vfelm_t a)
+{ // Carry propagation of non-negative limbs, limbs 0 to 13 end up below 2^52
+    const __m512i mask = _mm512_set1_epi64(MASK52);
+    unsigned int i;
+
+    for (i = 0; i < NLIMBS_LANES-1; i++) {
+        a[i+1] = _mm512_add_epi64(a[i+1], _mm512_srli_epi64(a[i], 52));
+        a[i] = _mm512_and_si512(a[i], mask);
+    }
+}
+
+
+static __inline void vcarry_signed(vfelm_t a)
+{ // Carry propagation of signed limbs, limbs 0 to 13 end up in [0, 2^52-1] and the sign is left in limb 14
+    const __m512i mask = _mm512_set1_epi64(MASK52);
+    unsigned int i;
+
+    for (i = 0; i < NLIMBS_LANES-1; i++) {
+        a[i+1] = _mm512_add_epi64(a[i+1], _mm512_srai_epi64(a[i], 52));
+        a[i] = _mm512_and_si512(a[i], mask);
+    }
+}
+
+
+static __inline void vcorrect(vfelm_t a)
+{ // Adds 2*p751 to the lanes holding a negative value after vcarry_signed()
+    __m512i mask = _mm512_srai_epi64(a[NLIMBS_LANES-1], 63);
+    unsigned int i;
+
+    for (i = 0; i < NLIMBS_LANES; i++) {
+        a[i] = _mm512_add_epi64(a[i], _mm512_and_si512(mask, _mm512_set1_epi64((long long)p751x2_52[i])));
+    }
+    vcarry(a);
+}
+
+
+static __inline void vadd(const vfelm_t a, const vfelm_t b, vfelm_t c)
+{ // Modular addition, c = a+b mod p751, inputs and output in [0, 2*p751-1]
+    unsigned int i;
+
+    for (i = 0; i < NLIMBS_LANES; i++) {
+        c[i] = _mm512_sub_epi64(_mm512_add_epi64(a[i], b[i]), _mm512_set1_epi64((long long)p751x2_52[i]));
+    }
+    vcarry_signed(c);
+    vcorrect(c);
+}
+
+
+static __inline void vsub(const vfelm_t a, const vfelm_t b, vfelm_t c)
+{ // Modular subtraction, c = a-b mod p751, inputs and output in [0, 2*p751-1]
+    unsigned int i;
+
+    for (i = 0; i < NLIMBS_LANES; i++) {
+        c[i] = _mm512_sub_epi64(a[i], b[i]);
+    }
+    vcarry_signed(c);
+    vcorrect(c);
+}
+
+
+static __inline void vadd_lazy(const vfelm_t a, const vfelm_t b, vfelm_t c)
+{ // Addition without reduction, c = a+b, used for inputs to multiplications
+    unsigned int i;
+
+    for (i = 0; i < NLIMBS_LANES; i++) {
+        c[i] = _mm512_add_epi64(a[i], b[i]);
+    }
+    vcarry(c);
+}
+
+
+static __inline void vredc(__m512i* z, vfelm_t c)
+{ // Montgomery reduction, c = z*2^-780 mod p751 for the 30 accumulated limbs of z.
+  // Since p751 = -1 mod 2^52, the quotient limb is the current limb of z itself, and p751 = (p751+1)-1 turns the
+  // addition of q*p751 into a carry and 8 multiply-adds by the upper limbs of p751+1.
+    const __m512i mask = _mm512_set1_epi64(MASK52);
+    __m512i q, p[NLIMBS_LANES];
+    unsigned int i, j;
+
+    for (j = P751P1_ZERO_LIMBS; j < NLIMBS_LANES; j++) {
+        p[j] = _mm512_set1_epi64((long long)p751p1_52[j]);
+    }
+
+    for (i = 0; i < NLIMBS_LANES; i++) {
+        z[i+1] = _mm512_add_epi64(z[i+1], _mm512_srli_epi64(z[i], 52));
+        q = _mm512_and_si512(z[i], mask);
+        for (j = P751P1_ZERO_LIMBS; j < NLIMBS_LANES; j++) {
+            z[i+j] = _mm512_madd52lo_epu64(z[i+j], q, p[j]);
+            z[i+j+1] = _mm512_madd52hi_epu64(z[i+j+1], q, p[j]);
+        }
+    }
+
+    for (i = 0; i < NLIMBS_LANES; i++) {
+        c[i] = z[NLIMBS_LANES+i];
+    }
+    vcarry(c);
+}
+
+
+static __inline void vmul(const vfelm_t a, const vfelm_t b, vfelm_t c)
+{ // Montgomery multiplication, c = a*b*2^-780 mod p751. The output is in [0, 2*p751-1] whenever a*b < 2^780*p751,
+  // which leaves room for inputs up to 2^14*p751.
+    __m512i z[2*NLIMBS_LANES];
+    unsigned int i, j;
+
+    for (i = 0; i < 2*NLIMBS_LANES; i++) {
+        z[i] = _mm512_setzero_si512();
+    }
+    for (i = 0; i < NLIMBS_LANES; i++) {
+        for (j = 0; j < NLIMBS_LANES; j++) {
+            z[i+j] = _mm512_madd52lo_epu64(z[i+j], a[i], b[j]);
+            z[i+j+1] = _mm512_madd52hi_epu64(z[i+j+1], a[i], b[j]);
+        }
+    }
+    vredc(z, c);
+}
+
+
+static __inline void vsqr(const vfelm_t a, vfelm_t c)
+{ // Montgomery squaring, c = a^2*2^-780 mod p751, the cross products are computed once and doubled
+    __m512i z[2*NLIMBS_LANES];
+    unsigned int i, j;
+
+    for (i = 0; i < 2*NLIMBS_LANES; i++) {
+        z[i] = _mm512_setzero_si512();
+    }
+    for (i = 0; i < NLIMBS_LANES; i++) {
+        for (j = i+1; j < NLIMBS_LANES; j++) {
+            z[i+j] = _mm512_madd52lo_epu64(z[i+j], a[i], a[j]);
+            z[i+j+1] = _mm512_madd52hi_epu64(z[i+j+1], a[i], a[j]);
+        }
+    }
+    for (i = 0; i < 2*NLIMBS_LANES; i++) {
+        z[i] = _mm512_add_epi64(z[i], z[i]);
+    }
+    for (i = 0; i < NLIMBS_LANES; i++) {
+        z[2*i] = _mm512_madd52lo_epu64(z[2*i], a[i], a[i]);
+        z[2*i+1] = _mm512_madd52hi_epu64(z[2*i+1], a[i], a[i]);
+    }
+    vredc(z, c);
+}
+
+
+static void to_radix52(const digit_t* a, uint64_t* r)
+{ // Splits a 751-bit value into 15 limbs of 52 bits
+    unsigned int i, bit, w, s;
+
+    for (i = 0; i < NLIMBS_LANES; i++) {
+        bit = 52*i; w = bit/RADIX; s = bit%RADIX;
+        r[i] = a[w] >> s;
+        if (s > RADIX-52 && w+1 < NWORDS_FIELD) {
+            r[i] |= a[w+1] << (RADIX-s);
+        }
+        r[i] &= MASK52;
+    }
+}
+
+
+static void from_radix52(const uint64_t* r, digit_t* a)
+{ // Joins 15 limbs of 52 bits holding a value below 2^768
+    unsigned int i, bit, w, s;
+
+    for (i = 0; i < NWORDS_FIELD; i++) {
+        a[i] = 0;
+    }
+    for (i = 0; i < NLIMBS_LANES; i++) {
+        bit = 52*i; w = bit/RADIX; s = bit%RADIX;
+        a[w] |= r[i] << s;
+        if (s > RADIX-52 && w+1 < NWORDS_FIELD) {
+            a[w+1] |= r[i] >> (RADIX-s);
+        }
+    }
+}
+
+
+/************ 8-lane GF(p) and GF(p^2) arithmetic *************/
+
+void fpadd751_x8(const felm_x8_t a, const felm_x8_t b, felm_x8_t c)
+{ // Modular addition in every lane, c = a+b mod p751.
+  // Inputs: a, b in [0, 2*p751-1]
+  // Output: c in [0, 2*p751-1]
+    vfelm_t va, vb;
+
+    vload(a, va); vload(b, vb);
+    vadd(va, vb, va);
+    vstore(va, c);
+}
+
+
+void fpsub751_x8(const felm_x8_t a, const felm_x8_t b, felm_x8_t c)
+{ // Modular subtraction in every lane, c = a-b mod p751.
+  // Inputs: a, b in [0, 2*p751-1]
+  // Output: c in [0, 2*p751-1]
+    vfelm_t va, vb;
+
+    vload(a, va); vload(b, vb);
+    vsub(va, vb, va);
+    vstore(va, c);
+}
+
+
+void fpmul751_mont_x8(const felm_x8_t ma, const felm_x8_t mb, felm_x8_t mc)
+{ // Montgomery multiplication in every lane, mc = ma*mb*R'^-1 mod p751, where R'=2^780.
+  // Inputs: ma, mb in [0, 2*p751-1]
+  // Output: mc in [0, 2*p751-1]
+    vfelm_t va, vb;
+
+    vload(ma, va); vload(mb, vb);
+    vmul(va, vb, va);
+    vstore(va, mc);
+}
+
+
+void fpsqr751_mont_x8(const felm_x8_t ma, felm_x8_t mc)
+{ // Montgomery squaring in every lane, mc = ma^2*R'^-1 mod p751, where R'=2^780.
+  // Input:  ma in [0, 2*p751-1]
+  // Output: mc in [0, 2*p751-1]
+    vfelm_t va;
+
+    vload(ma, va);
+    vsqr(va, va);
+    vstore(va, mc);
+}
+
+
+void fp2add751_x8(const f2elm_x8_t a, const f2elm_x8_t b, f2elm_x8_t c)
+{ // GF(p751^2) addition in every lane, c = a+b in GF(p751^2)
+
+    fpadd751_x8(a[0], b[0], c[0]);
+    fpadd751_x8(a[1], b[1], c[1]);
+}
+
+
+void fp2sub751_x8(const f2elm_x8_t a, const f2elm_x8_t b, f2elm_x8_t c)
+{ // GF(p751^2) subtraction in every lane, c = a-b in GF(p751^2)
+
+    fpsub751_x8(a[0], b[0], c[0]);
+    fpsub751_x8(a[1], b[1], c[1]);
+}
+
+
+void fp2mul751_mont_x8(const f2elm_x8_t a, const f2elm_x8_t b, f2elm_x8_t c)
+{ // GF(p751^2) multiplication in every lane, c = a*b in GF(p751^2).
+  // Inputs: a = a0+a1*i and b = b0+b1*i, where a0, a1, b0, b1 are in [0, 2*p751-1]
+  // Output: c = c0+c1*i, where c0, c1 are in [0, 2*p751-1]
+    vfelm_t a0, a1, b0, b1, t0, t1, t2;
+
+    vload(a[0], a0); vload(a[1], a1);
+    vload(b[0], b0); vload(b[1], b1);
+    vadd_lazy(a0, a1, t0);                           // t0 = a0+a1, below 4*p751
+    vadd_lazy(b0, b1, t1);                           // t1 = b0+b1, below 4*p751
+    vmul(t0, t1, t2);                                // t2 = (a0+a1)*(b0+b1)
+    vmul(a0, b0, t0);                                // t0 = a0*b0
+    vmul(a1, b1, t1);                                // t1 = a1*b1
+    vsub(t0, t1, a0);                                // c0 = a0*b0 - a1*b1
+    vsub(t2, t0, t2);
+    vsub(t2, t1, a1);                                // c1 = (a0+a1)*(b0+b1) - a0*b0 - a1*b1
+    vstore(a0, c[0]);
+    vstore(a1, c[1]);
+}
+
+
+void fp2sqr751_mont_x8(const f2elm_x8_t a, f2elm_x8_t c)
+{ // GF(p751^2) squaring in every lane, c = a^2 in GF(p751^2).
+  // Inputs: a = a0+a1*i, where a0, a1 are in [0, 2*p751-1]
+  // Output: c = c0+c1*i, where c0, c1 are in [0, 2*p751-1]
+    vfelm_t a0, a1, t0, t1;
+    unsigned int i;
+
+    vload(a[0], a0); vload(a[1], a1);
+    vadd_lazy(a0, a1, t0);                           // t0 = a0+a1, below 4*p751
+    for (i = 0; i < NLIMBS_LANES; i++) {
+        t1[i] = _mm512_sub_epi64(_mm512_add_epi64(a0[i], _mm512_set1_epi64((long long)p751x2_52[i])), a1[i]);
+    }
+    vcarry_signed(t1);                               // t1 = a0-a1+2*p751, in [1, 4*p751-1]
+    vmul(t0, t1, t0);                                // c0 = (a0+a1)*(a0-a1)
+    vadd_lazy(a0, a0, t1);                           // t1 = 2*a0
+    vmul(t1, a1, t1);                                // c1 = 2*a0*a1
+    vstore(t0, c[0]);
+    vstore(t1, c[1]);
+}
+
+
+void fp2pack751_x8(const f2elm_t* a, f2elm_x8_t c)
+{ // Moves the 8 elements a[0], ..., a[7] (in Montgomery representation) to the lanes of c
+    uint64_t limbs[NLIMBS_LANES];
+    vfelm_t va, vk;
+    unsigned int i, j, k;
+
+    for (i = 0; i < 2; i++) {
+        for (j = 0; j < NLANES; j++) {
+            to_radix52(a[j][i], limbs);
+            for (k = 0; k < NLIMBS_LANES; k++) {
+                c[i][k][j] = limbs[k];
+            }
+        }
+        vload(c[i], va);
+        vconst(to_lanes_52, vk);
+        vmul(va, vk, va);                            // a*2^768 -> a*2^780
+        vstore(va, c[i]);
+    }
+}
+
+
+void fp2unpack751_x8(const f2elm_x8_t a, f2elm_t* c)
+{ // Moves the lanes of a back to 8 elements c[0], ..., c[7] in Montgomery representation, in [0, 2*p751-1]
+    uint64_t limbs[NLIMBS_LANES];
+    felm_x8_t t;
+    vfelm_t va, vk;
+    unsigned int i, j, k;
+
+    for (i = 0; i < 2; i++) {
+        vload(a[i], va);
+        vconst(from_lanes_52, vk);
+        vmul(va, vk, va);                            // a*2^780 -> a*2^768
+        vstore(va, t);
+        for (j = 0; j < NLANES; j++) {
+            for (k = 0; k < NLIMBS_LANES; k++) {
+                limbs[k] = t[k][j];
+            }
+            from_radix52(limbs, c[j][i]);
+        }
+    }
+}
+
+
+unsigned int fp2iszero751_x8(const f2elm_x8_t a)
+{ // Returns a mask with bit j set if lane j of a is zero in GF(p751^2)
+    __mmask8 zero[2], isp[2];
+    __m512i limb;
+    unsigned int i, j;
+
+    for (i = 0; i < 2; i++) {
+        zero[i] = isp[i] = 0xFF;
+        for (j = 0; j < NLIMBS_LANES; j++) {
+            limb = _mm512_loadu_si512((const void*)a[i][j]);
+            zero[i] &= _mm512_cmpeq_epi64_mask(limb, _mm512_setzero_si512());
+            isp[i] &= _mm512_cmpeq_epi64_mask(limb, _mm512_set1_epi64((long long)p751_52[j]));
+        }
+    }
+    return (unsigned int)((zero[0] | isp[0]) & (zero[1] | isp[1]));
+}
+
+
+/************ 8-lane elliptic curve and isogeny functions *************/
+
+void xDBL_x8(const point_proj_x8_t P, point_proj_x8_t Q, const f2elm_x8_t A24, const f2elm_x8_t C24)
+{ // Doubling of a Montgomery point in projective coordinates (X:Z) in every lane, see xDBL().
+    f2elm_x8_t t0, t1;
+
+    fp2sub751_x8(P->X, P->Z, t0);                    // t0 = X1-Z1
+    fp2add751_x8(P->X, P->Z, t1);                    // t1 = X1+Z1
+    fp2sqr751_mont_x8(t0, t0);                       // t0 = (X1-Z1)^2
+    fp2sqr751_mont_x8(t1, t1);                       // t1 = (X1+Z1)^2
+    fp2mul751_mont_x8(C24, t0, Q->Z);                // Z2 = C24*(X1-Z1)^2
+    fp2mul751_mont_x8(t1, Q->Z, Q->X);               // X2 = C24*(X1-Z1)^2*(X1+Z1)^2
+    fp2sub751_x8(t1, t0, t1);                        // t1 = (X1+Z1)^2-(X1-Z1)^2
+    fp2mul751_mont_x8(A24, t1, t0);                  // t0 = A24*[(X1+Z1)^2-(X1-Z1)^2]
+    fp2add751_x8(Q->Z, t0, Q->Z);                    // Z2 = A24*[(X1+Z1)^2-(X1-Z1)^2] + C24*(X1-Z1)^2
+    fp2mul751_mont_x8(Q->Z, t1, Q->Z);               // Z2 = [A24*[(X1+Z1)^2-(X1-Z1)^2] + C24*(X1-Z1)^2]*[(X1+Z1)^2-(X1-Z1)^2]
+}
+
+
+void eval_4_isog_x8(point_proj_x8_t P, f2elm_x8_t* coeff)
+{ // Evaluates the 4-isogeny given by the 5 coefficients in coeff at the point (X:Z) in every lane, see eval_4_isog().
+    f2elm_x8_t t0, t1;
+
+    fp2mul751_mont_x8(P->X, coeff[0], P->X);         // X = coeff[0]*X
+    fp2mul751_mont_x8(P->Z, coeff[1], t0);           // t0 = coeff[1]*Z
+    fp2sub751_x8(P->X, t0, P->X);                    // X = X-t0
+    fp2mul751_mont_x8(P->Z, coeff[2], P->Z);         // Z = coeff[2]*Z
+    fp2sub751_x8(P->X, P->Z, t0);                    // t0 = X-Z
+    fp2mul751_mont_x8(P->Z, P->X, P->Z);             // Z = X*Z
+    fp2sqr751_mont_x8(t0, t0);                       // t0 = t0^2
+    fp2add751_x8(P->Z, P->Z, P->Z);                  // Z = Z+Z
+    fp2add751_x8(P->Z, P->Z, P->Z);                  // Z = Z+Z
+    fp2add751_x8(P->Z, t0, P->X);                    // X = t0+Z
+    fp2mul751_mont_x8(P->Z, t0, P->Z);               // Z = t0*Z
+    fp2mul751_mont_x8(P->Z, coeff[4], P->Z);         // Z = coeff[4]*Z
+    fp2mul751_mont_x8(t0, coeff[4], t0);             // t0 = t0*coeff[4]
+    fp2mul751_mont_x8(P->X, coeff[3], t1);           // t1 = X*coeff[3]
+    fp2sub751_x8(t0, t1, t0);                        // t0 = t0-t1
+    fp2mul751_mont_x8(P->X, t0, P->X);               // X = X*t0
+}
+
+
+void xTPL_x8(const point_proj_x8_t P, point_proj_x8_t Q, const f2elm_x8_t A24, const f2elm_x8_t C24)
+{ // Tripling of a Montgomery point in projective coordinates (X:Z) in every lane, see xTPL().
+    f2elm_x8_t t0, t1, t2, t3, t4, t5;
+
+    fp2sub751_x8(P->X, P->Z, t2);                    // t2 = X-Z
+    fp2add751_x8(P->X, P->Z, t3);                    // t3 = X+Z
+    fp2sqr751_mont_x8(t2, t0);                       // t0 = t2^2
+    fp2sqr751_mont_x8(t3, t1);                       // t1 = t3^2
+    fp2mul751_mont_x8(t0, C24, t4);                  // t4 = C24*t0
+    fp2mul751_mont_x8(t1, t4, t5);                   // t5 = t4*t1
+    fp2sub751_x8(t1, t0, t1);                        // t1 = t1-t0
+    fp2mul751_mont_x8(A24, t1, t0);                  // t0 = A24*t1
+    fp2add751_x8(t4, t0, t4);                        // t4 = t4+t0
+    fp2mul751_mont_x8(t1, t4, t4);                   // t4 = t4*t1
+    fp2add751_x8(t5, t4, t0);                        // t0 = t5+t4
+    fp2sub751_x8(t5, t4, t1);                        // t1 = t5-t4
+    fp2mul751_mont_x8(t0, t2, t0);                   // t0 = t2*t0
+    fp2mul751_mont_x8(t1, t3, t1);                   // t1 = t3*t1
+    fp2sub751_x8(t0, t1, t4);                        // t4 = t0-t1
+    fp2add751_x8(t0, t1, t5);                        // t5 = t0+t1
+    fp2sqr751_mont_x8(t4, t4);                       // t4 = t4^2
+    fp2sqr751_mont_x8(t5, t5);                       // t5 = t5^2
+    fp2mul751_mont_x8(P->X, t4, t4);                 // t4 = X*t4
+    fp2mul751_mont_x8(P->Z, t5, Q->X);               // X3 = Z*t5
+    copy_words((digit_t*)t4, (digit_t*)Q->Z, sizeof(f2elm_x8_t)/sizeof(digit_t));    // Z3 = t4
+}
+
+
+void xTPLe_x8(const point_proj_x8_t P, point_proj_x8_t Q, const f2elm_x8_t A, const f2elm_x8_t C, const int e)
+{ // Computes [3^e](X:Z) in every lane via e repeated triplings, see xTPLe().
+    f2elm_x8_t A24, C24;
+    int i;
+
+    fp2add751_x8(C, C, A24);
+    fp2add751_x8(A24, A24, C24);
+    fp2add751_x8(A24, A, A24);
+    copy_words((digit_t*)P, (digit_t*)Q, sizeof(point_proj_x8)/sizeof(digit_t));
+
+    for (i = 0; i < e; i++) {
+        xTPL_x8(Q, Q, A24, C24);
+    }
+}
+
+
+void xDBLe_x8(const point_proj_x8_t P, point_proj_x8_t Q, const f2elm_x8_t A, const f2elm_x8_t C, const int e)
+{ // Computes [2^e](X:Z) in every lane via e repeated doublings, see xDBLe().
+    f2elm_x8_t A24, C24;
+    int i;
+
+    fp2add751_x8(C, C, A24);
+    fp2add751_x8(A24, A24, C24);
+    fp2add751_x8(A24, A, A24);
+    copy_words((digit_t*)P, (digit_t*)Q, sizeof(point_proj_x8)/sizeof(digit_t));
+
+    for (i = 0; i < e; i++) {
+        xDBL_x8(Q, Q, A24, C24);
+    }
+}
+
+
+void get_3_isog_x8(const point_proj_x8_t P, f2elm_x8_t A, f2elm_x8_t C)
+{ // Computes the 3-isogenous curves A/C of the points (X3:Z3) of order 3 in every lane, see get_3_isog().
+    f2elm_x8_t t0, t1;
+
+    fp2sqr751_mont_x8(P->X, t0);                     // t0 = X^2
+    fp2add751_x8(t0, t0, t1);                        // t1 = 2*t0
+    fp2add751_x8(t0, t1, t0);                        // t0 = t0+t1
+    fp2sqr751_mont_x8(P->Z, t1);                     // t1 = Z^2
+    fp2sqr751_mont_x8(t1, A);                        // A = t1^2
+    fp2add751_x8(t1, t1, t1);                        // t1 = 2*t1
+    fp2add751_x8(t1, t1, C);                         // C = 2*t1
+    fp2sub751_x8(t0, t1, t1);                        // t1 = t0-t1
+    fp2mul751_mont_x8(t0, t1, t1);                   // t1 = t0*t1
+    fp2sub751_x8(A, t1, A);                          // A = A-t1
+    fp2sub751_x8(A, t1, A);                          // A = A-t1
+    fp2sub751_x8(A, t1, A);                          // A = A-t1
+    fp2mul751_mont_x8(P->X, P->Z, t1);               // t1 = X*Z
+    fp2mul751_mont_x8(C, t1, C);                     // C = C*t1
+}
+
+
+void eval_3_isog_x8(const point_proj_x8_t P, point_proj_x8_t Q)
+{ // Evaluates the 3-isogenies with kernels (X3:Z3) at the points (X:Z) in every lane, see eval_3_isog().
+    f2elm_x8_t t0, t1, t2;
+
+    fp2mul751_mont_x8(P->X, Q->X, t0);               // t0 = X3*X
+    fp2mul751_mont_x8(P->Z, Q->X, t1);               // t1 = Z3*X
+    fp2mul751_mont_x8(P->Z, Q->Z, t2);               // t2 = Z3*Z
+    fp2sub751_x8(t0, t2, t0);                        // t0 = X3*X-Z3*Z
+    fp2mul751_mont_x8(P->X, Q->Z, t2);               // t2 = X3*Z
+    fp2sub751_x8(t1, t2, t1);                        // t1 = Z3*X-X3*Z
+    fp2sqr751_mont_x8(t0, t0);                       // t0 = (X3*X-Z3*Z)^2
+    fp2sqr751_mont_x8(t1, t1);                       // t1 = (Z3*X-X3*Z)^2
+    fp2mul751_mont_x8(Q->X, t0, Q->X);               // X = X*(X3*X-Z3*Z)^2
+    fp2mul751_mont_x8(Q->Z, t1, Q->Z);               // Z = Z*(Z3*X-X3*Z)^2
+}
+
+#endif
@@ -92,6 +92,13 @@ void mp_mul(const digit_t* a, const digit_t* b, digit_t* c, const unsigned int n
 }
 
 
+void mp_sqr(const digit_t* a, digit_t* c, const unsigned int nwords)
+{ // Multiprecision squaring, c = a^2, where lng(a) = nwords.
+
+    mp_mul(a, a, c, nwords);
+}
+
+
 
 void rdc_mont(const digit_t* ma, digit_t* mc)
 { // Efficient Montgomery reduction using comba and exploiting the special form of the prime p751.
@@ -31,7 +31,7 @@ extern "C" {
 #include <stddef.h>
 
 #include <pthread.h>
-#include <semaphore.h>
+#include <time.h>
 
 
 // Definition of operating system
@@ -187,6 +187,9 @@ typedef point_basefield_affine point_basefield_t[1];
 typedef struct { felm_t X; felm_t Z; } point_basefield_proj;          // Point representation in projective XZ Montgomery coordinates over the base field.
 typedef point_basefield_proj point_basefield_proj_t[1];
 
+typedef struct { felm_t X; felm_t Y; felm_t Z; } point_basefield_full_proj;  // Point representation in projective XYZ coordinates over the base field.
+typedef point_basefield_full_proj point_basefield_full_proj_t[1];
+
 // Definitions of the error-handling type and error codes
 
 typedef enum {
@@ -202,6 +205,7 @@ typedef enum {
     CRYPTO_ERROR_TOO_MANY_ITERATIONS,        // 0x09
     CRYPTO_ERROR_END_OF_LIST,                // 0x0A
     CRYPTO_ERROR_INVALID_ORDER,              // 0x0B
+    CRYPTO_ERROR_CANCELLED,                  // 0x0C
 } CRYPTO_STATUS;
 
 #define CRYPTO_STATUS_TYPE_SIZE (CRYPTO_ERROR_END_OF_LIST)
@@ -274,6 +278,8 @@ typedef struct
     digit_t*         Border;                                 // Order of Bob's (sub)group
     digit_t*         PA;                                     // Alice's generator PA = (XPA,YPA), where XPA and YPA are defined over GF(p)
     digit_t*         PB;                                     // Bob's generator PB = (XPB,YPB), where XPB and YPB are defined over GF(p)
+    digit_t*         PA_table;                               // Fixed-base table of PA for secret_pt(), filled in by SIDH_curve_initialize()
+    digit_t*         PB_table;                               // Fixed-base table of PB for secret_pt(), filled in by SIDH_curve_initialize()
     unsigned int     BigMont_A24;                            // BigMont's curve parameter A24 = (A+2)/4
     digit_t*         BigMont_order;                          // BigMont's subgroup order
     digit_t*         Montgomery_R2;                          // Montgomery constant (2^W)^2 mod p, using a suitable value W
@@ -290,15 +296,77 @@ extern CurveIsogenyStaticData CurveIsogeny_SIDHp751;
 
 /*************** Data Structure for batch processing ***************/
 
+#define BATCH_GROUP_MAX      4        // Batches that can share one group
+#define BATCH_TIMEOUT_USEC   2000     // Default time an epoch stays open after its first element arrives
+#define BATCH_CHUNK          16       // Elements per task when the inversion of an epoch is shared out
+
+// Threads passing the same batch to the batched functions hand in one element each and wait for its inverse.
+// The elements handed in since the last flush form an epoch, which is inverted at once with Montgomery's trick.
+// An epoch closes when it holds batchSize elements, when every member of the batch's group is waiting in one of
+// the group's batches, or once its first element has waited the group's timeout. Slots are reserved without a lock,
+// the next epoch opens as soon as one closes, and the threads waiting on a closed epoch share out its inversion.
+typedef struct batch_group batch_group;
+
+typedef struct {
+	unsigned long long flushes;              // Epochs inverted
+	unsigned long long elements;             // Elements inverted, over all epochs
+	unsigned long long full;                 // Epochs closed by reaching batchSize
+	unsigned long long idle;                 // Epochs closed because every member of the group was waiting
+	unsigned long long timeouts;             // Epochs closed by the timeout
+	int maxSize;                             // Largest epoch
+} batch_stats;
+
 typedef struct {
-	int batchSize;
-	f2elm_t* invArray;  			//(default thread count of 248)
-	f2elm_t* invDest;					//(default thread count of 248)
-	int cntr;
-	sem_t sign_sem;
-	pthread_mutex_t arrayLock;
+	unsigned int seq;                        // Epoch the buffer holds
+	int written;                             // Elements stored in it so far
+	bool done;                               // Its inverses have been handed back
+	f2elm_t* elems;
+	felm_t** results;                        // Where the inverse of each element goes
+	felm_t* den;                             // Norms a0^2+a1^2 of the elements
+	felm_t* prefix;                          // Running products of den within each chunk
+	felm_t* total;                           // Product of each chunk, then its inverse
+	felm_t* acc;                             // Running products of total
+	int phase;                               // Pass the tasks below belong to
+	int chunk;                               // Elements per task
+	int ntasks;
+	int nextTask;                            // Next chunk to claim
+	int doneTasks;
+	int helpers;                             // Waiting threads running tasks of the buffer, which is not reused until it drops to 0
+} batch_epoch;
+
+typedef struct {
+	int batchSize;                           // Elements that close an epoch, at most capacity
+	int capacity;
+	unsigned long long state;                // Open epoch << 32 | slots reserved in it, BATCH_CLOSED set when closed early
+	batch_epoch buf[2];                      // Open epoch and the previous one, which may still be inverting
+	batch_group* group;
+	bool ownGroup;                           // The group was allocated along with the batch
+	pthread_mutex_t lock;                    // Only taken to sleep, and to change what sleepers wait for
+	pthread_cond_t changed;
+	batch_stats stats;                       // Updated under lock
 } batch_struct;
 
+struct batch_group {
+	pthread_mutex_t lock;                    // Protects the list of batches
+	long timeout;                            // Microseconds an epoch stays open, 0 for no timeout
+	int members;                             // Threads that may still hand in elements, 0 when not tracked (atomic)
+	int waiting;                             // Members waiting in one of the batches (atomic)
+	int nbatches;
+	batch_struct* batches[BATCH_GROUP_MAX];
+};
+
+
+/*************** Data Structure for prepared public keys ***************/
+
+#define PREPARED_LADDER_BITS  372    // Bitlength of Alice's scalars, oAbits of SIDHp751
+
+// Bob's public key converted once for repeated SecretAgreement_Prepared_A calls
+typedef struct {
+	f2elm_t A;                                   // Curve coefficient, Montgomery representation
+	f2elm_t xP, xQ, xPQ;                         // Basis x-coordinates, Montgomery representation
+	f2elm_t LadderQ[PREPARED_LADDER_BITS][2];    // Doublings of Q for the 3-point ladder, see prepare_3_pt_ladder
+} PreparedPublicKey;
+
 
 /******************** Function prototypes ***********************/
 /*************** Setup/initialization functions *****************/
@@ -327,6 +395,24 @@ CRYPTO_STATUS random_BigMont_mod_order(digit_t* random_digits, PCurveIsogenyStru
 // Clear "nwords" digits from memory
 void clear_words(void* mem, digit_t nwords);
 
+// Allocate a batch that inverts up to capacity elements per epoch, with batchSize = capacity. It joins group if one is
+// given, otherwise it gets a group of its own with the default timeout and no member tracking. Returns NULL on error.
+batch_struct* SIDH_batch_allocate(int capacity, batch_group* group);
+
+// Free a batch, which no thread may be waiting in
+void SIDH_batch_free(batch_struct* batch);
+
+// Allocate a group of batches whose epochs stay open at most timeout microseconds (0: until they are full or idle)
+batch_group* SIDH_batch_group_allocate(long timeout);
+
+// Free a group, after its batches
+void SIDH_batch_group_free(batch_group* group);
+
+// Start a run of members threads over the group's batches and clear their statistics. Every member calls
+// SIDH_batch_group_leave once it hands in no more elements, so that the others do not wait for it.
+void SIDH_batch_group_begin(batch_group* group, int members);
+void SIDH_batch_group_leave(batch_group* group);
+
 
 #ifdef __cplusplus
 }
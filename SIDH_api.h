@@ -108,10 +108,16 @@ void PublicKeyBDecompression_A(const unsigned char* SecretKeyA, const unsigned c
 CRYPTO_STATUS EphemeralSecretAgreement_Compression_B(const unsigned char* PrivateKeyB, const unsigned char* point_R, const unsigned char* param_A, unsigned char* SharedSecretB, PCurveIsogenyStruct CurveIsogeny);
 
 // Compression of value psi(S) for isogeny based signatures
-CRYPTO_STATUS compressPsiS(const point_proj* psiS, unsigned char* CompressedPsiS, int* compBit, const f2elm_t A, PCurveIsogenyStruct CurveIsogeny, batch_struct* batch);
+// psi(S) is not checked for full order here, it is expected to come out of SecretAgreement_B, which checks it
+// basisHint receives the torsion basis search counters, one byte that lets decompressPsiS skip the search
+CRYPTO_STATUS compressPsiS(const point_proj* psiS, unsigned char* CompressedPsiS, int* compBit, unsigned char* basisHint, const f2elm_t A, PCurveIsogenyStruct CurveIsogeny, batch_struct* batch);
+
+// Same, with the torsion basis {P, Q} of E[3^239] already generated for A
+CRYPTO_STATUS compressPsiS_basis(const point_proj* psiS, unsigned char* CompressedPsiS, int* compBit, const f2elm_t A, const point_full_proj* P, const point_full_proj* Q, PCurveIsogenyStruct CurveIsogeny, batch_struct* batch);
 
 // Decompression of value psi(S) and calculation of the points degree
-CRYPTO_STATUS decompressPsiS(const unsigned char* CompressedPsiS, point_proj* psiS, int compBit, const f2elm_t A, PCurveIsogenyStruct CurveIsogeny, batch_struct* batch);
+// A basisHint of 0 (or out of range) makes it search for the torsion basis itself
+CRYPTO_STATUS decompressPsiS(const unsigned char* CompressedPsiS, point_proj* psiS, int compBit, unsigned char basisHint, const f2elm_t A, PCurveIsogenyStruct CurveIsogeny, batch_struct* batch);
 
 CRYPTO_STATUS compressPsiS_test(const point_proj* psiS, unsigned char* CompressedPsiS, int* compBit, const f2elm_t A, PCurveIsogenyStruct CurveIsogeny, batch_struct* batch, digit_t* a, digit_t* b);
 
@@ -149,7 +155,17 @@ CRYPTO_STATUS Validate_PKB(unsigned char* pPublicKeyB, bool* valid, PCurveIsogen
 // Output: a shared secret pSharedSecretA that consists of one element in GF(p751^2), i.e., 1502 bits in total.
 // CurveIsogeny must be set up in advance using SIDH_curve_initialize().
 // batch is a struct enabling batched inversion in parallel
-CRYPTO_STATUS SecretAgreement_A(unsigned char* pPrivateKeyA, unsigned char* pPublicKeyB, unsigned char* pSharedSecretA, PCurveIsogenyStruct CurveIsogeny, point_proj_t kerngen, batch_struct* batch);
+// cancel, if not NULL, is polled once per row of the isogeny strategy; once it is non-zero the computation stops
+// with CRYPTO_ERROR_CANCELLED. A cancelled call hands nothing in to batch.
+CRYPTO_STATUS SecretAgreement_A(unsigned char* pPrivateKeyA, unsigned char* pPublicKeyB, unsigned char* pSharedSecretA, PCurveIsogenyStruct CurveIsogeny, point_proj_t kerngen, batch_struct* batch, const int* cancel);
+
+// Conversion of Bob's public key for repeated shared secret generation under it
+// PreparedKeyB holds the key in Montgomery representation and the doublings of its point Q for the 3-point ladder.
+CRYPTO_STATUS PublicKeyPreparation_B(const unsigned char* pPublicKeyB, PreparedPublicKey* PreparedKeyB, PCurveIsogenyStruct CurveIsogeny);
+
+// Alice's shared secret generation against a prepared public key
+// Same result, batch and cancel as SecretAgreement_A with kerngen = NULL.
+CRYPTO_STATUS SecretAgreement_Prepared_A(unsigned char* pPrivateKeyA, const PreparedPublicKey* PreparedKeyB, unsigned char* pSharedSecretA, PCurveIsogenyStruct CurveIsogeny, batch_struct* batch, const int* cancel);
 
 // Bob's shared secret generation
 // It produces a shared secret key pSharedSecretB using his secret key pPrivateKeyB and Alice's public key pPublicKeyA
@@ -158,7 +174,19 @@ CRYPTO_STATUS SecretAgreement_A(unsigned char* pPrivateKeyA, unsigned char* pPub
 // Output: a shared secret pSharedSecretB that consists of one element in GF(p751^2), i.e., 1502 bits in total.
 // CurveIsogeny must be set up in advance using SIDH_curve_initialize().
 // batch is a struct enabling batched inversion in parallel
-CRYPTO_STATUS SecretAgreement_B(unsigned char* pPrivateKeyB, unsigned char* pPublicKeyA, unsigned char* pSharedSecretB, PCurveIsogenyStruct CurveIsogeny, point_proj_t kerngen, point_proj_t extractpoint, batch_struct* batch);
+// cancel is polled as in SecretAgreement_A
+// The kernel generator is checked to have full order 3^239 while the isogeny is computed, CRYPTO_ERROR_INVALID_ORDER otherwise
+CRYPTO_STATUS SecretAgreement_B(unsigned char* pPrivateKeyB, unsigned char* pPublicKeyA, unsigned char* pSharedSecretB, PCurveIsogenyStruct CurveIsogeny, point_proj_t kerngen, point_proj_t extractpoint, batch_struct* batch, const int* cancel);
+
+// Bob's shared secret generation for n independent inputs, the same as n unbatched calls to SecretAgreement_B
+// Input i is pPrivateKeyB[i] (unused when kerngen is given), pPublicKeyA[i] and kerngen[i] if kerngen is not NULL; its kernel generator
+// goes to extractpoint[i] if extractpoint is not NULL, its shared secret to pSharedSecretB[i] and its result to status[i].
+// Returns the first failure, CRYPTO_SUCCESS if every input succeeded.
+// On processors with AVX-512 IFMA the isogeny walks of up to 8 inputs run in lockstep on 8-lane arithmetic.
+CRYPTO_STATUS SecretAgreement_B_lanes(unsigned char** pPrivateKeyB, unsigned char** pPublicKeyA, unsigned char** pSharedSecretB, const unsigned int n, PCurveIsogenyStruct CurveIsogeny, point_proj* kerngen, point_proj* extractpoint, CRYPTO_STATUS* status);
+
+// Number of inputs SecretAgreement_B_lanes runs in lockstep: 8 with AVX-512 IFMA, 1 otherwise
+unsigned int SecretAgreement_B_lanes_width(void);
 
 /*********************** Scalar multiplication API using BigMont ***********************/
 
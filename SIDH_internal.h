@@ -238,6 +238,9 @@ void mp_mul_schoolbook(const digit_t* a, const digit_t* b, digit_t* c, const uns
 // Multiprecision comba multiply, c = a*b, where lng(a) = lng(b) = nwords.
 void mp_mul_comba(const digit_t* a, const digit_t* b, digit_t* c, const unsigned int nwords);
 
+// Multiprecision squaring, c = a^2, where lng(a) = nwords.
+void mp_sqr(const digit_t* a, digit_t* c, const unsigned int nwords);
+
 void multiply(const digit_t* a, const digit_t* b, digit_t* c, const unsigned int nwords);
 
 // Montgomery multiplication modulo the group order, mc = ma*mb*r' mod order, where ma,mb,mc in [0, order-1]
@@ -291,7 +294,30 @@ void rdc_mont(const digit_t* a, digit_t* c);
 // Field multiplication using Montgomery arithmetic, c = a*b*R^-1 mod p751, where R=2^768
 void fpmul751_mont(const felm_t a, const felm_t b, felm_t c);
 void mul751_asm(const felm_t a, const felm_t b, dfelm_t c);
+void sqr751_asm(const felm_t a, dfelm_t c);
 void rdc751_asm(const dfelm_t ma, dfelm_t mc);
+void mul751_mulx_asm(const felm_t a, const felm_t b, dfelm_t c);
+void rdc751_mulx_asm(const dfelm_t ma, dfelm_t mc);
+
+// x64 assembly kernels selected at runtime
+#if (TARGET == TARGET_AMD64) && (OS_TARGET == OS_LINUX) && !defined(GENERIC_IMPLEMENTATION)
+    #define X64_ASM_KERNELS
+#endif
+
+// 8-lane AVX-512 IFMA arithmetic, used when the processor supports it unless compiled with IFMA=FALSE (_NO_IFMA_)
+#if defined(X64_ASM_KERNELS) && !defined(_NO_IFMA_)
+    #define X64_IFMA_LANES
+#endif
+
+#if defined(X64_ASM_KERNELS)
+// Selects the multiplication and reduction kernels via CPUID, returns true if the MULX/ADX kernels are used
+bool select_fp_kernels(void);
+#endif
+
+#if defined(X64_IFMA_LANES)
+// Returns true if the processor and the operating system support AVX-512F and AVX-512 IFMA
+bool fp_x8_supported(void);
+#endif
 
 // Field squaring using Montgomery arithmetic, c = a*b*R^-1 mod p751, where R=2^768
 void fpsqr751_mont(const felm_t ma, felm_t mc);
@@ -311,6 +337,9 @@ void fpinv751_mont(felm_t a);
 // Field inversion, a = a^-1 in GF(p751) using the binary GCD
 void fpinv751_mont_bingcd(felm_t a);
 
+// Field inversion, a = a^-1 in GF(p751) in constant time using the divsteps of Bernstein and Yang
+void fpinv751_mont_safegcd(felm_t a);
+
 // Chain to compute (p751-3)/4 using Montgomery arithmetic
 void fpinv751_chain_mont(felm_t a);
 
@@ -342,6 +371,10 @@ void fp2sqr751_mont(const f2elm_t a, f2elm_t c);
 
 // GF(p751^2) multiplication using Montgomery arithmetic, c = a*b in GF(p751^2)
 void fp2mul751_mont(const f2elm_t a, const f2elm_t b, f2elm_t c);
+void fp2sqr751_asm(const f2elm_t a, f2elm_t c);
+void fp2mul751_asm(const f2elm_t a, const f2elm_t b, f2elm_t c);
+void fp2sqr751_mulx_asm(const f2elm_t a, f2elm_t c);
+void fp2mul751_mulx_asm(const f2elm_t a, const f2elm_t b, f2elm_t c);
 
 // Conversion of a GF(p751^2) element to Montgomery representation
 void to_fp2mont(const f2elm_t a, f2elm_t mc);
@@ -361,9 +394,17 @@ void mont_n_way_inv(const f2elm_t* vec, const int n, f2elm_t* out);
 // n-way Montgomery inversion supporting batching across threads
 void mont_n_way_inv_batched(const f2elm_t* vec, const int n, f2elm_t* out, batch_struct* batch);
 
+// a = 1/a, inverted together with the elements other threads hand in to the same batch (0 stays 0)
+void batch_invert(f2elm_t a, batch_struct* batch);
+
 // new n-way partial
 void partial_batched_inv(const f2elm_t* vec, f2elm_t* dest, const int n);
 
+// dest[i] = 1/vec[i] for n elements (0 stays 0), with scratch on the heap. The passes over the elements are shared by
+// nworkers workers of pool, or run by the caller if pool is NULL. Must not be called from a job running on pool.
+struct worker_pool;
+CRYPTO_STATUS batched_inv_pool(const f2elm_t* vec, f2elm_t* dest, const int n, struct worker_pool* pool, int nworkers);
+
 // Select either x or y depending on value of option
 void select_f2elm(const f2elm_t x, const f2elm_t y, f2elm_t z, const digit_t option);
 
@@ -385,6 +426,10 @@ extern void inv_Fp2_cycl(f2elm_t a);
 // Check if GF(p751^2) element is cube
 bool is_cube_Fp2(f2elm_t u, PCurveIsogenyStruct CurveIsogeny);
 
+// Same for n elements, up to BASIS_BATCH of which share one inversion: cube[i] = is_cube_Fp2(u[i])
+#define BASIS_BATCH           8
+void is_cube_Fp2_batch(const f2elm_t* u, bool* cube, int n, PCurveIsogenyStruct CurveIsogeny);
+
 // Exponentiation y^t via square and multiply in the cyclotomic group. Exponent t is 6 bits at most
 void exp6_Fp2_cycl(const f2elm_t y, const uint64_t t, const felm_t one, f2elm_t res);
 
@@ -444,9 +489,23 @@ void fp2_ladder(const f2elm_t x, digit_t* m, point_proj_t P, point_proj_t Q, con
 // Computes key generation entirely in the base field
 CRYPTO_STATUS secret_pt(const point_basefield_t P, const digit_t* m, const unsigned int AliceOrBob, point_proj_t R, PCurveIsogenyStruct CurveIsogeny);
 
+// Fixed-base tables for secret_pt(): row i holds the affine points [1]B, [3]B, ..., [15]B for B = [16^i]P
+#define FIXED_BASE_POINTS           8                                               // Points per row, odd multiples up to 2^4-1
+#define FIXED_BASE_ROWS(nbits)      (((nbits)+3)/4)                                 // One row per 4-bit digit of the scalar
+#define FIXED_BASE_NWORDS(nbits)    (FIXED_BASE_ROWS(nbits)*FIXED_BASE_POINTS*2*NWORDS_FIELD)
+
+// Fills in the fixed-base table of P (in Montgomery representation) for scalars of nbits bits
+CRYPTO_STATUS fixed_base_table(const point_basefield_t P, const unsigned int nbits, digit_t* table, PCurveIsogenyStruct CurveIsogeny);
+
 // Computes P+[m]Q via x-only arithmetic.
 CRYPTO_STATUS ladder_3_pt(const f2elm_t xP, const f2elm_t xQ, const f2elm_t xPQ, const digit_t* m, const unsigned int AliceOrBob, point_proj_t W, const f2elm_t A, PCurveIsogenyStruct CurveIsogeny);
 
+// Precomputes the nbits doublings of Q for ladder_3_pt_prepared
+void prepare_3_pt_ladder(const f2elm_t xQ, const f2elm_t A, f2elm_t (*table)[2], const unsigned int nbits, PCurveIsogenyStruct CurveIsogeny);
+
+// Computes P+[m]Q from a table of Q made by prepare_3_pt_ladder, one differential addition per bit of m
+void ladder_3_pt_prepared(const f2elm_t xP, const f2elm_t xPQ, const f2elm_t (*table)[2], const digit_t* m, const unsigned int nbits, point_proj_t W, PCurveIsogenyStruct CurveIsogeny);
+
 // Computes the corresponding 4-isogeny of a projective Montgomery point (X4:Z4) of order 4.
 void get_4_isog(const point_proj_t P, f2elm_t A, f2elm_t C, f2elm_t* coeff);
 
@@ -486,6 +545,48 @@ void distort_and_diff(const felm_t xP, point_proj_t d, PCurveIsogenyStruct Curve
 // Given the x-coordinates of P, Q, and R, returns the value A corresponding to the Montgomery curve E_A: y^2=x^3+A*x^2+x such that R=Q-P on E_A.
 void get_A(const f2elm_t xP, const f2elm_t xQ, const f2elm_t xR, f2elm_t A, PCurveIsogenyStruct CurveIsogeny);
 
+/************ 8-lane arithmetic and isogeny functions *************/
+
+// An element of felm_x8_t holds 8 elements of GF(p751) in radix 2^52, limb i of the 8 lanes side by side,
+// in Montgomery representation with R' = 2^780
+#define NLANES           8
+#define NLIMBS_LANES     15
+
+typedef uint64_t felm_x8_t[NLIMBS_LANES][NLANES];
+typedef felm_x8_t f2elm_x8_t[2];
+typedef struct { f2elm_x8_t X; f2elm_x8_t Z; } point_proj_x8;
+typedef point_proj_x8 point_proj_x8_t[1];
+
+#if defined(X64_IFMA_LANES)
+// Modular addition, subtraction, multiplication and squaring in every lane
+void fpadd751_x8(const felm_x8_t a, const felm_x8_t b, felm_x8_t c);
+void fpsub751_x8(const felm_x8_t a, const felm_x8_t b, felm_x8_t c);
+void fpmul751_mont_x8(const felm_x8_t ma, const felm_x8_t mb, felm_x8_t mc);
+void fpsqr751_mont_x8(const felm_x8_t ma, felm_x8_t mc);
+
+// GF(p751^2) addition, subtraction, multiplication and squaring in every lane
+void fp2add751_x8(const f2elm_x8_t a, const f2elm_x8_t b, f2elm_x8_t c);
+void fp2sub751_x8(const f2elm_x8_t a, const f2elm_x8_t b, f2elm_x8_t c);
+void fp2mul751_mont_x8(const f2elm_x8_t a, const f2elm_x8_t b, f2elm_x8_t c);
+void fp2sqr751_mont_x8(const f2elm_x8_t a, f2elm_x8_t c);
+
+// Moves 8 GF(p751^2) elements in Montgomery representation to the lanes of c and back
+void fp2pack751_x8(const f2elm_t* a, f2elm_x8_t c);
+void fp2unpack751_x8(const f2elm_x8_t a, f2elm_t* c);
+
+// Returns a mask with bit j set if lane j of a is zero
+unsigned int fp2iszero751_x8(const f2elm_x8_t a);
+
+// xDBL, xDBLe, eval_4_isog, xTPL, xTPLe, get_3_isog and eval_3_isog in every lane
+void xDBL_x8(const point_proj_x8_t P, point_proj_x8_t Q, const f2elm_x8_t A24, const f2elm_x8_t C24);
+void xDBLe_x8(const point_proj_x8_t P, point_proj_x8_t Q, const f2elm_x8_t A, const f2elm_x8_t C, const int e);
+void eval_4_isog_x8(point_proj_x8_t P, f2elm_x8_t* coeff);
+void xTPL_x8(const point_proj_x8_t P, point_proj_x8_t Q, const f2elm_x8_t A24, const f2elm_x8_t C24);
+void xTPLe_x8(const point_proj_x8_t P, point_proj_x8_t Q, const f2elm_x8_t A, const f2elm_x8_t C, const int e);
+void get_3_isog_x8(const point_proj_x8_t P, f2elm_x8_t A, f2elm_x8_t C);
+void eval_3_isog_x8(const point_proj_x8_t P, point_proj_x8_t Q);
+#endif
+
 /************ Functions for compression *************/
 
 // Produces points R1 and R2 as basis for E[2^372]
@@ -494,6 +595,35 @@ void generate_2_torsion_basis(const f2elm_t A, point_full_proj_t R1, point_full_
 // Produces points R1 and R2 as basis for E[3^239]
 void generate_3_torsion_basis(f2elm_t A, point_full_proj_t R1, point_full_proj_t R2, PCurveIsogenyStruct CurveIsogeny);
 
+// Same, also returns the search counters at which R1 and R2 were found
+void generate_3_torsion_basis_hint(f2elm_t A, point_full_proj_t R1, point_full_proj_t R2, unsigned int hint[2], PCurveIsogenyStruct CurveIsogeny);
+
+// Same for the n curves A[i], searched BASIS_BATCH at a time with their ladders and cube tests batched
+void generate_3_torsion_basis_batch(f2elm_t* A, point_full_proj* R1, point_full_proj* R2, unsigned int (*hint)[2], int n, PCurveIsogenyStruct CurveIsogeny);
+
+// Recomputes the basis found by generate_3_torsion_basis_hint from its search counters, skipping the search
+void generate_3_torsion_basis_from_hint(f2elm_t A, point_full_proj_t R1, point_full_proj_t R2, const unsigned int hint[2], PCurveIsogenyStruct CurveIsogeny);
+
+// The search counters run over 1..11 (the Elligator table), so a hint packs into one byte: 0 means no hint
+#define MAX_BASIS_HINT        11
+
+static __inline unsigned char pack_basis_hint(const unsigned int hint[2])
+{
+    if (hint[0] == 0 || hint[0] > MAX_BASIS_HINT || hint[1] == 0 || hint[1] > MAX_BASIS_HINT) {
+        return 0;
+    }
+    return (unsigned char)(hint[0] | (hint[1] << 4));
+}
+
+static __inline void unpack_basis_hint(unsigned char packed, unsigned int hint[2])
+{ // An invalid byte unpacks to {0, 0}
+    hint[0] = packed & 0x0F;
+    hint[1] = packed >> 4;
+    if (hint[0] == 0 || hint[0] > MAX_BASIS_HINT || hint[1] == 0 || hint[1] > MAX_BASIS_HINT) {
+        hint[0] = hint[1] = 0;
+    }
+}
+
 // 2-torsion Tate pairing
 void Tate_pairings_2_torsion(const point_t R1, const point_t R2, const point_t P, const point_t Q, const f2elm_t A, f2elm_t* n, PCurveIsogenyStruct CurveIsogeny);
 
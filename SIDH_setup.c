@@ -17,6 +17,8 @@ CRYPTO_STATUS SIDH_curve_initialize(PCurveIsogenyStruct pCurveIsogeny, RandomByt
 { // Initialize curve isogeny structure pCurveIsogeny with static data extracted from pCurveIsogenyData.
   // This needs to be called after allocating memory for "pCurveIsogeny" using SIDH_curve_allocate().
     unsigned int i, pwords, owords;
+    point_basefield_t P;
+    CRYPTO_STATUS Status;
 
     if (is_CurveIsogenyStruct_null(pCurveIsogeny)) {
         return CRYPTO_ERROR_INVALID_PARAMETER;
@@ -47,6 +49,24 @@ CRYPTO_STATUS SIDH_curve_initialize(PCurveIsogenyStruct pCurveIsogeny, RandomByt
     copy_words((digit_t*)pCurveIsogenyData->Montgomery_R2, pCurveIsogeny->Montgomery_R2, pwords);
     copy_words((digit_t*)pCurveIsogenyData->Montgomery_pp, pCurveIsogeny->Montgomery_pp, pwords);
     copy_words((digit_t*)pCurveIsogenyData->Montgomery_one, pCurveIsogeny->Montgomery_one, pwords);
+
+#if defined(X64_ASM_KERNELS)
+    select_fp_kernels();
+#endif
+
+    // Fixed-base tables of Alice's and Bob's generators for secret_pt()
+    to_mont(pCurveIsogeny->PA, (digit_t*)P->x);
+    to_mont(pCurveIsogeny->PA + NWORDS_FIELD, (digit_t*)P->y);
+    Status = fixed_base_table(P, pCurveIsogeny->oAbits, pCurveIsogeny->PA_table, pCurveIsogeny);
+    if (Status != CRYPTO_SUCCESS) {
+        return Status;
+    }
+    to_mont(pCurveIsogeny->PB, (digit_t*)P->x);
+    to_mont(pCurveIsogeny->PB + NWORDS_FIELD, (digit_t*)P->y);
+    Status = fixed_base_table(P, pCurveIsogeny->oBbits, pCurveIsogeny->PB_table, pCurveIsogeny);
+    if (Status != CRYPTO_SUCCESS) {
+        return Status;
+    }
     
     return CRYPTO_SUCCESS;
 }
@@ -67,6 +87,8 @@ PCurveIsogenyStruct SIDH_curve_allocate(PCurveIsogenyStaticData CurveData)
     pCurveIsogeny->Border = (digit_t*)calloc(1, obytes);
     pCurveIsogeny->PA = (digit_t*)calloc(1, 2*pbytes);
     pCurveIsogeny->PB = (digit_t*)calloc(1, 2*pbytes);
+    pCurveIsogeny->PA_table = (digit_t*)calloc(FIXED_BASE_NWORDS(CurveData->oAbits), sizeof(digit_t));
+    pCurveIsogeny->PB_table = (digit_t*)calloc(FIXED_BASE_NWORDS(CurveData->oBbits), sizeof(digit_t));
     pCurveIsogeny->BigMont_order = (digit_t*)calloc(1, pbytes);
     pCurveIsogeny->Montgomery_R2 = (digit_t*)calloc(1, pbytes);
     pCurveIsogeny->Montgomery_pp = (digit_t*)calloc(1, pbytes);
@@ -98,6 +120,10 @@ void SIDH_curve_free(PCurveIsogenyStruct pCurveIsogeny)
             free(pCurveIsogeny->PA);
         if (pCurveIsogeny->PB != NULL) 
             free(pCurveIsogeny->PB);
+        if (pCurveIsogeny->PA_table != NULL) 
+            free(pCurveIsogeny->PA_table);
+        if (pCurveIsogeny->PB_table != NULL) 
+            free(pCurveIsogeny->PB_table);
         if (pCurveIsogeny->BigMont_order != NULL) 
             free(pCurveIsogeny->BigMont_order);
         if (pCurveIsogeny->Montgomery_R2 != NULL) 
@@ -116,7 +142,7 @@ bool is_CurveIsogenyStruct_null(PCurveIsogenyStruct pCurveIsogeny)
 { // Check if curve isogeny structure is NULL
 
     if (pCurveIsogeny == NULL || pCurveIsogeny->prime == NULL || pCurveIsogeny->A == NULL || pCurveIsogeny->C == NULL || pCurveIsogeny->Aorder == NULL || pCurveIsogeny->Border == NULL || 
-        pCurveIsogeny->PA == NULL || pCurveIsogeny->PB == NULL || pCurveIsogeny->BigMont_order == NULL || pCurveIsogeny->Montgomery_R2 == NULL || pCurveIsogeny->Montgomery_pp == NULL || 
+        pCurveIsogeny->PA == NULL || pCurveIsogeny->PB == NULL || pCurveIsogeny->PA_table == NULL || pCurveIsogeny->PB_table == NULL || pCurveIsogeny->BigMont_order == NULL || pCurveIsogeny->Montgomery_R2 == NULL || pCurveIsogeny->Montgomery_pp == NULL || 
         pCurveIsogeny->Montgomery_one == NULL)
     {
         return true;
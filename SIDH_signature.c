@@ -11,41 +11,385 @@
 #include "SIDH_signature.h"
 #include "tests/test_extras.h"
 #include "keccak.h"
+#include "thread_pool.h"
 #include <stdio.h>
 #include <stdarg.h>
 #include <stdlib.h>
 #include <limits.h>
 #include <pthread.h>
 #include <semaphore.h>
+#include <unistd.h>
 
 int NUM_THREADS = 248;
-int CUR_ROUND = 0;
-int batchSize = 248;
-int errorCount = 0;
-int roundSuccess = 0;
-int psiS_count = 0;
-batch_struct* signBatchA;
-batch_struct* signBatchB;
-batch_struct* verifyBatchA;
-batch_struct* verifyBatchB;
-batch_struct* verifyBatchC;
-batch_struct* compressionBatch;
-batch_struct* decompressionBatch;
-pthread_mutex_t RLOCK;      //lock for round counter
-pthread_mutex_t BLOCK;      //lock for batch size counter
-pthread_mutex_t ELOCK;      //lock for errorCount
-
-digit_t a[NWORDS_ORDER], b[NWORDS_ORDER];
-
-void hashdata(unsigned int pbytes, unsigned char** comm1, unsigned char** comm2, uint8_t* HashResp, int hlen, int dlen, uint8_t *data, uint8_t *cHash, int cHashLength) {
+int ROUND_CHUNK = 1;
+
+#define ARENA_ALIGN(x)   (((x) + 63) & ~(size_t)63)   //sections of an arena start on their own cache line
+
+//serialized signature: flags byte and challenge, followed by the commitments and one response per round
+#define WIRE_COMPRESSED     0x01
+#define WIRE_HEADER_BYTES   (1 + NUM_ROUNDS/8)
+//a compressed psi(S) is followed by its compBit and basis hint bytes, the response hash covers all three
+#define WIRE_COMP_EXTRA     2
+#define COMP_RESPONSE_BYTES (sizeof(digit_t)*NWORDS_ORDER + WIRE_COMP_EXTRA)
+
+//bytes of per-worker scratch: one public key (4 elements in GF(p^2)) and one shared secret (1 element in GF(p^2))
+#define SCRATCH_BYTES(pbytes)   ARENA_ALIGN(5*2*(size_t)(pbytes))
+
+//starting estimates of the verify round costs in cycles, before a context has measured its own:
+//bit 0 runs KeyGeneration_A + SecretAgreement_A, bit 1 (decompression,) 238 xTPL and SecretAgreement_B
+#define VERIFY_COST_BIT0                60000000ULL
+#define VERIFY_COST_BIT1                25000000ULL
+#define VERIFY_COST_BIT1_COMPRESSED     55000000ULL
+
+
+//allocates the inversion batches of a batched operation in one group, so that an epoch closes as soon as every
+//worker waits in one of them; batches[i] is left NULL when want[i] is 0
+static CRYPTO_STATUS batches_alloc(SignatureContext *ctx, batch_struct **batches[], const int *want, int n, int capacity) {
+	int i;
+
+	ctx->batches = SIDH_batch_group_allocate(BATCH_TIMEOUT_USEC);
+	for (i=0; i<n; i++) {
+		*batches[i] = (want[i] && ctx->batches != NULL) ? SIDH_batch_allocate(capacity, ctx->batches) : NULL;
+		if (want[i] && *batches[i] == NULL) {
+			return CRYPTO_ERROR_NO_MEMORY;
+		}
+	}
+	return (ctx->batches != NULL) ? CRYPTO_SUCCESS : CRYPTO_ERROR_NO_MEMORY;
+}
+
+//adds the achieved batch sizes to the operation's statistics and frees the batches and their group
+static void batches_free(SignatureContext *ctx, batch_struct **batches[], int n) {
+	int i;
+
+	for (i=0; i<n; i++) {
+		batch_struct *batch = *batches[i];
+		if (batch == NULL) continue;
+		ctx->stats.invEpochs += batch->stats.flushes;
+		ctx->stats.invElements += batch->stats.elements;
+		ctx->stats.invTimeouts += batch->stats.timeouts;
+		if (batch->stats.maxSize > ctx->stats.invMaxBatch) {
+			ctx->stats.invMaxBatch = batch->stats.maxSize;
+		}
+		SIDH_batch_free(batch);
+		*batches[i] = NULL;
+	}
+	SIDH_batch_group_free(ctx->batches);
+	ctx->batches = NULL;
+}
+
+//runs job on nthreads workers, taken from the pool if one is given or spawned for this call otherwise
+static void run_workers(worker_pool *pool, pool_job job, void *arg, int nthreads) {
+	if (pool != NULL) {
+		pool_run(pool, job, arg, nthreads);
+		return;
+	}
+
+	pthread_t threads[nthreads];
+	int t, created = 0;
+	for (t=0; t<nthreads; t++) {
+		if (pthread_create(&threads[created], NULL, job, arg)) {
+      #ifdef TEST_RUN_PRINTS
+			printf("ERROR: Failed to create thread %d\n", t);
+      #endif
+		} else {
+			created++;
+		}
+	}
+
+	for (t=0; t<created; t++) {
+		pthread_join(threads[t], NULL);
+	}
+}
+
+
+static CRYPTO_STATUS context_init(SignatureContext *ctx, PCurveIsogenyStruct CurveIsogeny, worker_pool *pool) {
+	unsigned int pbytes = (CurveIsogeny->pwordbits + 7)/8;
+
+	memset(ctx, 0, sizeof(SignatureContext));
+	ctx->CurveIsogeny = CurveIsogeny;
+	ctx->pool = pool;
+	ctx->roundChunk = ROUND_CHUNK;
+	ctx->roundCost[0][0] = VERIFY_COST_BIT0;
+	ctx->roundCost[0][1] = VERIFY_COST_BIT1;
+	ctx->roundCost[1][0] = VERIFY_COST_BIT0;
+	ctx->roundCost[1][1] = VERIFY_COST_BIT1_COMPRESSED;
+	ctx->nslots = (pool != NULL) ? pool->nworkers : NUM_THREADS;
+	ctx->slots = (round_slot*) calloc (ctx->nslots, sizeof(round_slot));
+	ctx->scratch = (unsigned char*) calloc (ctx->nslots, SCRATCH_BYTES(pbytes));
+	pthread_mutex_init(&ctx->OPLOCK, NULL);
+	pthread_mutex_init(&ctx->HASHLOCK, NULL);
+
+	if (ctx->slots == NULL || ctx->scratch == NULL) {
+		return CRYPTO_ERROR_NO_MEMORY;
+	}
+	return CRYPTO_SUCCESS;
+}
+
+static void context_destroy(SignatureContext *ctx) {
+	int i;
+	for (i=0; i<PREPARED_KEYS; i++) {
+		free(ctx->preparedKeys[i].PublicKey);
+		free(ctx->preparedKeys[i].Prepared);
+	}
+	free(ctx->slots);
+	free(ctx->scratch);
+	pthread_mutex_destroy(&ctx->OPLOCK);
+	pthread_mutex_destroy(&ctx->HASHLOCK);
+}
+
+//resets the per-operation state of a context for a new sign/verify
+static void context_begin(SignatureContext *ctx) {
+	ctx->curRound = 0;
+	ctx->endRound = NUM_ROUNDS;
+	ctx->chunk = ctx->roundChunk;
+	ctx->nextSlot = 0;
+	ctx->order = NULL;
+	ctx->nqueues = 0;
+	ctx->errorCount = 0;
+	ctx->lastError = CRYPTO_SUCCESS;
+	ctx->psiS_count = 0;
+	memset(&ctx->stats, 0, sizeof(SignatureStats));
+	memset(ctx->slots, 0, ctx->nslots * sizeof(round_slot));
+	keccak_init(&ctx->challenge, NUM_ROUNDS/8);
+	ctx->absorbed = 0;
+	memset(ctx->roundReady, 0, sizeof(ctx->roundReady));
+	ctx->signBatchA = NULL;
+	ctx->signBatchB = NULL;
+	ctx->verifyBatchA = NULL;
+	ctx->verifyBatchB = NULL;
+	ctx->verifyBatchC = NULL;
+	ctx->compressionBatch = NULL;
+	ctx->decompressionBatch = NULL;
+	ctx->batches = NULL;
+}
+
+//folds the workers' result slots into the context once all of them have returned
+static void context_collect(SignatureContext *ctx) {
+	int i;
+	for (i=0; i<ctx->nslots; i++) {
+		ctx->errorCount += ctx->slots[i].errorCount;
+		if (ctx->slots[i].errorCount > 0) {
+			ctx->lastError = ctx->slots[i].lastError;
+		}
+		ctx->stats.retries += ctx->slots[i].retries;
+		ctx->stats.claims += ctx->slots[i].claims;
+		ctx->stats.claimCycles += ctx->slots[i].claimCycles;
+		ctx->stats.steals += ctx->slots[i].steals;
+		ctx->stats.roundCycles[0] += ctx->slots[i].roundCycles[0];
+		ctx->stats.roundCycles[1] += ctx->slots[i].roundCycles[1];
+	}
+}
+
+//hands the calling worker its result slot for the current run
+static round_slot* claim_slot(SignatureContext *ctx) {
+	int i = __atomic_fetch_add(&ctx->nextSlot, 1, __ATOMIC_RELAXED);
+	return &ctx->slots[i % ctx->nslots];
+}
+
+//scratch buffers owned by the worker holding the given slot, reused by every round it runs
+static unsigned char* slot_scratch(SignatureContext *ctx, round_slot *slot) {
+	unsigned int pbytes = (ctx->CurveIsogeny->pwordbits + 7)/8;
+	return ctx->scratch + (size_t)(slot - ctx->slots) * SCRATCH_BYTES(pbytes);
+}
+
+//takes one round from the front of the worker's own queue or, once that is empty, from the back of the
+//next non-empty queue; returns -1 when every queue is empty
+static int claim_queued_round(SignatureContext *ctx, round_slot *slot) {
+	int self = (int)(slot - ctx->slots), i;
+
+	for (i=0; i<ctx->nqueues; i++) {
+		round_slot *victim = &ctx->slots[(self + i) % ctx->nqueues];
+		unsigned long long q = __atomic_load_n(&victim->queue, __ATOMIC_ACQUIRE), taken;
+		unsigned int head, tail;
+
+		do {
+			head = (unsigned int) q;
+			tail = (unsigned int) (q >> 32);
+			if (head >= tail) break;
+			taken = (i == 0) ? q + 1 : q - (1ULL << 32);
+		} while (!__atomic_compare_exchange_n(&victim->queue, &q, taken, false, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE));
+
+		if (head < tail) {
+			if (i == 0) {
+				return ctx->order[head];
+			}
+			slot->steals++;
+			return ctx->order[tail - 1];
+		}
+	}
+	return -1;
+}
+
+//claims the next chunk of rounds [*first, *last) without taking a lock, returns 0 once every round is taken
+static int claim_rounds(SignatureContext *ctx, round_slot *slot, int *first, int *last) {
+	unsigned long long cycles = cpucycles();
+	int start;
+
+	if (ctx->order != NULL) {
+		start = claim_queued_round(ctx, slot);
+		slot->claimCycles += cpucycles() - cycles;
+		slot->claims++;
+		*first = start;
+		*last = start + 1;
+		return start >= 0;
+	}
+
+	start = __atomic_fetch_add(&ctx->curRound, ctx->chunk, __ATOMIC_RELAXED);
+	slot->claimCycles += cpucycles() - cycles;
+	slot->claims++;
+
+	if (start >= ctx->endRound) {
+		return 0;
+	}
+	*first = start;
+	*last = (start + ctx->chunk < ctx->endRound) ? start + ctx->chunk : ctx->endRound;
+	return 1;
+}
+
+//runs one set of workers over the context's pending rounds, each of them a member of the operation's batches if it has any
+static void run_round_workers(SignatureContext *ctx, pool_job job, void *arg, int nthreads) {
+	ctx->nextSlot = 0;
+	ctx->stats.workers += nthreads;
+	SIDH_batch_group_begin(ctx->batches, nthreads);
+	run_workers(ctx->pool, job, arg, nthreads);
+}
+
+
+SignatureContext* signature_context_allocate(PCurveIsogenyStruct CurveIsogeny, int nworkers) {
+	SignatureContext *ctx = (SignatureContext*) calloc (1, sizeof(SignatureContext));
+	worker_pool *pool;
+	if (ctx == NULL) {
+		return NULL;
+	}
+
+	pool = pool_create(nworkers);
+	if (pool == NULL) {
+		free(ctx);
+		return NULL;
+	}
+	if (context_init(ctx, CurveIsogeny, pool) != CRYPTO_SUCCESS) {
+		signature_context_free(ctx);
+		return NULL;
+	}
+
+	return ctx;
+}
+
+void signature_context_free(SignatureContext *ctx) {
+	if (ctx == NULL) return;
+	pool_free(ctx->pool);
+	context_destroy(ctx);
+	free(ctx);
+}
+
+void signature_context_set_chunk(SignatureContext *ctx, int chunk) {
+	ctx->roundChunk = (chunk > 0) ? chunk : 1;
+}
+
+//carves the per-round buffers of a signature out of a single allocation
+static CRYPTO_STATUS signature_alloc(struct Signature *sig, unsigned int pbytes, unsigned int obytes) {
+	size_t randomsBytes = ARENA_ALIGN(NUM_ROUNDS * (size_t)obytes);
+	size_t commitBytes = ARENA_ALIGN(NUM_ROUNDS * 2*(size_t)pbytes);
+	size_t psiSBytes = ARENA_ALIGN(NUM_ROUNDS * sizeof(point_proj));
+	size_t hashBytes = 2 * NUM_ROUNDS * HASH_LENGTH;
+	unsigned char *p;
+	int r;
+
+	signature_free(sig);    //a signature signed into again drops the buffers of its previous signing
+	sig->arena = (unsigned char*) calloc (1, randomsBytes + 2*commitBytes + psiSBytes + hashBytes);
+	if (sig->arena == NULL) {
+		return CRYPTO_ERROR_NO_MEMORY;
+	}
+
+	p = sig->arena;
+	for (r=0; r<NUM_ROUNDS; r++) {
+		sig->Randoms[r] = p + r*obytes;
+		sig->Commitments1[r] = p + randomsBytes + r*2*pbytes;
+		sig->Commitments2[r] = p + randomsBytes + commitBytes + r*2*pbytes;
+		sig->psiS[r] = (point_proj*)(p + randomsBytes + 2*commitBytes) + r;
+	}
+	sig->HashResp = p + randomsBytes + 2*commitBytes + psiSBytes;
+
+	return CRYPTO_SUCCESS;
+}
+
+void signature_free(struct Signature *sig) {
+	if (sig == NULL) return;
+	free(sig->arena);
+	sig->arena = NULL;
+	sig->HashResp = NULL;
+}
+
+//the challenge hashes all Commitments1, then all Commitments2, then the two response hashes of every round;
+//absorbs that input into ks starting at the Commitments1 of round first
+static void hash_commitments(keccak_state *ks, unsigned int pbytes, unsigned char **comm1, unsigned char **comm2, const uint8_t *HashResp, int first) {
     int r;
+    for (r=first; r<NUM_ROUNDS; r++) {
+        keccak_absorb(ks, comm1[r], 2*pbytes);
+    }
     for (r=0; r<NUM_ROUNDS; r++) {
-        memcpy(data + (r * 2*pbytes), comm1[r], 2*pbytes);
-        memcpy(data + (NUM_ROUNDS * 2*pbytes) + (r * 2*pbytes), comm2[r], 2*pbytes);
+        keccak_absorb(ks, comm2[r], 2*pbytes);
+    }
+    keccak_absorb(ks, HashResp, 2 * NUM_ROUNDS * HASH_LENGTH);
+}
+
+static void challenge_hash(unsigned int pbytes, struct Signature *sig, uint8_t *cHash) {
+    keccak_state ks;
+
+    keccak_init(&ks, NUM_ROUNDS/8);
+    hash_commitments(&ks, pbytes, sig->Commitments1, sig->Commitments2, sig->HashResp, 0);
+    keccak_squeeze(&ks, cHash);
+}
+
+//packs a compressed response as it goes on the wire: compPsiS || compBit || basis hint
+static void pack_comp_response(const digit_t *compPsiS, int compBit, unsigned char basisHint, uint8_t *out) {
+    memcpy(out, compPsiS, COMP_RESPONSE_BYTES - WIRE_COMP_EXTRA);
+    out[COMP_RESPONSE_BYTES - 2] = (uint8_t)compBit;
+    out[COMP_RESPONSE_BYTES - 1] = basisHint;
+}
+
+//hashes both responses of a round, HashResp receives 2*HASH_LENGTH bytes
+static void hash_round_responses(const unsigned char *Random, unsigned int obytes, const point_proj *psiS, const digit_t *compPsiS, int compBit, unsigned char basisHint,
+                                 int compressed, uint8_t *HashResp) {
+    keccak((uint8_t*) Random, obytes, HashResp, HASH_LENGTH);
+    if (compressed) {
+        uint8_t resp[COMP_RESPONSE_BYTES];
+        pack_comp_response(compPsiS, compBit, basisHint, resp);
+        keccak(resp, COMP_RESPONSE_BYTES, HashResp + HASH_LENGTH, HASH_LENGTH);
+    } else {
+        keccak((uint8_t*) psiS, sizeof(point_proj), HashResp + HASH_LENGTH, HASH_LENGTH);
     }
-    memcpy(data + (2 * NUM_ROUNDS * 2*pbytes), HashResp, 2 * NUM_ROUNDS * hlen);
+}
+
+//hashes the responses of all rounds, eight rounds per multi-buffer call, into sig->HashResp
+static void hash_signature_responses(struct Signature *sig, unsigned int obytes, int compressed) {
+    const uint8_t *in[8];
+    uint8_t *md[8], resp[8][COMP_RESPONSE_BYTES];
+    int r, k;
 
-    keccak(data, dlen, cHash, cHashLength);
+    for (r=0; r + 8 <= NUM_ROUNDS; r+=8) {
+        for (k=0; k<8; k++) {
+            in[k] = sig->Randoms[r+k];
+            md[k] = sig->HashResp + (2*(r+k))*HASH_LENGTH;
+        }
+        keccak_x8(in, obytes, md, HASH_LENGTH);
+
+        for (k=0; k<8; k++) {
+            if (compressed) {
+                pack_comp_response(sig->compPsiS[r+k], sig->compBit[r+k], sig->basisHint[r+k], resp[k]);
+                in[k] = resp[k];
+            } else {
+                in[k] = (const uint8_t*) sig->psiS[r+k];
+            }
+            md[k] = sig->HashResp + (2*(r+k) + 1)*HASH_LENGTH;
+        }
+        keccak_x8(in, compressed ? COMP_RESPONSE_BYTES : sizeof(point_proj), md, HASH_LENGTH);
+    }
+#if NUM_ROUNDS % 8
+    for (; r<NUM_ROUNDS; r++) {
+        hash_round_responses(sig->Randoms[r], obytes, sig->psiS[r], sig->compPsiS[r], sig->compBit[r], sig->basisHint[r], compressed, sig->HashResp + (2*r)*HASH_LENGTH);
+    }
+#endif
 }
 
 CRYPTO_STATUS isogeny_keygen(PCurveIsogenyStruct CurveIsogeny, unsigned char *PrivateKey, unsigned char *PublicKey) {
@@ -74,6 +418,7 @@ cleanup:
 }
 
 typedef struct thread_params_sign {
+	SignatureContext *ctx;
 	PCurveIsogenyStruct *CurveIsogeny;
 	unsigned char *PrivateKey;
 	unsigned char *PublicKey;
@@ -84,107 +429,255 @@ typedef struct thread_params_sign {
 	unsigned int obytes;
 
 	int compressed;
+	int lanes;                          //rounds whose SecretAgreement_B walks and, compressed, basis searches run together, 1 when batched
 } thread_params_sign;
 
 
-void *sign_thread(void *TPS) {
-	CRYPTO_STATUS Status = CRYPTO_SUCCESS;
-	thread_params_sign *tps = (thread_params_sign*) TPS;
+//first part of a signing round: picks a random R and computes the commitment E/<R>, left in TempPubKey as a public key
+static CRYPTO_STATUS sign_round_commit(PCurveIsogenyStruct CurveIsogeny, unsigned char *TempPubKey, unsigned char *Random,
+                                       unsigned char *Commitment1, batch_struct *batchA) {
+	CRYPTO_STATUS Status;
+	f2elm_t A;
 
-	int r=0;
+	Status = KeyGeneration_A(Random, TempPubKey, CurveIsogeny, true, batchA);
+	//check success of KeyGeneration_A
+	if(Status != CRYPTO_SUCCESS) {
+    #ifdef TEST_RUN_PRINTS
+		printf("Random point generation failed\n");
+    #endif
+	}
 
-	while (1) {
-		int stop=0;
+	to_fp2mont(((f2elm_t*)TempPubKey)[0], A);
+	fp2copy751(A, *(f2elm_t*)Commitment1);     //commitment1[r] = A = tempPubKey[0]
 
-		pthread_mutex_lock(&RLOCK);
-		if (CUR_ROUND >= NUM_ROUNDS) {
-			stop=1;
-		} else {
-			r = CUR_ROUND;
-			CUR_ROUND++;
+	return Status;
+}
+
+
+//last part of a signing round, once SecretAgreement_B has computed E/<R,S>: stores or compresses the response psi(S)
+static CRYPTO_STATUS sign_round_respond(PCurveIsogenyStruct CurveIsogeny, point_proj *tempPsiS, unsigned char *Commitment1,
+                                        point_proj *psiS, digit_t *compPsiS, int *compBit, uint8_t *basisHint, int compressed,
+                                        batch_struct *compressionBatch) {
+	CRYPTO_STATUS Status = CRYPTO_SUCCESS;
+
+	if (compressed) {
+		Status = compressPsiS(tempPsiS, (unsigned char*)compPsiS, compBit, basisHint, Commitment1, CurveIsogeny, compressionBatch);
+    if (Status != CRYPTO_SUCCESS) {
+			if (Status == CRYPTO_ERROR_DURING_TEST) {
+        #ifdef TEST_RUN_PRINTS
+				printf("half_ph3 not working\n");
+        #endif
+			} else {
+        #ifdef TEST_RUN_PRINTS
+				printf("Error in psi(S) compression\n");
+        #endif
+			}
 		}
-		pthread_mutex_unlock(&RLOCK);
+	} else {
+		fp2copy751(tempPsiS->X, psiS->X);
+		fp2copy751(tempPsiS->Z, psiS->Z);
+	}
 
-		if (stop) break;
+	return Status;
+}
 
-		tps->sig->Randoms[r] = (unsigned char*)calloc(1, tps->obytes);
-		tps->sig->Commitments1[r] = (unsigned char*)calloc(1, 2*tps->pbytes);
-		tps->sig->Commitments2[r] = (unsigned char*)calloc(1, 2*tps->pbytes);
-		tps->sig->psiS[r] = calloc(1, sizeof(point_proj));
-		tps->sig->compressed = tps->compressed;
 
-		// Pick random point R and compute E/<R>
-		f2elm_t A;
+//runs one signing round: picks a random R and computes the commitments E/<R>, E/<R,S> and the response psi(S)
+static CRYPTO_STATUS sign_round(PCurveIsogenyStruct CurveIsogeny, unsigned char *PrivateKey, unsigned char *TempPubKey,
+                                unsigned char *Random, unsigned char *Commitment1, unsigned char *Commitment2,
+                                point_proj *psiS, digit_t *compPsiS, int *compBit, uint8_t *basisHint, int compressed,
+                                batch_struct *batchA, batch_struct *batchB, batch_struct *compressionBatch) {
+	CRYPTO_STATUS Status;
+	point_proj tempPsiS[1];
 
-		unsigned char *TempPubKey;
-		TempPubKey = (unsigned char*)calloc(1, 4*2*tps->pbytes);
+	Status = sign_round_commit(CurveIsogeny, TempPubKey, Random, Commitment1, batchA);
+	if (Status != CRYPTO_SUCCESS) {
+		return Status;
+	}
 
-		Status = KeyGeneration_A(tps->sig->Randoms[r], TempPubKey, *(tps->CurveIsogeny), true, signBatchA);
-		//check success of KeyGeneration_A
-		if(Status != CRYPTO_SUCCESS) {
-      #ifdef TEST_RUN_PRINTS
-			printf("Random point generation failed\n");
-      #endif
+	//although SecretAgreement_A runs faster than B, B appears necessary so that we can generate psiS
+	Status = SecretAgreement_B(PrivateKey, TempPubKey, Commitment2, CurveIsogeny, NULL, tempPsiS, batchB, NULL);
+  if(Status != CRYPTO_SUCCESS) {
+    #ifdef TEST_RUN_PRINTS
+		printf("Secret Agreement failed\n");
+    #endif
+		return Status;
+	}
+
+	return sign_round_respond(CurveIsogeny, tempPsiS, Commitment1, psiS, compPsiS, compBit, basisHint, compressed, compressionBatch);
+}
+
+
+//compresses the responses of the n <= NLANES rounds first+i whose status[i] is still CRYPTO_SUCCESS,
+//with one search for the torsion bases of all their curves E/<R>
+static void sign_round_compress(thread_params_sign *tps, int first, int n, point_proj *tempPsiS, CRYPTO_STATUS *status) {
+	PCurveIsogenyStruct CurveIsogeny = *(tps->CurveIsogeny);
+	struct Signature *sig = tps->sig;
+	f2elm_t A[NLANES];
+	point_full_proj P[NLANES], Q[NLANES];
+	unsigned int hint[NLANES][2];
+	int idx[NLANES], i, m = 0;
+
+	for (i = 0; i < n; i++) {
+		if (status[i] == CRYPTO_SUCCESS) {
+			fp2copy751(*(f2elm_t*)sig->Commitments1[first + i], A[m]);
+			idx[m++] = i;
 		}
+	}
+	generate_3_torsion_basis_batch(A, P, Q, hint, m, CurveIsogeny);
 
-		to_fp2mont(((f2elm_t*)TempPubKey)[0], A);
-		fp2copy751(A, *(f2elm_t*)tps->sig->Commitments1[r]);     //commitment1[r] = A = tempPubKey[0]
-    /*
-    printf("Sign A[%d]:   ", r);
-    for (int i = 0; i < 2*tps->pbytes; i++) {
-      printf("%0hhu", (tps->sig->Commitments1[r])[i]);
-    } printf("\n");
-    */
-		point_proj tempPsiS[1];
+	for (i = 0; i < m; i++) {
+		int r = first + idx[i];
 
-		//although SecretAgreement_A runs faster than B, B appears necessary so that we can generate psiS
-		Status = SecretAgreement_B(tps->PrivateKey, TempPubKey, tps->sig->Commitments2[r], *(tps->CurveIsogeny), NULL, tempPsiS, signBatchB);
-    if(Status != CRYPTO_SUCCESS) {
-      #ifdef TEST_RUN_PRINTS
-			printf("Secret Agreement failed\n");
-      #endif
+		sig->basisHint[r] = pack_basis_hint(hint[i]);
+		status[idx[i]] = compressPsiS_basis(&tempPsiS[idx[i]], (unsigned char*)sig->compPsiS[r], &(sig->compBit[r]), A[i], &P[i], &Q[i], CurveIsogeny, NULL);
+	}
+}
+
+
+//runs the unbatched signing rounds [first, first+n), n <= NLANES, with their SecretAgreement_B walks in lockstep;
+//status[i] receives what sign_round would have returned for round first+i
+static void sign_round_lanes(thread_params_sign *tps, int first, int n, CRYPTO_STATUS *status) {
+	PCurveIsogenyStruct CurveIsogeny = *(tps->CurveIsogeny);
+	struct Signature *sig = tps->sig;
+	unsigned char TempPubKeys[NLANES][4*2*NWORDS_FIELD*sizeof(digit_t)];
+	unsigned char *PrivateKeys[NLANES], *PubKeys[NLANES], *Commitments2[NLANES];
+	point_proj tempPsiS[NLANES];
+	CRYPTO_STATUS walkStatus[NLANES], Status;
+	int i, r;
+
+	for (i = 0; i < n; i++) {
+		r = first + i;
+		status[i] = sign_round_commit(CurveIsogeny, TempPubKeys[i], sig->Randoms[r], sig->Commitments1[r], NULL);
+		PrivateKeys[i] = tps->PrivateKey;
+		PubKeys[i] = TempPubKeys[i];
+		Commitments2[i] = sig->Commitments2[r];
+	}
+
+	SecretAgreement_B_lanes(PrivateKeys, PubKeys, Commitments2, n, CurveIsogeny, NULL, tempPsiS, walkStatus);
+
+	if (tps->compressed) {
+		for (i = 0; i < n; i++) {
+			if (status[i] == CRYPTO_SUCCESS) {
+				status[i] = walkStatus[i];
+			}
+		}
+		sign_round_compress(tps, first, n, tempPsiS, status);
+		return;
+	}
+
+	for (i = 0; i < n; i++) {
+		r = first + i;
+		if (status[i] == CRYPTO_SUCCESS) {
+			status[i] = walkStatus[i];
+		}
+		Status = sign_round_respond(CurveIsogeny, &tempPsiS[i], sig->Commitments1[r], sig->psiS[r], sig->compPsiS[r], &(sig->compBit[r]),
+		                            &(sig->basisHint[r]), tps->compressed, NULL);
+		if (status[i] == CRYPTO_SUCCESS) {
+			status[i] = Status;
 		}
+	}
+}
 
-		f2elm_t Ab;
-		//to_fp2mont(((f2elm_t*)tps->PublicKey)[0],Ab);
-    to_fp2mont(((f2elm_t*)TempPubKey)[0], Ab);
 
+//marks round r as done and, unless another worker is already at it, absorbs the Commitments1 of every round
+//done so far into the challenge in round order, so that hashing overlaps the rounds still running
+static void absorb_ready_rounds(SignatureContext *ctx, struct Signature *sig, unsigned int pbytes, int r) {
+	__atomic_store_n(&ctx->roundReady[r], 1, __ATOMIC_RELEASE);
+	if (pthread_mutex_trylock(&ctx->HASHLOCK) != 0) {
+		return;    //whatever is left over is absorbed by sign_finish
+	}
+	while (ctx->absorbed < NUM_ROUNDS && __atomic_load_n(&ctx->roundReady[ctx->absorbed], __ATOMIC_ACQUIRE)) {
+		keccak_absorb(&ctx->challenge, sig->Commitments1[ctx->absorbed], 2*pbytes);
+		ctx->absorbed++;
+	}
+	pthread_mutex_unlock(&ctx->HASHLOCK);
+}
 
 
-		if (tps->compressed) {
-			Status = compressPsiS(tempPsiS, tps->sig->compPsiS[r], &(tps->sig->compBit[r]), tps->sig->Commitments1[r], *(tps->CurveIsogeny), compressionBatch);
-      //Status = compressPsiS_test(tempPsiS, tps->sig->compPsiS[r], &(tps->sig->compBit[r]), tps->sig->Commitments1[r], *(tps->CurveIsogeny), NULL, a, b);
+void *sign_thread(void *TPS) {
+	CRYPTO_STATUS Status = CRYPTO_SUCCESS;
+	thread_params_sign *tps = (thread_params_sign*) TPS;
+	SignatureContext *ctx = tps->ctx;
+	struct Signature *sig = tps->sig;
+
+	round_slot *slot = claim_slot(ctx);
+	unsigned char *TempPubKey = slot_scratch(ctx, slot);
+	CRYPTO_STATUS status[NLANES];
+	int r=0, next=0, last=0, retry, i, n;
+
+	while (1) {
+		if (next == last && !claim_rounds(ctx, slot, &next, &last)) break;
+
+		//rounds claimed together run their SecretAgreement_B walks in lockstep
+		n = (last - next < tps->lanes) ? last - next : tps->lanes;
+		if (n > 1) {
+			sign_round_lanes(tps, next, n, status);
+		} else {
+			r = next;
+			status[0] = sign_round(*(tps->CurveIsogeny), tps->PrivateKey, TempPubKey, sig->Randoms[r], sig->Commitments1[r], sig->Commitments2[r],
+			                       sig->psiS[r], sig->compPsiS[r], &(sig->compBit[r]), &(sig->basisHint[r]), tps->compressed,
+			                       ctx->signBatchA, ctx->signBatchB, ctx->compressionBatch);
+		}
+
+		for (i = 0; i < n; i++) {
+			r = next + i;
+			Status = status[i];
+			//a failed round is redone on its own with a fresh R, unbatched
+			for (retry = 0; Status != CRYPTO_SUCCESS && retry < SIGN_RETRIES; retry++) {
+				slot->retries++;
+				Status = sign_round(*(tps->CurveIsogeny), tps->PrivateKey, TempPubKey, sig->Randoms[r], sig->Commitments1[r], sig->Commitments2[r],
+				                    sig->psiS[r], sig->compPsiS[r], &(sig->compBit[r]), &(sig->basisHint[r]), tps->compressed,
+				                    NULL, NULL, NULL);
+			}
       #ifdef COMPARE_COMPRESSED_PSIS_PRINTS
-        printf("Sign round %d: ", r);
-        printf_digit_order("comp", tps->sig->compPsiS[r], NWORDS_ORDER);
+        if (tps->compressed) {
+          printf("Sign round %d: ", r);
+          printf_digit_order("comp", sig->compPsiS[r], NWORDS_ORDER);
+        }
       #endif
-      if (Status != CRYPTO_SUCCESS) {
-				if (Status == CRYPTO_ERROR_DURING_TEST) {
-          #ifdef TEST_RUN_PRINTS
-					printf("half_ph3 not working\n");
-          #endif
-				} else {
-          #ifdef TEST_RUN_PRINTS
-					printf("Error in psi(S) compression on round %d\n", r);
-          #endif
-				}
-				pthread_mutex_lock(&ELOCK);
-				errorCount++;
-				pthread_mutex_unlock(&ELOCK);
+			if (Status != CRYPTO_SUCCESS) {
+				slot->errorCount++;
+				slot->lastError = Status;
 			}
-		} else {
-			fp2copy751(tempPsiS->X, tps->sig->psiS[r]->X);
-			fp2copy751(tempPsiS->Z, tps->sig->psiS[r]->Z);
+
+			absorb_ready_rounds(ctx, sig, tps->pbytes, r);
 		}
+		next += n;
+	}
+
+	SIDH_batch_group_leave(ctx->batches);
+	return NULL;
+}
 
-		//check success of SecretAgreementB
 
-	}
+//completes the challenge of a signature whose rounds and response hashes are all filled in,
+//ks already holds the Commitments1 of the rounds before absorbed
+static void sign_finish(struct Signature *sig, unsigned int pbytes, keccak_state *ks, int absorbed) {
+	hash_commitments(ks, pbytes, sig->Commitments1, sig->Commitments2, sig->HashResp, absorbed);
+	keccak_squeeze(ks, sig->cHash);
+}
+
 
+//rounds a worker claims at once in unbatched signing: enough to fill the lanes of SecretAgreement_B_lanes,
+//as long as every core still gets a share of the rounds
+static int sign_chunk(int chunk, int lanes, int width) {
+	long cores = sysconf(_SC_NPROCESSORS_ONLN);
+	int share;
+
+	if (cores > 0 && cores < width) {
+		width = (int)cores;
+	}
+	share = NUM_ROUNDS / width;
+	if (share > lanes) {
+		share = lanes;
+	}
+	return (share > chunk) ? share : chunk;
 }
 
 
-CRYPTO_STATUS isogeny_sign(PCurveIsogenyStruct CurveIsogeny, unsigned char *PrivateKey, unsigned char *PublicKey, struct Signature *sig, int batched, int compressed) {
+static CRYPTO_STATUS sign_rounds(SignatureContext *ctx, unsigned char *PrivateKey, unsigned char *PublicKey, struct Signature *sig, int batched, int compressed) {
+	PCurveIsogenyStruct CurveIsogeny = ctx->CurveIsogeny;
 	unsigned int pbytes = (CurveIsogeny->pwordbits + 7)/8;          // Number of bytes in a field element
 	unsigned int pwords = NBITS_TO_NWORDS(CurveIsogeny->pwordbits); // Number of words in a curve element
 	unsigned int n, obytes = (CurveIsogeny->owordbits + 7)/8;       // Number of bytes in an element in [1, order]
@@ -195,117 +688,284 @@ CRYPTO_STATUS isogeny_sign(PCurveIsogenyStruct CurveIsogeny, unsigned char *Priv
 
 	// Run the ZKP rounds
 	int r;
-	pthread_t sign_threads[NUM_THREADS];
+	int width = (ctx->pool != NULL) ? ctx->pool->nworkers : NUM_THREADS;
 
-	CUR_ROUND = 0;
-	if (pthread_mutex_init(&RLOCK, NULL)) {
-    #ifdef TEST_RUN_PRINTS
-		printf("ERROR: mutex init failed\n");
-    #endif
-		return 1;
-	}
+	context_begin(ctx);
 
-	errorCount = 0;
-	if (pthread_mutex_init(&ELOCK, NULL)) {
-    #ifdef TEST_RUN_PRINTS
-		printf("ERROR: error counter mutex init failed\n");
-    #endif
-		return 1;
+	Status = signature_alloc(sig, pbytes, obytes);
+	if (Status != CRYPTO_SUCCESS) {
+		return Status;
 	}
+	sig->compressed = compressed;
 
-	thread_params_sign tps = {&CurveIsogeny, PrivateKey, PublicKey, sig, pbytes, n, obytes, compressed};
+	thread_params_sign tps = {ctx, &CurveIsogeny, PrivateKey, PublicKey, sig, pbytes, n, obytes, compressed, 1};
+	batch_struct **batches[3] = {&ctx->signBatchA, &ctx->signBatchB, &ctx->compressionBatch};
 
 	if (batched) {
-		signBatchA = (batch_struct*) malloc (sizeof(batch_struct));
-		signBatchA->batchSize = 248;
-		signBatchA->cntr = 0;
-		signBatchA->invArray = (f2elm_t*) malloc (248 * sizeof(f2elm_t));
-		signBatchA->invDest = (f2elm_t*) malloc (248 * sizeof(f2elm_t));
-		pthread_mutex_init(&signBatchA->arrayLock, NULL);
-		sem_init(&signBatchA->sign_sem, 0, 0);
-
-		signBatchB = (batch_struct*) malloc (sizeof(batch_struct));
-		signBatchB->batchSize = 248;
-		signBatchB->cntr = 0;
-		signBatchB->invArray = (f2elm_t*) malloc (248 * sizeof(f2elm_t));
-		signBatchB->invDest = (f2elm_t*) malloc (248 * sizeof(f2elm_t));
-		pthread_mutex_init(&signBatchB->arrayLock, NULL);
-		sem_init(&signBatchB->sign_sem, 0, 0);
+		//every worker takes part in every batch: an epoch fills with one round per worker
+		int want[3] = {1, 1, compressed};
+		int capacity = (width < NUM_ROUNDS) ? width : NUM_ROUNDS;
 
-    if (compressed) {
-      compressionBatch = (batch_struct*) malloc (sizeof(batch_struct));
-      compressionBatch->batchSize = 248;
-      compressionBatch->cntr = 0;
-      compressionBatch->invArray = (f2elm_t*) malloc (248 * sizeof(f2elm_t));
-      compressionBatch->invDest = (f2elm_t*) malloc (248 * sizeof(f2elm_t));
-      pthread_mutex_init(&compressionBatch->arrayLock, NULL);
-      sem_init(&compressionBatch->sign_sem, 0, 0);
-    } else {
-      compressionBatch = NULL;
-    }
+		Status = batches_alloc(ctx, batches, want, 3, capacity);
+		if (Status != CRYPTO_SUCCESS) {
+			goto cleanup;
+		}
+		run_round_workers(ctx, sign_thread, &tps, width);
 	} else {
-		signBatchA = NULL;
-		signBatchB = NULL;
-    compressionBatch = NULL;
+		tps.lanes = (int)SecretAgreement_B_lanes_width();
+		if (compressed && tps.lanes < BASIS_BATCH) {
+			tps.lanes = BASIS_BATCH;    //the basis searches of compressed rounds run together even without the 8-lane arithmetic
+		}
+		ctx->chunk = sign_chunk(ctx->chunk, tps.lanes, width);
+		run_round_workers(ctx, sign_thread, &tps, width);
 	}
+	context_collect(ctx);
 
+	if (ctx->errorCount > 0) {
+		//a round failed SIGN_RETRIES more times with fresh randomness: something is wrong beyond an unlucky R
+		Status = ctx->lastError;
+		goto cleanup;
+	}
 
-	int t;
-	for (t=0; t<NUM_THREADS; t++) {
-		if (pthread_create(&sign_threads[t], NULL, sign_thread, &tps)) {
-      #ifdef TEST_RUN_PRINTS
-			printf("ERROR: Failed to create thread %d\n", t);
-      #endif
+	//printf("Average time for ZKP round ...... %10lld cycles\n", totcycles/NUM_ROUNDS);
+
+	hash_signature_responses(sig, obytes, compressed);
+	sign_finish(sig, pbytes, &ctx->challenge, ctx->absorbed);
+
+
+cleanup:
+		if (batched) {
+			batches_free(ctx, batches, 3);
+		}
+		if (Status != CRYPTO_SUCCESS) {
+			signature_free(sig);
 		}
-	}
 
-	for (t=0; t<NUM_THREADS; t++) {
-		pthread_join(sign_threads[t], NULL);
-	}
 
-	if (errorCount > 0) {
-		//return CRYPTO_ERROR_INVALID_ORDER;
+	return Status;
+}
+
+
+CRYPTO_STATUS isogeny_sign(PCurveIsogenyStruct CurveIsogeny, unsigned char *PrivateKey, unsigned char *PublicKey, struct Signature *sig, int batched, int compressed) {
+	SignatureContext ctx;
+	CRYPTO_STATUS Status;
+
+	Status = context_init(&ctx, CurveIsogeny, NULL);
+	if (Status == CRYPTO_SUCCESS) {
+		Status = sign_rounds(&ctx, PrivateKey, PublicKey, sig, batched, compressed);
 	}
+	context_destroy(&ctx);
 
-	//printf("Average time for ZKP round ...... %10lld cycles\n", totcycles/NUM_ROUNDS);
+	return Status;
+}
 
-	// Commit to responses (hash)
-	int HashLength = 32; //bytes
-	sig->HashResp = calloc(2*NUM_ROUNDS, HashLength*sizeof(uint8_t));
 
-	for (r=0; r<NUM_ROUNDS; r++) {
-		keccak((uint8_t*) sig->Randoms[r], obytes, sig->HashResp+((2*r)*HashLength), HashLength);
-		if (sig->compressed) {
-			keccak((uint8_t*) sig->compPsiS[r], sizeof(digit_t) * NWORDS_ORDER, sig->HashResp+((2*r+1)*HashLength), HashLength);
+CRYPTO_STATUS isogeny_sign_ctx(SignatureContext *ctx, unsigned char *PrivateKey, unsigned char *PublicKey, struct Signature *sig, int batched, int compressed) {
+	CRYPTO_STATUS Status;
+
+	pthread_mutex_lock(&ctx->OPLOCK);
+	Status = sign_rounds(ctx, PrivateKey, PublicKey, sig, batched, compressed);
+	pthread_mutex_unlock(&ctx->OPLOCK);
+
+	return Status;
+}
+
+
+//refill thread of a commitment pool: computes rounds for as long as the pool has room for them
+static void *commitment_refill(void *arg) {
+	CommitmentPool *pool = (CommitmentPool*) arg;
+	unsigned int obytes = (pool->CurveIsogeny->owordbits + 7)/8;
+	unsigned char TempPubKey[4*2*NWORDS_FIELD*sizeof(digit_t)];
+	precomputed_round round;
+	CRYPTO_STATUS Status;
+
+	pthread_mutex_lock(&pool->lock);
+	while (!pool->shutdown) {
+		if (pool->count + pool->pending >= pool->capacity) {
+			pthread_cond_wait(&pool->not_full, &pool->lock);
+			continue;
+		}
+		pool->pending++;
+		pthread_mutex_unlock(&pool->lock);
+
+		memset(&round, 0, sizeof(precomputed_round));
+		Status = sign_round(pool->CurveIsogeny, pool->PrivateKey, TempPubKey, round.Random, round.Commitment1, round.Commitment2,
+		                    &round.psiS, round.compPsiS, &round.compBit, &round.basisHint, pool->compressed, NULL, NULL, NULL);
+		hash_round_responses(round.Random, obytes, &round.psiS, round.compPsiS, round.compBit, round.basisHint, pool->compressed, round.HashResp);
+
+		pthread_mutex_lock(&pool->lock);
+		pool->pending--;
+		if (Status != CRYPTO_SUCCESS) {
+			pool->failures++;
+			//rounds that keep failing with fresh randomness point at the key, not at an unlucky R: give up
+			if (++pool->failing > SIGN_RETRIES) {
+				pool->shutdown = 1;
+				pthread_cond_broadcast(&pool->not_full);
+				pthread_cond_broadcast(&pool->not_empty);
+			}
 		} else {
-			keccak((uint8_t*) sig->psiS[r], sizeof(point_proj), sig->HashResp+((2*r+1)*HashLength), HashLength);
+			pool->failing = 0;
+			pool->rounds[(pool->head + pool->count) % pool->capacity] = round;
+			pool->count++;
+			pool->produced++;
+			pthread_cond_signal(&pool->not_empty);
 		}
 	}
+	pthread_mutex_unlock(&pool->lock);
 
-	// Create challenge hash (by hashing all the commitments and HashResps)
-	uint8_t *datastring, *cHash;
-	int DataLength = (2 * NUM_ROUNDS * 2*pbytes) + (2 * NUM_ROUNDS * HashLength*sizeof(uint8_t));
-	int cHashLength = NUM_ROUNDS/8;
-	datastring = calloc(1, DataLength);
-	cHash = calloc(1, cHashLength);
+	clear_words((void*)&round, sizeof(precomputed_round)/sizeof(digit_t));
+	return NULL;
+}
 
-	hashdata(pbytes, sig->Commitments1, sig->Commitments2, sig->HashResp, HashLength, DataLength, datastring, cHash, cHashLength);
 
-	pthread_t compress_threads[NUM_THREADS/3];
+CommitmentPool* commitment_pool_create(PCurveIsogenyStruct CurveIsogeny, unsigned char *PrivateKey, int capacity, int nthreads, int compressed) {
+	unsigned int obytes = (CurveIsogeny->owordbits + 7)/8;
+	CommitmentPool *pool;
+	int t;
 
+	if (capacity <= 0) {
+		return NULL;
+	}
+	if (nthreads <= 0) {
+		nthreads = pool_default_size();
+	}
 
-cleanup:
-		if (batched) {
-			free(signBatchA->invArray);
-			free(signBatchA->invDest);
-			free(signBatchB->invArray);
-			free(signBatchB->invDest);
-      if (compressed) {
-        free(compressionBatch->invArray);
-        free(compressionBatch->invDest);
-      }
+	pool = (CommitmentPool*) calloc (1, sizeof(CommitmentPool));
+	if (pool == NULL) {
+		return NULL;
+	}
+	pool->CurveIsogeny = CurveIsogeny;
+	pool->compressed = compressed;
+	pool->capacity = capacity;
+	pool->PrivateKey = (unsigned char*) calloc (1, obytes);
+	pool->rounds = (precomputed_round*) calloc (capacity, sizeof(precomputed_round));
+	pool->threads = (pthread_t*) calloc (nthreads, sizeof(pthread_t));
+	pthread_mutex_init(&pool->lock, NULL);
+	pthread_cond_init(&pool->not_empty, NULL);
+	pthread_cond_init(&pool->not_full, NULL);
+
+	if (pool->PrivateKey == NULL || pool->rounds == NULL || pool->threads == NULL) {
+		commitment_pool_free(pool);
+		return NULL;
+	}
+	memcpy(pool->PrivateKey, PrivateKey, obytes);
+
+	for (t=0; t<nthreads; t++) {
+		if (pthread_create(&pool->threads[t], NULL, commitment_refill, pool)) {
+			break;
+		}
+	}
+	pool->nthreads = t;
+
+	if (pool->nthreads == 0) {
+		commitment_pool_free(pool);
+		return NULL;
+	}
+
+	return pool;
+}
+
+
+void commitment_pool_free(CommitmentPool *pool) {
+	unsigned int obytes;
+	int t;
+
+	if (pool == NULL) return;
+
+	pthread_mutex_lock(&pool->lock);
+	pool->shutdown = 1;
+	pthread_cond_broadcast(&pool->not_full);
+	pthread_cond_broadcast(&pool->not_empty);
+	pthread_mutex_unlock(&pool->lock);
+
+	for (t=0; t<pool->nthreads; t++) {
+		pthread_join(pool->threads[t], NULL);
+	}
+
+	// Precomputed rounds hold secret randomness, clear them before releasing the memory
+	if (pool->rounds != NULL) {
+		clear_words((void*)pool->rounds, pool->capacity * sizeof(precomputed_round)/sizeof(digit_t));
+	}
+	if (pool->PrivateKey != NULL) {
+		obytes = (pool->CurveIsogeny->owordbits + 7)/8;
+		memset(pool->PrivateKey, 0, obytes);
+	}
+
+	pthread_cond_destroy(&pool->not_empty);
+	pthread_cond_destroy(&pool->not_full);
+	pthread_mutex_destroy(&pool->lock);
+	free(pool->rounds);
+	free(pool->threads);
+	free(pool->PrivateKey);
+	free(pool);
+}
+
+
+int commitment_pool_available(CommitmentPool *pool) {
+	int count;
+
+	pthread_mutex_lock(&pool->lock);
+	count = pool->count;
+	pthread_mutex_unlock(&pool->lock);
+
+	return count;
+}
+
+
+CRYPTO_STATUS isogeny_sign_online(CommitmentPool *pool, struct Signature *sig) {
+	unsigned int pbytes = (pool->CurveIsogeny->pwordbits + 7)/8;
+	unsigned int obytes = (pool->CurveIsogeny->owordbits + 7)/8;
+	CRYPTO_STATUS Status;
+	keccak_state ks;
+	int r = 0;
+
+	Status = signature_alloc(sig, pbytes, obytes);
+	if (Status != CRYPTO_SUCCESS) {
+		return Status;
+	}
+	sig->compressed = pool->compressed;
+	keccak_init(&ks, NUM_ROUNDS/8);
+
+	// Take the rounds in order of production, as many at a time as are ready; each one is used exactly once
+	pthread_mutex_lock(&pool->lock);
+	while (r < NUM_ROUNDS) {
+		while (pool->count == 0 && !pool->shutdown) {
+			pthread_cond_wait(&pool->not_empty, &pool->lock);
 		}
+		if (pool->count == 0) {
+			Status = CRYPTO_ERROR;
+			break;
+		}
+
+		for (; r < NUM_ROUNDS && pool->count > 0; r++) {
+			precomputed_round *round = &pool->rounds[pool->head];
+
+			memcpy(sig->Randoms[r], round->Random, obytes);
+			memcpy(sig->Commitments1[r], round->Commitment1, 2*pbytes);
+			memcpy(sig->Commitments2[r], round->Commitment2, 2*pbytes);
+			memcpy(sig->HashResp + (2*r)*HASH_LENGTH, round->HashResp, 2*HASH_LENGTH);
+			keccak_absorb(&ks, sig->Commitments1[r], 2*pbytes);
+			if (pool->compressed) {
+				copy_words(round->compPsiS, sig->compPsiS[r], NWORDS_ORDER);
+				sig->compBit[r] = round->compBit;
+				sig->basisHint[r] = round->basisHint;
+			} else {
+				copy_words((digit_t*)&round->psiS, (digit_t*)sig->psiS[r], 2*2*NWORDS_FIELD);
+			}
+			clear_words((void*)round, sizeof(precomputed_round)/sizeof(digit_t));
 
+			pool->head = (pool->head + 1) % pool->capacity;
+			pool->count--;
+		}
+		pthread_cond_broadcast(&pool->not_full);
+	}
+	pthread_mutex_unlock(&pool->lock);
+
+	if (Status == CRYPTO_SUCCESS) {
+		sign_finish(sig, pbytes, &ks, NUM_ROUNDS);
+	} else {
+		signature_free(sig);
+	}
 
 	return Status;
 }
@@ -313,12 +973,15 @@ cleanup:
 
 
 typedef struct thread_params_verify {
+	SignatureContext *ctx;
 	PCurveIsogenyStruct *CurveIsogeny;
-	unsigned char *PublicKey;
-	struct Signature *sig;
+	unsigned char **PublicKeys;
+	const PreparedPublicKey **Prepared;  //prepared form of every public key, NULL where the raw key has to be used
+	struct Signature **sigs;
 
 	int cHashLength;
-	uint8_t *cHash;
+	uint8_t (*cHash)[NUM_ROUNDS/8];     //challenge of every signature
+	int *errors;                        //failed rounds of every signature
 
 	unsigned int pbytes;
 	unsigned int n;
@@ -327,47 +990,56 @@ typedef struct thread_params_verify {
 	int compressed;
 } thread_params_verify;
 
+//a round is abandoned once it or another round of its signature has failed
+static int stop_round(thread_params_verify *tpv, int s, bool verified) {
+	return !verified || __atomic_load_n(&tpv->errors[s], __ATOMIC_RELAXED) != 0;
+}
+
 void *verify_thread(void *TPV) {
 	CRYPTO_STATUS Status = CRYPTO_SUCCESS;
 	thread_params_verify *tpv = (thread_params_verify*) TPV;
+	SignatureContext *ctx = tpv->ctx;
 
 	// iterate through cHash bits as challenge and verify
 	bool verified = true;
-	int r=0;
+	round_slot *slot = claim_slot(ctx);
+	unsigned char *TempPubKey = slot_scratch(ctx, slot);
+	unsigned char *TempSharSec = TempPubKey + 4*2*tpv->pbytes;
+	struct Signature *sig;
+	unsigned char *PublicKey;
+	uint8_t *cHash;
+	const int *cancel;
+	int r=0, s=0, next=0, last=0;
 	int i,j;
 
 	while (1) {
-		int stop=0;
 		verified = true;
 
-		pthread_mutex_lock(&RLOCK);
-		if (CUR_ROUND >= NUM_ROUNDS) {
-			stop=1;
-		} else {
-			r = CUR_ROUND;
-			CUR_ROUND++;
-		}
-		pthread_mutex_unlock(&RLOCK);
+		if (next == last && !claim_rounds(ctx, slot, &next, &last)) break;
+		r = next++;
+
+		//the rounds of all the signatures being verified are numbered consecutively
+		s = r / NUM_ROUNDS;
+		r = r % NUM_ROUNDS;
+		sig = tpv->sigs[s];
+		PublicKey = tpv->PublicKeys[s];
+		cHash = tpv->cHash[s];
+		cancel = &tpv->errors[s];
 
-		if (stop) break;
+		if (stop_round(tpv, s, verified)) continue;
 
 		//printf("\nround: %d ", CUR_ROUND);
 		i = r/8;
 		j = r%8;
 
-		int bit = tpv->cHash[i] & (1 << j);  //challenge bit
+		int bit = cHash[i] & (1 << j);  //challenge bit
+		unsigned long long cycles = cpucycles();
 
 		if (bit == 0) {
-			pthread_mutex_lock(&BLOCK);
-			if (verifyBatchA != NULL && verifyBatchB != NULL) {
-				verifyBatchA->batchSize++;
-				verifyBatchB->batchSize++;
-			}
-			pthread_mutex_unlock(&BLOCK);
 			//printf("round %d: bit 0 - ", r);
 
 			// Check R, phi(R) has order 2^372 (suffices to check that the random number is even)
-			uint8_t lastbyte = ((uint8_t*) tpv->sig->Randoms[r])[0];
+			uint8_t lastbyte = ((uint8_t*) sig->Randoms[r])[0];
 			if (lastbyte % 2) {
         #ifdef TEST_RUN_PRINTS
 				printf("ERROR: R, phi(R) are not full order\n");
@@ -378,10 +1050,8 @@ void *verify_thread(void *TPV) {
 
 			// Check kernels
 			f2elm_t A;
-			unsigned char *TempPubKey;
-			TempPubKey = (unsigned char*)calloc(1, 4*2*tpv->pbytes);
 
-			Status = KeyGeneration_A(tpv->sig->Randoms[r], TempPubKey, *(tpv->CurveIsogeny), false, verifyBatchA);
+			Status = KeyGeneration_A(sig->Randoms[r], TempPubKey, *(tpv->CurveIsogeny), false, ctx->verifyBatchA);
 
 			if(Status != CRYPTO_SUCCESS) {
         #ifdef TEST_RUN_PRINTS
@@ -394,18 +1064,21 @@ void *verify_thread(void *TPV) {
 
 			to_fp2mont(((f2elm_t*)TempPubKey)[0], A);
 
-			int cmp = memcmp(A, tpv->sig->Commitments1[r], sizeof(f2elm_t));
+			int cmp = memcmp(A, sig->Commitments1[r], sizeof(f2elm_t));
 			if (cmp != 0) {
 				verified = false;
         #ifdef TEST_RUN_PRINTS
 				printf("verifying E -> E/<R> failed\n");
         #endif
 			}
+			if (stop_round(tpv, s, verified)) goto round_done;
 
-			unsigned char *TempSharSec;
-			TempSharSec = (unsigned char*)calloc(1, 2*tpv->pbytes);
-
-			Status = SecretAgreement_A(tpv->sig->Randoms[r], tpv->PublicKey, TempSharSec, *(tpv->CurveIsogeny), NULL, verifyBatchB);
+			if (tpv->Prepared[s] != NULL) {
+				Status = SecretAgreement_Prepared_A(sig->Randoms[r], tpv->Prepared[s], TempSharSec, *(tpv->CurveIsogeny), ctx->verifyBatchB, cancel);
+			} else {
+				Status = SecretAgreement_A(sig->Randoms[r], PublicKey, TempSharSec, *(tpv->CurveIsogeny), NULL, ctx->verifyBatchB, cancel);
+			}
+			if (Status == CRYPTO_ERROR_CANCELLED) goto round_done;
 			if(Status != CRYPTO_SUCCESS) {
         #ifdef TEST_RUN_PRINTS
 				printf("Computing E/<S> -> E/<R,S> failed");
@@ -414,7 +1087,7 @@ void *verify_thread(void *TPV) {
 				//printf("%s %d: thread success of SecAgrA\n", __FILE__, __LINE__);
 			}
 
-			cmp = memcmp(TempSharSec, tpv->sig->Commitments2[r], 2*tpv->pbytes);
+			cmp = memcmp(TempSharSec, sig->Commitments2[r], 2*tpv->pbytes);
 			if (cmp != 0) {
 				verified = false;
         #ifdef TEST_RUN_PRINTS
@@ -423,71 +1096,54 @@ void *verify_thread(void *TPV) {
 			}
 
 		} else {
-			pthread_mutex_lock(&BLOCK);
-			if (verifyBatchC != NULL) {
-				verifyBatchC->batchSize++;
-        if (decompressionBatch != NULL) {
-          decompressionBatch->batchSize++;
-        }
-			}
-			pthread_mutex_unlock(&BLOCK);
-
-			// Check psi(S) has order 3^239 (need to triple it 239 times)
+			// Check psi(S) has order 3^239 and generates the kernel of E1 -> E2
 			point_proj_t triple = {0};
 			point_proj_t newPsiS = {0};
-			f2elm_t A,C={0};
-			fp2copy751(tpv->sig->Commitments1[r], A);
+			f2elm_t A;
+			fp2copy751(sig->Commitments1[r], A);
 
 			if (tpv->compressed) {
         #ifdef COMPARE_COMPRESSED_PSIS_PRINTS
           printf("Verify round %d: ", r);
-          printf_digit_order("comp", tpv->sig->compPsiS[r], NWORDS_ORDER);
+          printf_digit_order("comp", sig->compPsiS[r], NWORDS_ORDER);
         #endif
-				Status = decompressPsiS(tpv->sig->compPsiS[r], triple, tpv->sig->compBit[r], A, *(tpv->CurveIsogeny), decompressionBatch);
-        //Status = decompressPsiS_test(tpv->sig->compPsiS[r], triple, tpv->sig->compBit[r], A, *(tpv->CurveIsogeny), a, b);
+				Status = decompressPsiS(sig->compPsiS[r], triple, sig->compBit[r], sig->basisHint[r], A, *(tpv->CurveIsogeny), ctx->decompressionBatch);
+        //Status = decompressPsiS_test(sig->compPsiS[r], triple, sig->compBit[r], A, *(tpv->CurveIsogeny), a, b);
 
         if (Status != CRYPTO_SUCCESS) {
           #ifdef TEST_RUN_PRINTS
 					printf("Error in psi(S) decompression\n");
           #endif
-					errorCount++;
+					verified = false;
 				} else {
 					copy_words((digit_t*)triple, (digit_t*)newPsiS, 2*2*NWORDS_FIELD);
 				}
 			} else {
-				copy_words((digit_t*)tpv->sig->psiS[r], (digit_t*)triple, 2*2*NWORDS_FIELD);
-				copy_words((digit_t*)tpv->sig->psiS[r], (digit_t*)newPsiS, 2*2*NWORDS_FIELD);
+				copy_words((digit_t*)sig->psiS[r], (digit_t*)newPsiS, 2*2*NWORDS_FIELD);
 			}
 
-			to_fp2mont(((f2elm_t*)tpv->PublicKey)[0],A);
-			fpcopy751((*(tpv->CurveIsogeny))->C, C[0]);
-			int t;
-			for (t=0; t<238; t++) {
-				xTPL(triple, triple, A, C); //triple psiS to check if order(psiS) = 3^239
-				if (is_felm_zero(((felm_t*)triple->Z)[0]) && is_felm_zero(((felm_t*)triple->Z)[1])) {
-          #ifdef TEST_RUN_PRINTS
-          printf("ERROR: psi(S) has order 3^%d\n", t+1);
-          #endif
-          break;
-				}
-			}
+			if (stop_round(tpv, s, verified)) goto round_done;
 
-			unsigned char *TempSharSec, *TempPubKey;
-			TempSharSec = calloc(1, 2*tpv->pbytes);
-			TempPubKey = calloc(1, 4*2*tpv->pbytes);
-			from_fp2mont(tpv->sig->Commitments1[r], ((f2elm_t*)TempPubKey)[0]);
+			from_fp2mont(sig->Commitments1[r], ((f2elm_t*)TempPubKey)[0]);
 
-			//if this secret agreement is successful, we know psiS has order la^ea and generates the kernel of E1 -> E2
+			//the isogeny walk checks that psi(S) has order 3^239 as it goes, and the comparison below that it generates
+			//the kernel of E1 -> E2
 			//can we do this in a method simpler and quicker using only a & b where psiS = [a]R1 + [b]R2
-			Status = SecretAgreement_B(NULL, TempPubKey, TempSharSec, *(tpv->CurveIsogeny), newPsiS, NULL, verifyBatchC);
-			if(Status != CRYPTO_SUCCESS) {
+			Status = SecretAgreement_B(NULL, TempPubKey, TempSharSec, *(tpv->CurveIsogeny), newPsiS, NULL, ctx->verifyBatchC, cancel);
+			if (Status == CRYPTO_ERROR_CANCELLED) goto round_done;
+			if (Status == CRYPTO_ERROR_INVALID_ORDER) {
+				verified = false;
+        #ifdef TEST_RUN_PRINTS
+				printf("ERROR: psi(S) does not have order 3^239\n");
+        #endif
+			} else if(Status != CRYPTO_SUCCESS) {
         #ifdef TEST_RUN_PRINTS
 				printf("Computing E/<R> -> E/<R,S> failed");
         #endif
 			}
 
       //only look at x in affine otherwise false negatives
-			int cmp = memcmp(TempSharSec, tpv->sig->Commitments2[r], 2*tpv->pbytes);
+			int cmp = memcmp(TempSharSec, sig->Commitments2[r], 2*tpv->pbytes);
 			if (cmp != 0) {
 				verified = false;
         #ifdef TEST_RUN_PRINTS
@@ -495,148 +1151,463 @@ void *verify_thread(void *TPV) {
         #endif
 			}
 
-			if (tpv->sig->compressed) {
-				if (!verified) {
-					pthread_mutex_lock(&ELOCK);
-					errorCount++;
-					pthread_mutex_unlock(&ELOCK);
-          #ifdef COMPRESSION_TEST_PRINTS
-					printf("Error in verify on round %d\n", r);
-          #endif
-				}
+		}
+
+round_done:
+		//a failed round rejects its signature and, through stop_round, cancels the signature's other rounds
+		if (!verified) {
+			__atomic_fetch_add(&tpv->errors[s], 1, __ATOMIC_RELAXED);
+      #ifdef COMPRESSION_TEST_PRINTS
+			printf("Error in verify on round %d\n", r);
+      #endif
+		}
+		slot->roundCycles[bit != 0] += cpucycles() - cycles;
+
+	}
+
+	SIDH_batch_group_leave(ctx->batches);
+	return NULL;
+}
+
+
+//challenge bit of round g of the signatures being verified, counting their rounds consecutively
+static int challenge_bit(uint8_t (*cHash)[NUM_ROUNDS/8], int g) {
+	int r = g % NUM_ROUNDS;
+	return (cHash[g/NUM_ROUNDS][r/8] >> (r%8)) & 1;
+}
+
+//deals the verify rounds out to nqueues worker queues: the more expensive class of rounds first, each round to the
+//queue with the least estimated work so far, so that every queue ends with its cheapest rounds. Workers whose
+//queue runs dry steal from the back of the others'
+static CRYPTO_STATUS schedule_rounds(SignatureContext *ctx, uint8_t (*cHash)[NUM_ROUNDS/8], int total, int nqueues, int compressed) {
+	unsigned long long *cost = ctx->roundCost[compressed != 0];
+	int *queueOf = (int*) malloc (total * sizeof(int));
+	int *fill = (int*) calloc (nqueues + 1, sizeof(int));
+	unsigned long long *load = (unsigned long long*) calloc (nqueues, sizeof(unsigned long long));
+	int costly = (cost[1] >= cost[0]);
+	int pass, bit, r, q, least;
+
+	ctx->order = (int*) malloc (total * sizeof(int));
+	if (queueOf == NULL || fill == NULL || load == NULL || ctx->order == NULL) {
+		free(queueOf);
+		free(fill);
+		free(load);
+		free(ctx->order);
+		ctx->order = NULL;
+		return CRYPTO_ERROR_NO_MEMORY;
+	}
+
+	for (pass=0; pass<2; pass++) {
+		bit = (pass == 0) ? costly : !costly;
+		for (r=0; r<total; r++) {
+			if (challenge_bit(cHash, r) != bit) continue;
+			least = 0;
+			for (q=1; q<nqueues; q++) {
+				if (load[q] < load[least]) least = q;
+			}
+			load[least] += cost[bit];
+			queueOf[r] = least;
+			fill[least + 1]++;
+		}
+	}
+
+	for (q=0; q<nqueues; q++) {
+		fill[q + 1] += fill[q];
+		ctx->slots[q].queue = (unsigned long long) fill[q] | ((unsigned long long) fill[q + 1] << 32);
+	}
+	for (pass=0; pass<2; pass++) {
+		bit = (pass == 0) ? costly : !costly;
+		for (r=0; r<total; r++) {
+			if (challenge_bit(cHash, r) == bit) {
+				ctx->order[fill[queueOf[r]]++] = r;
 			}
+		}
+	}
+	ctx->nqueues = nqueues;
+
+	free(queueOf);
+	free(fill);
+	free(load);
+	return CRYPTO_SUCCESS;
+}
+
+//returns the prepared form of PublicKey, preparing it in place of the least recently used entry of the context's cache
+//when it is not there. Entries the running operation already uses are not evicted; NULL once all of them are
+static const PreparedPublicKey* prepared_key_lookup(SignatureContext *ctx, const unsigned char *PublicKey, size_t length) {
+	prepared_key *victim = NULL;
+	int i;
 
+	for (i=0; i<PREPARED_KEYS; i++) {
+		prepared_key *entry = &ctx->preparedKeys[i];
+
+		if (entry->PublicKey != NULL && memcmp(entry->PublicKey, PublicKey, length) == 0) {
+			entry->lastUse = ctx->verifications;
+			ctx->stats.preparedHits++;
+			return entry->Prepared;
+		}
+		if (entry->lastUse != ctx->verifications && (victim == NULL || entry->lastUse < victim->lastUse)) {
+			victim = entry;
 		}
+	}
+	if (victim == NULL) {
+		return NULL;
+	}
 
+	if (victim->PublicKey == NULL) {
+		victim->PublicKey = (unsigned char*) malloc (length);
+		victim->Prepared = (PreparedPublicKey*) malloc (sizeof(PreparedPublicKey));
 	}
+	if (victim->PublicKey == NULL || victim->Prepared == NULL ||
+	    PublicKeyPreparation_B(PublicKey, victim->Prepared, ctx->CurveIsogeny) != CRYPTO_SUCCESS) {
+		free(victim->PublicKey);
+		free(victim->Prepared);
+		memset(victim, 0, sizeof(prepared_key));
+		return NULL;
+	}
+	memcpy(victim->PublicKey, PublicKey, length);
+	victim->lastUse = ctx->verifications;
+	ctx->stats.preparedMisses++;
 
+	return victim->Prepared;
 }
 
 
-CRYPTO_STATUS isogeny_verify(PCurveIsogenyStruct CurveIsogeny, unsigned char *PublicKey, struct Signature *sig, int batched, int compressed) {
+//verifies nsigs signatures with their rounds on one shared queue and, when batched, in shared inversion batches;
+//challenges is NULL when they have to be recomputed from the signatures' commitments and response hashes
+static CRYPTO_STATUS verify_many(SignatureContext *ctx, int nsigs, unsigned char **PublicKeys, struct Signature **sigs, uint8_t (*challenges)[NUM_ROUNDS/8], CRYPTO_STATUS *verdicts, int batched, int compressed) {
+	PCurveIsogenyStruct CurveIsogeny = ctx->CurveIsogeny;
 	unsigned int pbytes = (CurveIsogeny->pwordbits + 7)/8;      // Number of bytes in a field element
 	unsigned int n, obytes = (CurveIsogeny->owordbits + 7)/8;   // Number of bytes in an element in [1, order]
-	unsigned long long cycles, cycles1, cycles2, totcycles=0;
 	CRYPTO_STATUS Status = CRYPTO_SUCCESS;
-	bool passed;
 
-	int r;
+	int r, s, total = nsigs * NUM_ROUNDS;
 
-	// compute challenge hash
-	int HashLength = 32;
+	// compute challenge hashes
 	int cHashLength = NUM_ROUNDS/8;
-	int DataLength = (2 * NUM_ROUNDS * 2*pbytes) + (2 * NUM_ROUNDS * HashLength*sizeof(uint8_t));
-	uint8_t *datastring, *cHash;
-	datastring = calloc(1, DataLength);
-	cHash = calloc(1, cHashLength);
+	uint8_t (*cHash)[NUM_ROUNDS/8] = challenges;
+	const PreparedPublicKey **Prepared;
+	int *errors;
 
-	hashdata(pbytes, sig->Commitments1, sig->Commitments2, sig->HashResp, HashLength, DataLength, datastring, cHash, cHashLength);
-
-	// Run the verifying rounds
-	pthread_t verify_threads[NUM_THREADS];
+	if (nsigs <= 0) {
+		return CRYPTO_ERROR_INVALID_PARAMETER;
+	}
 
-	//initialize mutexes and cross-thread variables
-	CUR_ROUND = 0;
-	if (pthread_mutex_init(&RLOCK, NULL)) {
-    #ifdef TEST_RUN_PRINTS
-		printf("ERROR: mutex init failed\n");
-    #endif
-		return 1;
+	errors = (int*) calloc (nsigs, sizeof(int));
+	Prepared = (const PreparedPublicKey**) calloc (nsigs, sizeof(PreparedPublicKey*));
+	if (cHash == NULL) {
+		cHash = (uint8_t (*)[NUM_ROUNDS/8]) malloc (nsigs * sizeof(*cHash));
+	}
+	if (errors == NULL || Prepared == NULL || cHash == NULL) {
+		Status = CRYPTO_ERROR_NO_MEMORY;
+		goto cleanup;
 	}
 
-	errorCount = 0;
-	if (pthread_mutex_init(&ELOCK, NULL)) {
-    #ifdef TEST_RUN_PRINTS
-		printf("ERROR: mutex init failed\n");
-    #endif
-		return 1;
+	if (challenges == NULL) {
+		for (s=0; s<nsigs; s++) {
+			challenge_hash(pbytes, sigs[s], cHash[s]);
+		}
 	}
 
-	thread_params_verify tpv = {&CurveIsogeny, PublicKey, sig, cHashLength, cHash, pbytes, n, obytes, compressed};
+	// Run the verifying rounds
+	int width = (ctx->pool != NULL) ? ctx->pool->nworkers : NUM_THREADS;
 
-  int bit;
-  for (int iter=0; iter<NUM_THREADS; iter++) {
-    int hash_index = iter/8;
-    int word_shift = iter%8;
-    bit = tpv.cHash[hash_index] & (1 << word_shift);
-    if (bit != 0) {
-      psiS_count++;
-    }
-  }
+	context_begin(ctx);
+	ctx->endRound = total;
 
-	if (batched) {
-		verifyBatchA = (batch_struct*) malloc (sizeof(batch_struct));
-		verifyBatchA->batchSize = 0;//248 - psiS_count;
-		verifyBatchA->cntr = 0;
-		verifyBatchA->invArray = (f2elm_t*) malloc (batchSize * sizeof(f2elm_t));
-		verifyBatchA->invDest = (f2elm_t*) malloc (batchSize * sizeof(f2elm_t));
-		pthread_mutex_init(&verifyBatchA->arrayLock, NULL);
-		sem_init(&verifyBatchA->sign_sem, 0, 0);
-
-		verifyBatchB = (batch_struct*) malloc (sizeof(batch_struct));
-		verifyBatchB->batchSize = 0;//248 - psiS_count;
-		verifyBatchB->cntr = 0;
-		verifyBatchB->invArray = (f2elm_t*) malloc (batchSize * sizeof(f2elm_t));
-		verifyBatchB->invDest = (f2elm_t*) malloc (batchSize * sizeof(f2elm_t));
-		pthread_mutex_init(&verifyBatchB->arrayLock, NULL);
-		sem_init(&verifyBatchB->sign_sem, 0, 0);
-
-		verifyBatchC = (batch_struct*) malloc (sizeof(batch_struct));
-		verifyBatchC->batchSize = 0;//psiS_count;
-		verifyBatchC->cntr = 0;
-		verifyBatchC->invArray = (f2elm_t*) malloc (batchSize * sizeof(f2elm_t));
-		verifyBatchC->invDest = (f2elm_t*) malloc (batchSize * sizeof(f2elm_t));
-		pthread_mutex_init(&verifyBatchC->arrayLock, NULL);
-		sem_init(&verifyBatchC->sign_sem, 0, 0);
+	//the bit-0 rounds run against the signer's key, converted once and kept for the next verifications under it
+	ctx->verifications++;
+	for (s=0; s<nsigs; s++) {
+		Prepared[s] = prepared_key_lookup(ctx, PublicKeys[s], 4*2*pbytes);
+	}
 
-    if (compressed) {
-      decompressionBatch = (batch_struct*) malloc (sizeof(batch_struct));
-      decompressionBatch->batchSize = 0;//psiS_count;
-      decompressionBatch->cntr = 0;
-      decompressionBatch->invArray = (f2elm_t*) malloc (batchSize * sizeof(f2elm_t));
-      decompressionBatch->invDest = (f2elm_t*) malloc (batchSize * sizeof(f2elm_t));
-      pthread_mutex_init(&decompressionBatch->arrayLock, NULL);
-      sem_init(&decompressionBatch->sign_sem, 0, 0);
-    } else {
-      decompressionBatch = NULL;
-    }
-	} else {
-		verifyBatchA = NULL;
-		verifyBatchB = NULL;
-		verifyBatchC = NULL;
-    decompressionBatch = NULL;
+	thread_params_verify tpv = {ctx, &CurveIsogeny, PublicKeys, Prepared, sigs, cHashLength, cHash, errors, pbytes, n, obytes, compressed};
+	batch_struct **batches[4] = {&ctx->verifyBatchA, &ctx->verifyBatchB, &ctx->verifyBatchC, &ctx->decompressionBatch};
+
+	for (r=0; r<total; r++) {
+		if (challenge_bit(cHash, r)) {
+			ctx->psiS_count++;
+		}
 	}
 
-	int t;
-	for (t=0; t<NUM_THREADS; t++) {
-		if (pthread_create(&verify_threads[t], NULL, verify_thread, &tpv)) {
-      #ifdef TEST_RUN_PRINTS
-			printf("ERROR: Failed to create thread %d\n", t);
-      #endif
+	int nqueues = (width < total) ? width : total;
+
+	if (batched) {
+		//bit-0 rounds meet in batches A and B, bit-1 rounds in C (and decompression); whichever the workers are
+		//waiting in when none of them is left running closes, so the mix of rounds needs no planning.
+		//the rounds of several signatures share the inversions
+		int want[4] = {1, 1, 1, compressed};
+
+		Status = batches_alloc(ctx, batches, want, 4, nqueues);
+		if (Status != CRYPTO_SUCCESS) {
+			goto cleanup;
 		}
 	}
 
-	for (t=0; t<NUM_THREADS; t++) {
-		pthread_join(verify_threads[t], NULL);
+	Status = schedule_rounds(ctx, cHash, total, nqueues, compressed);
+	if (Status != CRYPTO_SUCCESS) {
+		goto cleanup;
+	}
+	run_round_workers(ctx, verify_thread, &tpv, nqueues);
+	context_collect(ctx);
+
+	for (s=0; s<nsigs; s++) {
+		ctx->errorCount += errors[s];
+		verdicts[s] = (errors[s] > 0) ? CRYPTO_ERROR_INVALID_ORDER : CRYPTO_SUCCESS;
+		if (verdicts[s] != CRYPTO_SUCCESS && Status == CRYPTO_SUCCESS) {
+			Status = verdicts[s];
+		}
 	}
 
-	if (errorCount > 0) {
-		return CRYPTO_ERROR_INVALID_ORDER;
+	if (!batched && ctx->errorCount == 0) {
+		//batched rounds also wait for each other at the inversions, so only unbatched runs refine the estimates;
+		//after a failure, the cancelled rounds of the rejected signatures would count at next to no cycles
+		unsigned long long *cost = ctx->roundCost[compressed != 0];
+		if (ctx->psiS_count > 0) {
+			cost[1] = (cost[1] + ctx->stats.roundCycles[1] / ctx->psiS_count) / 2;
+		}
+		if (ctx->psiS_count < total) {
+			cost[0] = (cost[0] + ctx->stats.roundCycles[0] / (total - ctx->psiS_count)) / 2;
+		}
 	}
 
 cleanup:
 		if (batched) {
-			free(verifyBatchA->invArray);
-			free(verifyBatchA->invDest);
-			free(verifyBatchB->invArray);
-			free(verifyBatchB->invDest);
-			free(verifyBatchC->invArray);
-			free(verifyBatchC->invDest);
-      if (compressed) {
-        free(decompressionBatch->invArray);
-        free(decompressionBatch->invDest);
-      }
+			batches_free(ctx, batches, 4);
 		}
+		if (challenges == NULL) {
+			free(cHash);
+		}
+		free(errors);
+		free(Prepared);
+		free(ctx->order);
+		ctx->order = NULL;
 
     return Status;
 }
+
+
+CRYPTO_STATUS isogeny_verify(PCurveIsogenyStruct CurveIsogeny, unsigned char *PublicKey, struct Signature *sig, int batched, int compressed) {
+	SignatureContext ctx;
+	CRYPTO_STATUS Status, verdict;
+
+	Status = context_init(&ctx, CurveIsogeny, NULL);
+	if (Status == CRYPTO_SUCCESS) {
+		Status = verify_many(&ctx, 1, &PublicKey, &sig, NULL, &verdict, batched, compressed);
+	}
+	context_destroy(&ctx);
+
+	return Status;
+}
+
+
+CRYPTO_STATUS isogeny_verify_ctx(SignatureContext *ctx, unsigned char *PublicKey, struct Signature *sig, int batched, int compressed) {
+	CRYPTO_STATUS Status, verdict;
+
+	pthread_mutex_lock(&ctx->OPLOCK);
+	Status = verify_many(ctx, 1, &PublicKey, &sig, NULL, &verdict, batched, compressed);
+	pthread_mutex_unlock(&ctx->OPLOCK);
+
+	return Status;
+}
+
+
+CRYPTO_STATUS isogeny_verify_batch(PCurveIsogenyStruct CurveIsogeny, int nsigs, unsigned char **PublicKeys, struct Signature **sigs, CRYPTO_STATUS *verdicts, int batched, int compressed) {
+	SignatureContext ctx;
+	CRYPTO_STATUS Status;
+
+	Status = context_init(&ctx, CurveIsogeny, NULL);
+	if (Status == CRYPTO_SUCCESS) {
+		Status = verify_many(&ctx, nsigs, PublicKeys, sigs, NULL, verdicts, batched, compressed);
+	}
+	context_destroy(&ctx);
+
+	return Status;
+}
+
+
+CRYPTO_STATUS isogeny_verify_batch_ctx(SignatureContext *ctx, int nsigs, unsigned char **PublicKeys, struct Signature **sigs, CRYPTO_STATUS *verdicts, int batched, int compressed) {
+	CRYPTO_STATUS Status;
+
+	pthread_mutex_lock(&ctx->OPLOCK);
+	Status = verify_many(ctx, nsigs, PublicKeys, sigs, NULL, verdicts, batched, compressed);
+	pthread_mutex_unlock(&ctx->OPLOCK);
+
+	return Status;
+}
+
+
+//bytes of the response opened in a round with the given challenge bit, and of the response hash sent in its place
+static size_t response_bytes(PCurveIsogenyStruct CurveIsogeny, int bit, int compressed) {
+	if (bit == 0) {
+		return (CurveIsogeny->owordbits + 7)/8;
+	}
+	return compressed ? COMP_RESPONSE_BYTES : sizeof(point_proj);
+}
+
+static size_t wire_length(PCurveIsogenyStruct CurveIsogeny, const uint8_t *cHash, int compressed) {
+	unsigned int pbytes = (CurveIsogeny->pwordbits + 7)/8;
+	size_t length = WIRE_HEADER_BYTES + 2 * NUM_ROUNDS * 2*(size_t)pbytes;
+	int r;
+
+	for (r=0; r<NUM_ROUNDS; r++) {
+		int bit = (cHash[r/8] >> (r%8)) & 1;
+		length += response_bytes(CurveIsogeny, bit, compressed) + HASH_LENGTH;
+	}
+	return length;
+}
+
+
+size_t signature_wire_length(PCurveIsogenyStruct CurveIsogeny, const struct Signature *sig) {
+	return wire_length(CurveIsogeny, sig->cHash, sig->compressed);
+}
+
+
+CRYPTO_STATUS signature_serialize(PCurveIsogenyStruct CurveIsogeny, const struct Signature *sig, unsigned char *out, size_t outlen) {
+	unsigned int pbytes = (CurveIsogeny->pwordbits + 7)/8;
+	unsigned char *p = out;
+	int r;
+
+	if (outlen < signature_wire_length(CurveIsogeny, sig)) {
+		return CRYPTO_ERROR_INVALID_PARAMETER;
+	}
+
+	*p++ = sig->compressed ? WIRE_COMPRESSED : 0;
+	memcpy(p, sig->cHash, NUM_ROUNDS/8);
+	p += NUM_ROUNDS/8;
+
+	//commitments first, in the order they are hashed into the challenge
+	for (r=0; r<NUM_ROUNDS; r++, p += 2*pbytes) {
+		memcpy(p, sig->Commitments1[r], 2*pbytes);
+	}
+	for (r=0; r<NUM_ROUNDS; r++, p += 2*pbytes) {
+		memcpy(p, sig->Commitments2[r], 2*pbytes);
+	}
+
+	//then, per round, the response selected by the challenge bit and the hash of the other one
+	for (r=0; r<NUM_ROUNDS; r++) {
+		int bit = (sig->cHash[r/8] >> (r%8)) & 1;
+		size_t length = response_bytes(CurveIsogeny, bit, sig->compressed);
+
+		if (bit == 0) {
+			memcpy(p, sig->Randoms[r], length);
+		} else if (sig->compressed) {
+			pack_comp_response(sig->compPsiS[r], sig->compBit[r], sig->basisHint[r], p);
+		} else {
+			memcpy(p, sig->psiS[r], length);
+		}
+		p += length;
+
+		memcpy(p, sig->HashResp + (2*r + (1 - bit))*HASH_LENGTH, HASH_LENGTH);
+		p += HASH_LENGTH;
+	}
+
+	return CRYPTO_SUCCESS;
+}
+
+
+//points a signature view at the fields of a serialized signature, recomputes the response hashes and checks them against the challenge
+static CRYPTO_STATUS wire_parse(SignatureContext *ctx, const unsigned char *bytes, size_t length, struct Signature *view) {
+	PCurveIsogenyStruct CurveIsogeny = ctx->CurveIsogeny;
+	unsigned int pbytes = (CurveIsogeny->pwordbits + 7)/8;
+	size_t commitBytes = NUM_ROUNDS * 2*(size_t)pbytes;
+	uint8_t HashResp[2*HASH_LENGTH];
+	uint8_t cHash[NUM_ROUNDS/8];
+	keccak_state ks;
+	const unsigned char *p;
+	int r;
+
+	if (length < WIRE_HEADER_BYTES || (bytes[0] & ~WIRE_COMPRESSED) != 0) {
+		return CRYPTO_ERROR_INVALID_PARAMETER;
+	}
+	view->compressed = (bytes[0] & WIRE_COMPRESSED) ? 1 : 0;
+	memcpy(view->cHash, bytes + 1, NUM_ROUNDS/8);
+	if (length != wire_length(CurveIsogeny, view->cHash, view->compressed)) {
+		return CRYPTO_ERROR_INVALID_PARAMETER;
+	}
+
+	p = bytes + WIRE_HEADER_BYTES;
+	for (r=0; r<NUM_ROUNDS; r++) {
+		view->Commitments1[r] = (unsigned char*)p + r*2*pbytes;
+		view->Commitments2[r] = (unsigned char*)p + commitBytes + r*2*pbytes;
+	}
+	// the commitments are laid out as the challenge hashes them, the response hashes follow round by round
+	keccak_init(&ks, NUM_ROUNDS/8);
+	keccak_absorb(&ks, p, 2*commitBytes);
+	p += 2*commitBytes;
+
+	for (r=0; r<NUM_ROUNDS; r++) {
+		int bit = (view->cHash[r/8] >> (r%8)) & 1;
+		size_t rlength = response_bytes(CurveIsogeny, bit, view->compressed);
+
+		if (bit == 0) {
+			view->Randoms[r] = (unsigned char*)p;
+			keccak((uint8_t*)p, rlength, HashResp, HASH_LENGTH);
+		} else if (view->compressed) {
+			unsigned int hint[2];
+
+			// only one encoding per response: compBit is a bit and the hint is either absent or one unpack_basis_hint accepts
+			unpack_basis_hint(p[rlength - 1], hint);
+			if (p[rlength - 2] > 1 || (p[rlength - 1] != 0 && hint[0] == 0)) {
+				return CRYPTO_ERROR_INVALID_PARAMETER;
+			}
+			memcpy(view->compPsiS[r], p, rlength - WIRE_COMP_EXTRA);
+			view->compBit[r] = p[rlength - 2];
+			view->basisHint[r] = p[rlength - 1];
+			keccak((uint8_t*)p, rlength, HashResp + HASH_LENGTH, HASH_LENGTH);
+		} else {
+			view->psiS[r] = (point_proj*)p;
+			keccak((uint8_t*)p, rlength, HashResp + HASH_LENGTH, HASH_LENGTH);
+		}
+		p += rlength;
+
+		memcpy(HashResp + (1 - bit)*HASH_LENGTH, p, HASH_LENGTH);
+		p += HASH_LENGTH;
+		keccak_absorb(&ks, HashResp, 2*HASH_LENGTH);
+	}
+
+	keccak_squeeze(&ks, cHash);
+	if (memcmp(cHash, view->cHash, NUM_ROUNDS/8) != 0) {
+		return CRYPTO_ERROR;
+	}
+
+	return CRYPTO_SUCCESS;
+}
+
+
+static CRYPTO_STATUS verify_bytes(SignatureContext *ctx, unsigned char *PublicKey, const unsigned char *sigBytes, size_t length, int batched) {
+	struct Signature view;
+	CRYPTO_STATUS Status, verdict;
+
+	Status = wire_parse(ctx, sigBytes, length, &view);
+	if (Status != CRYPTO_SUCCESS) {
+		return Status;
+	}
+	struct Signature *sig = &view;
+
+	return verify_many(ctx, 1, &PublicKey, &sig, &view.cHash, &verdict, batched, view.compressed);
+}
+
+
+CRYPTO_STATUS isogeny_verify_bytes(PCurveIsogenyStruct CurveIsogeny, unsigned char *PublicKey, const unsigned char *sigBytes, size_t length, int batched) {
+	SignatureContext ctx;
+	CRYPTO_STATUS Status;
+
+	Status = context_init(&ctx, CurveIsogeny, NULL);
+	if (Status == CRYPTO_SUCCESS) {
+		Status = verify_bytes(&ctx, PublicKey, sigBytes, length, batched);
+	}
+	context_destroy(&ctx);
+
+	return Status;
+}
+
+
+CRYPTO_STATUS isogeny_verify_bytes_ctx(SignatureContext *ctx, unsigned char *PublicKey, const unsigned char *sigBytes, size_t length, int batched) {
+	CRYPTO_STATUS Status;
+
+	pthread_mutex_lock(&ctx->OPLOCK);
+	Status = verify_bytes(ctx, PublicKey, sigBytes, length, batched);
+	pthread_mutex_unlock(&ctx->OPLOCK);
+
+	return Status;
+}
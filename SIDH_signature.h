@@ -10,12 +10,20 @@
 *********************************************************************************************/
 
 #include "SIDH_internal.h"
+#include "thread_pool.h"
+#include "keccak.h"
 
 #define NUM_ROUNDS       248
 #define COMPRESS_ROUNDS  83
+#define HASH_LENGTH      32    //bytes per response hash
+#define SIGN_RETRIES     8     //times a failed signing round is redone with fresh randomness before signing gives up
+#define PREPARED_KEYS    8     //public keys a context keeps prepared for verification
 
-//signature structure
+extern int ROUND_CHUNK;    //default number of rounds claimed per dispenser operation
+
+//signature structure; every per-round buffer lives in one arena owned by the signature, released with signature_free
 struct Signature {
+	unsigned char *arena;
 	unsigned char *Commitments1[NUM_ROUNDS];
 	unsigned char *Commitments2[NUM_ROUNDS];
 	unsigned char *HashResp;
@@ -30,7 +38,10 @@ struct Signature {
 	//};
 
 	int compBit[NUM_ROUNDS];
+	uint8_t basisHint[NUM_ROUNDS];  //torsion basis search counters from compressPsiS, spare the verifier the search
 	int compressed;
+
+	uint8_t cHash[NUM_ROUNDS/8];    //challenge, one bit per round selecting the response that is opened
 };
 
 typedef struct thread_params_compress {
@@ -43,6 +54,118 @@ typedef struct thread_params_compress {
 	unsigned int obytes;
 } thread_params_compress;
 
+//one signing round computed ahead of time by a commitment pool
+typedef struct {
+	unsigned char Random[NWORDS_ORDER*sizeof(digit_t)];
+	unsigned char Commitment1[2*NWORDS_FIELD*sizeof(digit_t)];
+	unsigned char Commitment2[2*NWORDS_FIELD*sizeof(digit_t)];
+	point_proj psiS;
+	digit_t compPsiS[NWORDS_ORDER];
+	int compBit;
+	uint8_t basisHint;
+	uint8_t HashResp[2*HASH_LENGTH];
+} precomputed_round;
+
+//bounded pool of precomputed rounds for one key pair, kept full by background threads
+typedef struct {
+	PCurveIsogenyStruct CurveIsogeny;
+	unsigned char *PrivateKey;          //copy of the signing key the rounds are computed for
+	int compressed;
+
+	precomputed_round *rounds;          //ring buffer of capacity rounds
+	int capacity;
+	int head;                           //oldest precomputed round
+	int count;                          //rounds ready to be used
+	int pending;                        //rounds being computed by the refill threads
+	unsigned long long produced;        //rounds computed since the pool was created
+	unsigned long long failures;        //rounds discarded because they could not be completed
+	int failing;                        //rounds discarded since the last one completed
+
+	int nthreads;
+	pthread_t *threads;
+	pthread_mutex_t lock;
+	pthread_cond_t not_empty;           //signalled when a round is added
+	pthread_cond_t not_full;            //signalled when rounds are taken
+	int shutdown;
+} CommitmentPool;
+
+//per-worker result slot, padded to its own cache line so workers never write to a shared line
+typedef struct {
+	int errorCount;
+	int retries;                        //signing rounds this worker redid after they failed
+	CRYPTO_STATUS lastError;            //status of the last round this worker gave up on
+	char pad[4];
+	unsigned long long claims;          //dispenser operations performed by this worker
+	unsigned long long claimCycles;     //cycles spent claiming rounds
+	unsigned long long queue;           //verify rounds queued for this worker: [head, tail) of ctx->order, head in the low half
+	unsigned long long steals;          //rounds taken from other workers' queues
+	unsigned long long roundCycles[2];  //cycles spent in verify rounds, by challenge bit
+} round_slot;
+
+//statistics of the last operation run on a context
+typedef struct {
+	int workers;                        //workers that took part
+	int retries;                        //signing rounds redone with fresh randomness after they failed
+	unsigned long long claims;          //total dispenser operations
+	unsigned long long claimCycles;     //total cycles spent in the dispenser
+	unsigned long long steals;          //verify rounds run by a worker other than the one they were queued for
+	unsigned long long roundCycles[2];  //total cycles of the bit-0 and bit-1 verify rounds
+	int preparedHits;                   //public keys found already prepared
+	int preparedMisses;                 //public keys prepared by the operation
+	unsigned long long invEpochs;       //epochs of the inversion batches, in batched operations
+	unsigned long long invElements;     //inversions handed in to the batches
+	unsigned long long invTimeouts;     //epochs closed by the timeout rather than by a full batch or idle workers
+	int invMaxBatch;                    //largest epoch
+} SignatureStats;
+
+//public key kept in its prepared form (see PublicKeyPreparation_B) by a context
+typedef struct {
+	unsigned char *PublicKey;           //copy of the key, NULL while the entry is unused
+	PreparedPublicKey *Prepared;
+	unsigned long long lastUse;         //verify operation that last used the entry
+} prepared_key;
+
+//signing context: owns a long-lived worker pool and all the state of one sign/verify operation,
+//so that independent contexts can be used concurrently from different threads
+typedef struct {
+	PCurveIsogenyStruct CurveIsogeny;
+	worker_pool *pool;                  //NULL when the rounds run on threads spawned per call
+
+	int roundChunk;                     //rounds handed out per dispenser operation
+	prepared_key preparedKeys[PREPARED_KEYS];  //least recently used cache of the public keys verified under
+	unsigned long long verifications;   //verify operations run on the context, stamps the use of the prepared keys
+	unsigned long long roundCost[2][2]; //estimated cycles of a bit-0 and a bit-1 verify round, uncompressed and compressed,
+	                                    //refined by every unbatched verify
+	int nslots;
+	round_slot *slots;                  //one result slot per worker
+	unsigned char *scratch;             //one block of temporary keys per worker, indexed like slots
+
+	//per-operation state, reset at the start of every sign/verify
+	int curRound;                       //next round to be claimed, advanced with an atomic fetch-add
+	int endRound;                       //rounds [curRound, endRound) are still to be claimed
+	int chunk;                          //rounds per claim for the running operation
+	int nextSlot;                       //next free result slot
+	int *order;                         //verify rounds grouped by worker queue, NULL when rounds are claimed in index order
+	int nqueues;
+	int errorCount;                     //sum of the slots' error counts once the workers are done
+	CRYPTO_STATUS lastError;            //status of a round given up on, set when errorCount > 0
+	SignatureStats stats;
+	keccak_state challenge;             //challenge sponge of the signature being produced
+	int absorbed;                       //rounds whose Commitments1 are already in the sponge
+	unsigned char roundReady[NUM_ROUNDS];
+	int psiS_count;
+	batch_struct *signBatchA;
+	batch_struct *signBatchB;
+	batch_struct *verifyBatchA;
+	batch_struct *verifyBatchB;
+	batch_struct *verifyBatchC;
+	batch_struct *compressionBatch;
+	batch_struct *decompressionBatch;
+	batch_group *batches;               //group of the batches above, NULL when the operation is unbatched
+	pthread_mutex_t HASHLOCK;           //held by the worker absorbing finished rounds
+	pthread_mutex_t OPLOCK;             //serializes operations issued on the same context
+} SignatureContext;
+
 //compressed signature structure
 
 CRYPTO_STATUS isogeny_keygen(PCurveIsogenyStruct CurveIsogeny, unsigned char *PrivateKey, unsigned char *PublicKey);
@@ -51,6 +174,56 @@ void *sign_thread(void *TPS);
 
 CRYPTO_STATUS isogeny_sign(PCurveIsogenyStruct CurveIsogeny, unsigned char *PrivateKey, unsigned char *PublicKey, struct Signature *sig, int batched, int compressed);
 
+// Release the buffers filled in by isogeny_sign; sig can be signed into again afterwards.
+// Signing into a sig that still holds buffers releases them first, and a failed sign leaves none behind
+void signature_free(struct Signature *sig);
+
 void *verify_thread(void *TPV);
 
 CRYPTO_STATUS isogeny_verify(PCurveIsogenyStruct CurveIsogeny, unsigned char *PublicKey, struct Signature *sig, int batched, int compressed);
+
+// Allocate a signing context with a pool of nworkers threads (nworkers <= 0 uses one per online core). Returns NULL on error.
+// Operations on one context are serialized; use one context per concurrent sign/verify.
+SignatureContext* signature_context_allocate(PCurveIsogenyStruct CurveIsogeny, int nworkers);
+
+// Stop the context's workers and free it
+void signature_context_free(SignatureContext *ctx);
+
+// Set how many consecutive rounds a worker claims at once (default ROUND_CHUNK)
+void signature_context_set_chunk(SignatureContext *ctx, int chunk);
+
+// Same as isogeny_sign/isogeny_verify, but the rounds are run on the context's worker pool instead of NUM_THREADS fresh threads
+CRYPTO_STATUS isogeny_sign_ctx(SignatureContext *ctx, unsigned char *PrivateKey, unsigned char *PublicKey, struct Signature *sig, int batched, int compressed);
+
+// Offline/online signing. A commitment pool precomputes up to capacity rounds for one key pair on nthreads background
+// threads (nthreads <= 0 uses one per online core). isogeny_sign_online then only takes NUM_ROUNDS of them, waiting for
+// the refill threads if fewer are ready, and hashes them. Rounds are never reused. Once more than SIGN_RETRIES rounds in
+// a row have failed, the refill threads stop and isogeny_sign_online returns CRYPTO_ERROR when the pool runs dry.
+CommitmentPool* commitment_pool_create(PCurveIsogenyStruct CurveIsogeny, unsigned char *PrivateKey, int capacity, int nthreads, int compressed);
+
+void commitment_pool_free(CommitmentPool *pool);
+
+// Number of precomputed rounds ready to be used
+int commitment_pool_available(CommitmentPool *pool);
+
+CRYPTO_STATUS isogeny_sign_online(CommitmentPool *pool, struct Signature *sig);
+
+CRYPTO_STATUS isogeny_verify_ctx(SignatureContext *ctx, unsigned char *PublicKey, struct Signature *sig, int batched, int compressed);
+
+// Verify nsigs (public key, signature) pairs at once: the rounds of all of them go through one work queue and,
+// when batched, share the inversion batches. verdicts[i] receives what isogeny_verify returns for pair i;
+// the return value is CRYPTO_SUCCESS only if every signature verified.
+CRYPTO_STATUS isogeny_verify_batch(PCurveIsogenyStruct CurveIsogeny, int nsigs, unsigned char **PublicKeys, struct Signature **sigs, CRYPTO_STATUS *verdicts, int batched, int compressed);
+
+CRYPTO_STATUS isogeny_verify_batch_ctx(SignatureContext *ctx, int nsigs, unsigned char **PublicKeys, struct Signature **sigs, CRYPTO_STATUS *verdicts, int batched, int compressed);
+
+// Serialized signatures carry only the commitments, the response selected by the challenge for every round
+// and the hash of the other response. signature_wire_length gives the exact size of sig once serialized.
+size_t signature_wire_length(PCurveIsogenyStruct CurveIsogeny, const struct Signature *sig);
+
+CRYPTO_STATUS signature_serialize(PCurveIsogenyStruct CurveIsogeny, const struct Signature *sig, unsigned char *out, size_t outlen);
+
+// Verify a serialized signature in place; the rounds read their inputs straight from sigBytes
+CRYPTO_STATUS isogeny_verify_bytes(PCurveIsogenyStruct CurveIsogeny, unsigned char *PublicKey, const unsigned char *sigBytes, size_t length, int batched);
+
+CRYPTO_STATUS isogeny_verify_bytes_ctx(SignatureContext *ctx, unsigned char *PublicKey, const unsigned char *sigBytes, size_t length, int batched);
@@ -0,0 +1,554 @@
+/********************************************************************************************
+* SIDH: an efficient supersingular isogeny-based cryptography library for ephemeral
+*       Diffie-Hellman key exchange.
+*
+*    Copyright (c) Microsoft Corporation. All rights reserved.
+*
+*
+* Abstract: inversion batches shared by concurrent threads
+*
+*********************************************************************************************/
+
+#include "SIDH_internal.h"
+#include "thread_pool.h"
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <sched.h>
+
+#define BATCH_CLOSED   0x80000000u     // Set in the slot count of an epoch closed before it filled up
+
+
+static void deadline_after(struct timespec *deadline, long usec)
+{ // deadline = now + usec microseconds, on the clock the batch conditions wait on
+	clock_gettime(CLOCK_MONOTONIC, deadline);
+	deadline->tv_sec += usec / 1000000;
+	deadline->tv_nsec += (usec % 1000000) * 1000;
+	if (deadline->tv_nsec >= 1000000000) {
+		deadline->tv_sec++;
+		deadline->tv_nsec -= 1000000000;
+	}
+}
+
+
+static digit_t fp_zero_mask(const felm_t a)
+{ // All ones if a = 0, zero otherwise, computed without branching on a
+	felm_t t;
+	digit_t c = 0;
+	unsigned int i;
+
+	fpcopy751(a, t);
+	fpcorrection751(t);
+	for (i = 0; i < NWORDS_FIELD; i++) {
+		c |= t[i];
+	}
+	return 0 - (digit_t)is_digit_zero_ct(c);
+}
+
+
+static void batch_chunk(batch_epoch* buf, int phase, int j, int size)
+{ // Runs one pass of Montgomery's trick over chunk j of a closed epoch
+	int i, lo = j*buf->chunk, hi = lo + buf->chunk;
+	felm_t t, inv;
+	digit_t mask;
+
+	if (hi > size) {
+		hi = size;
+	}
+	if (phase == 1) {
+		// den = a0^2 + a1^2, which is zero only for a = 0. Any nonzero den does for a zero, whose result is 0 anyway
+		for (i = lo; i < hi; i++) {
+			fpsqr751_mont(buf->elems[i][0], t);
+			fpsqr751_mont(buf->elems[i][1], buf->den[i]);
+			fpadd751(t, buf->den[i], buf->den[i]);
+			mask = fp_zero_mask(buf->den[i]);
+			buf->den[i][0] |= mask & 1;
+			if (i == lo) {
+				fpcopy751(buf->den[i], buf->prefix[i]);
+			} else {
+				fpmul751_mont(buf->prefix[i-1], buf->den[i], buf->prefix[i]);
+			}
+		}
+		fpcopy751(buf->prefix[hi-1], buf->total[j]);
+	} else {
+		// total[j] now holds the inverse of the product of the chunk, 1/a = conj(a)/den
+		fpcopy751(buf->total[j], t);
+		for (i = hi - 1; i >= lo; i--) {
+			if (i > lo) {
+				fpmul751_mont(t, buf->prefix[i-1], inv);
+				fpmul751_mont(t, buf->den[i], t);
+			} else {
+				fpcopy751(t, inv);
+			}
+			fpmul751_mont(buf->elems[i][0], inv, buf->results[i][0]);
+			fpneg751(buf->elems[i][1]);
+			fpmul751_mont(buf->elems[i][1], inv, buf->results[i][1]);
+		}
+	}
+}
+
+
+static void batch_root(batch_epoch* buf, int ntasks)
+{ // Replaces the products of the chunks by their inverses, with a single inversion
+	felm_t inv, t;
+	int j;
+
+	fpcopy751(buf->total[0], buf->acc[0]);
+	for (j = 1; j < ntasks; j++) {
+		fpmul751_mont(buf->acc[j-1], buf->total[j], buf->acc[j]);
+	}
+	fpcopy751(buf->acc[ntasks-1], inv);
+	fpinv751_mont(inv);
+	for (j = ntasks - 1; j > 0; j--) {
+		fpmul751_mont(inv, buf->acc[j-1], t);
+		fpmul751_mont(inv, buf->total[j], inv);
+		fpcopy751(t, buf->total[j]);
+	}
+	fpcopy751(inv, buf->total[0]);
+}
+
+
+static void batch_run_tasks(batch_struct* batch, batch_epoch* buf, int size)
+{ // Claims chunks of the posted pass until none are left
+	int j, ntasks = __atomic_load_n(&buf->ntasks, __ATOMIC_ACQUIRE);
+
+	while ((j = __atomic_fetch_add(&buf->nextTask, 1, __ATOMIC_ACQ_REL)) < ntasks) {
+		batch_chunk(buf, buf->phase, j, size);
+		if (__atomic_add_fetch(&buf->doneTasks, 1, __ATOMIC_ACQ_REL) == ntasks) {
+			pthread_mutex_lock(&batch->lock);
+			pthread_cond_broadcast(&batch->changed);
+			pthread_mutex_unlock(&batch->lock);
+		}
+	}
+}
+
+
+static void batch_pass(batch_struct* batch, batch_epoch* buf, int phase, int ntasks, int size)
+{ // Runs a pass over all chunks, shared with the threads waiting on the epoch
+	if (ntasks == 1) {
+		batch_chunk(buf, phase, 0, size);
+		return;
+	}
+	pthread_mutex_lock(&batch->lock);
+	buf->phase = phase;
+	buf->doneTasks = 0;
+	__atomic_store_n(&buf->nextTask, 0, __ATOMIC_RELEASE);
+	__atomic_store_n(&buf->ntasks, ntasks, __ATOMIC_RELEASE);
+	pthread_cond_broadcast(&batch->changed);
+	pthread_mutex_unlock(&batch->lock);
+
+	batch_run_tasks(batch, buf, size);
+
+	pthread_mutex_lock(&batch->lock);
+	while (__atomic_load_n(&buf->doneTasks, __ATOMIC_ACQUIRE) < ntasks) {
+		pthread_cond_wait(&batch->changed, &batch->lock);
+	}
+	pthread_mutex_unlock(&batch->lock);
+}
+
+
+static void batch_combine(batch_struct* batch, unsigned int epoch, int size, unsigned long long* reason)
+{ // Inverts a closed epoch of size elements, after opening the next one
+	batch_epoch* buf = &batch->buf[epoch & 1];
+	batch_epoch* next = &batch->buf[(epoch + 1) & 1];
+	int ntasks = (size + BATCH_CHUNK - 1) / BATCH_CHUNK;
+
+	__atomic_sub_fetch(&batch->group->waiting, size, __ATOMIC_ACQ_REL);
+
+	// the next epoch reuses the buffer of the previous one, which may still be inverting or have helpers
+	// claiming its tasks: one of them resuming after the reset below would run a chunk of the new epoch
+	pthread_mutex_lock(&batch->lock);
+	while (!next->done || next->helpers > 0) {
+		pthread_cond_wait(&batch->changed, &batch->lock);
+	}
+	next->seq = epoch + 1;
+	next->done = false;
+	next->written = 0;
+	next->ntasks = 0;
+	next->nextTask = 0;
+	__atomic_store_n(&batch->state, (unsigned long long)(epoch + 1) << 32, __ATOMIC_RELEASE);
+	batch->stats.flushes++;
+	batch->stats.elements += size;
+	(*reason)++;
+	if (size > batch->stats.maxSize) {
+		batch->stats.maxSize = size;
+	}
+	pthread_cond_broadcast(&batch->changed);
+	pthread_mutex_unlock(&batch->lock);
+
+	// slots reserved before the epoch closed may still be being written
+	while (__atomic_load_n(&buf->written, __ATOMIC_ACQUIRE) < size) {
+		sched_yield();
+	}
+
+	batch_pass(batch, buf, 1, ntasks, size);
+	batch_root(buf, ntasks);
+	batch_pass(batch, buf, 2, ntasks, size);
+
+	pthread_mutex_lock(&batch->lock);
+	buf->done = true;
+	pthread_cond_broadcast(&batch->changed);
+	pthread_mutex_unlock(&batch->lock);
+}
+
+
+static bool batch_close(batch_struct* batch, unsigned int epoch, unsigned long long* reason)
+{ // Closes epoch before it fills up, if it is still open and not empty. The thread that closes it inverts it.
+	unsigned long long s = __atomic_load_n(&batch->state, __ATOMIC_ACQUIRE);
+	unsigned int count;
+
+	do {
+		count = (unsigned int)s;
+		if ((unsigned int)(s >> 32) != epoch || count == 0 || (count & BATCH_CLOSED) || count >= (unsigned int)batch->batchSize) {
+			return false;
+		}
+	} while (!__atomic_compare_exchange_n(&batch->state, &s, s | BATCH_CLOSED, false, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE));
+
+	batch_combine(batch, epoch, (int)count, reason);
+	return true;
+}
+
+
+static void batch_group_settle(batch_group* group)
+{ // Once every member waits, nobody is left to fill the open epochs: all of them are closed
+	int i, members = __atomic_load_n(&group->members, __ATOMIC_ACQUIRE);
+	batch_struct* batch;
+
+	if (members <= 0 || __atomic_load_n(&group->waiting, __ATOMIC_ACQUIRE) < members) {
+		return;
+	}
+	for (i = 0; i < group->nbatches; i++) {
+		batch = group->batches[i];
+		batch_close(batch, (unsigned int)(__atomic_load_n(&batch->state, __ATOMIC_ACQUIRE) >> 32), &batch->stats.idle);
+	}
+}
+
+
+static void batch_wait(batch_struct* batch, unsigned int epoch)
+{ // Waits until epoch is inverted, helping with its passes and closing it on timeout
+	batch_epoch* buf = &batch->buf[epoch & 1];
+	long timeout = batch->group->timeout;
+	unsigned long long s;
+	struct timespec deadline;
+	bool open;
+
+	if (timeout > 0) {
+		deadline_after(&deadline, timeout);
+	}
+	pthread_mutex_lock(&batch->lock);
+	while (buf->seq == epoch && !buf->done) {
+		if (__atomic_load_n(&buf->nextTask, __ATOMIC_ACQUIRE) < __atomic_load_n(&buf->ntasks, __ATOMIC_ACQUIRE)) {
+			buf->helpers++;
+			pthread_mutex_unlock(&batch->lock);
+			batch_run_tasks(batch, buf, __atomic_load_n(&buf->written, __ATOMIC_ACQUIRE));
+			pthread_mutex_lock(&batch->lock);
+			if (--buf->helpers == 0) {
+				pthread_cond_broadcast(&batch->changed);
+			}
+			continue;
+		}
+		s = __atomic_load_n(&batch->state, __ATOMIC_ACQUIRE);
+		open = ((unsigned int)(s >> 32) == epoch && !((unsigned int)s & BATCH_CLOSED));
+		if (timeout <= 0 || !open) {
+			pthread_cond_wait(&batch->changed, &batch->lock);
+		} else if (pthread_cond_timedwait(&batch->changed, &batch->lock, &deadline) == ETIMEDOUT) {
+			pthread_mutex_unlock(&batch->lock);
+			batch_close(batch, epoch, &batch->stats.timeouts);
+			pthread_mutex_lock(&batch->lock);
+		}
+	}
+	pthread_mutex_unlock(&batch->lock);
+}
+
+
+void batch_invert(f2elm_t a, batch_struct* batch)
+{ // a = 1/a, inverted together with the other elements of its epoch (0 stays 0)
+	batch_group* group = batch->group;
+	batch_epoch* buf;
+	unsigned long long s = __atomic_load_n(&batch->state, __ATOMIC_ACQUIRE);
+	unsigned int epoch, slot;
+
+	// reserve a slot of the open epoch, or wait for the next one to open if it is closed
+	while (1) {
+		epoch = (unsigned int)(s >> 32);
+		slot = (unsigned int)s;
+		if ((slot & BATCH_CLOSED) || slot >= (unsigned int)batch->batchSize) {
+			pthread_mutex_lock(&batch->lock);
+			while ((unsigned int)(__atomic_load_n(&batch->state, __ATOMIC_ACQUIRE) >> 32) == epoch) {
+				pthread_cond_wait(&batch->changed, &batch->lock);
+			}
+			pthread_mutex_unlock(&batch->lock);
+			s = __atomic_load_n(&batch->state, __ATOMIC_ACQUIRE);
+			continue;
+		}
+		if (__atomic_compare_exchange_n(&batch->state, &s, s + 1, false, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)) {
+			break;
+		}
+	}
+
+	buf = &batch->buf[epoch & 1];
+	fp2copy751(a, buf->elems[slot]);
+	buf->results[slot] = a;
+	__atomic_add_fetch(&buf->written, 1, __ATOMIC_RELEASE);
+	__atomic_add_fetch(&group->waiting, 1, __ATOMIC_ACQ_REL);
+
+	if (slot + 1 == (unsigned int)batch->batchSize) {
+		batch_combine(batch, epoch, batch->batchSize, &batch->stats.full);
+	} else {
+		batch_group_settle(group);
+	}
+	batch_wait(batch, epoch);
+}
+
+
+typedef struct {
+	batch_epoch* buf;
+	int phase;
+	int size;
+} pool_pass;
+
+
+static void* pool_pass_job(void* arg)
+{ // Pool job claiming chunks of a pass of batched_inv_pool
+	pool_pass* pass = (pool_pass*)arg;
+	int j;
+
+	while ((j = __atomic_fetch_add(&pass->buf->nextTask, 1, __ATOMIC_ACQ_REL)) < pass->buf->ntasks) {
+		batch_chunk(pass->buf, pass->phase, j, pass->size);
+	}
+	return NULL;
+}
+
+
+static void pool_pass_run(batch_epoch* buf, int phase, int size, worker_pool* pool, int nworkers)
+{
+	pool_pass pass = {buf, phase, size};
+	int j;
+
+	if (pool == NULL || nworkers < 2 || buf->ntasks < 2) {
+		for (j = 0; j < buf->ntasks; j++) {
+			batch_chunk(buf, phase, j, size);
+		}
+		return;
+	}
+	buf->nextTask = 0;
+	pool_run(pool, pool_pass_job, &pass, nworkers);
+}
+
+
+CRYPTO_STATUS batched_inv_pool(const f2elm_t* vec, f2elm_t* dest, const int n, worker_pool* pool, int nworkers)
+{ // dest[i] = 1/vec[i] for n elements (0 stays 0), vec and dest may be the same.
+  // The elements are split into a few chunks per worker, whose products are inverted together in one inversion.
+	batch_epoch buf = {0};
+	unsigned char* arena;
+	size_t words;
+	int i;
+
+	if (n <= 0) {
+		return CRYPTO_SUCCESS;
+	}
+	if (pool == NULL || nworkers < 1) {
+		nworkers = 1;
+	} else if (nworkers > pool->nworkers) {
+		nworkers = pool->nworkers;
+	}
+	buf.chunk = (n + 4*nworkers - 1) / (4*nworkers);
+	if (buf.chunk < BATCH_CHUNK) {
+		buf.chunk = BATCH_CHUNK;
+	}
+	buf.ntasks = (n + buf.chunk - 1) / buf.chunk;
+
+	// one block for all the scratch: elements, den, prefix, total, acc, then the result pointers
+	words = (size_t)NWORDS_FIELD * (4*(size_t)n + 2*(size_t)buf.ntasks);
+	arena = (unsigned char*)malloc(words * sizeof(digit_t) + n * sizeof(felm_t*));
+	if (arena == NULL) {
+		return CRYPTO_ERROR_NO_MEMORY;
+	}
+	buf.elems = (f2elm_t*)arena;
+	buf.den = (felm_t*)(buf.elems + n);
+	buf.prefix = buf.den + n;
+	buf.total = buf.prefix + n;
+	buf.acc = buf.total + buf.ntasks;
+	buf.results = (felm_t**)(buf.acc + buf.ntasks);
+	for (i = 0; i < n; i++) {
+		fp2copy751(vec[i], buf.elems[i]);
+		buf.results[i] = dest[i];
+	}
+
+	pool_pass_run(&buf, 1, n, pool, nworkers);
+	batch_root(&buf, buf.ntasks);
+	pool_pass_run(&buf, 2, n, pool, nworkers);
+
+	clear_words((void*)arena, words);
+	free(arena);
+	return CRYPTO_SUCCESS;
+}
+
+
+batch_group* SIDH_batch_group_allocate(long timeout)
+{
+	batch_group* group = (batch_group*)calloc(1, sizeof(batch_group));
+
+	if (group == NULL) {
+		return NULL;
+	}
+	group->timeout = (timeout > 0) ? timeout : 0;
+	pthread_mutex_init(&group->lock, NULL);
+	return group;
+}
+
+
+void SIDH_batch_group_free(batch_group* group)
+{
+	if (group == NULL) return;
+	pthread_mutex_destroy(&group->lock);
+	free(group);
+}
+
+
+void SIDH_batch_group_begin(batch_group* group, int members)
+{
+	int i;
+
+	if (group == NULL) return;
+	pthread_mutex_lock(&group->lock);
+	__atomic_store_n(&group->members, (members > 0) ? members : 0, __ATOMIC_RELEASE);
+	__atomic_store_n(&group->waiting, 0, __ATOMIC_RELEASE);
+	for (i = 0; i < group->nbatches; i++) {
+		memset(&group->batches[i]->stats, 0, sizeof(batch_stats));
+	}
+	pthread_mutex_unlock(&group->lock);
+}
+
+
+void SIDH_batch_group_leave(batch_group* group)
+{
+	int members;
+
+	if (group == NULL) return;
+	members = __atomic_load_n(&group->members, __ATOMIC_ACQUIRE);
+	while (members > 0 && !__atomic_compare_exchange_n(&group->members, &members, members - 1, false, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE));
+	if (members > 0) {
+		batch_group_settle(group);
+	}
+}
+
+
+static bool batch_epoch_allocate(batch_epoch* buf, int capacity)
+{
+	int chunks = (capacity + BATCH_CHUNK - 1) / BATCH_CHUNK;
+
+	buf->elems = (f2elm_t*)malloc(capacity * sizeof(f2elm_t));
+	buf->results = (felm_t**)malloc(capacity * sizeof(felm_t*));
+	buf->den = (felm_t*)malloc(capacity * sizeof(felm_t));
+	buf->prefix = (felm_t*)malloc(capacity * sizeof(felm_t));
+	buf->total = (felm_t*)malloc(chunks * sizeof(felm_t));
+	buf->acc = (felm_t*)malloc(chunks * sizeof(felm_t));
+	buf->chunk = BATCH_CHUNK;
+	return buf->elems != NULL && buf->results != NULL && buf->den != NULL && buf->prefix != NULL && buf->total != NULL && buf->acc != NULL;
+}
+
+
+static void batch_epoch_free(batch_epoch* buf, int capacity)
+{
+	int chunks = (capacity + BATCH_CHUNK - 1) / BATCH_CHUNK;
+
+	if (buf->elems != NULL) {
+		clear_words((void*)buf->elems, capacity*2*NWORDS_FIELD);
+	}
+	if (buf->den != NULL) {
+		clear_words((void*)buf->den, capacity*NWORDS_FIELD);
+	}
+	if (buf->prefix != NULL) {
+		clear_words((void*)buf->prefix, capacity*NWORDS_FIELD);
+	}
+	if (buf->total != NULL) {
+		clear_words((void*)buf->total, chunks*NWORDS_FIELD);
+	}
+	if (buf->acc != NULL) {
+		clear_words((void*)buf->acc, chunks*NWORDS_FIELD);
+	}
+	free(buf->elems);
+	free(buf->results);
+	free(buf->den);
+	free(buf->prefix);
+	free(buf->total);
+	free(buf->acc);
+}
+
+
+batch_struct* SIDH_batch_allocate(int capacity, batch_group* group)
+{
+	batch_struct* batch;
+	pthread_condattr_t attr;
+
+	if (capacity < 1) {
+		return NULL;
+	}
+	batch = (batch_struct*)calloc(1, sizeof(batch_struct));
+	if (batch == NULL) {
+		return NULL;
+	}
+	batch->batchSize = capacity;
+	batch->capacity = capacity;
+	batch->buf[0].seq = 0;
+	batch->buf[1].done = true;
+	if (group == NULL) {
+		group = SIDH_batch_group_allocate(BATCH_TIMEOUT_USEC);
+		batch->ownGroup = true;
+	}
+	batch->group = group;
+	if (!batch_epoch_allocate(&batch->buf[0], capacity) || !batch_epoch_allocate(&batch->buf[1], capacity) || group == NULL) {
+		goto error;
+	}
+
+	pthread_mutex_lock(&group->lock);
+	if (group->nbatches == BATCH_GROUP_MAX) {
+		pthread_mutex_unlock(&group->lock);
+		goto error;
+	}
+	group->batches[group->nbatches++] = batch;
+	pthread_mutex_unlock(&group->lock);
+
+	pthread_mutex_init(&batch->lock, NULL);
+	pthread_condattr_init(&attr);
+	pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+	pthread_cond_init(&batch->changed, &attr);
+	pthread_condattr_destroy(&attr);
+	return batch;
+
+error:
+	if (batch->ownGroup) {
+		SIDH_batch_group_free(group);
+	}
+	batch_epoch_free(&batch->buf[0], capacity);
+	batch_epoch_free(&batch->buf[1], capacity);
+	free(batch);
+	return NULL;
+}
+
+
+void SIDH_batch_free(batch_struct* batch)
+{
+	batch_group* group;
+	int i;
+
+	if (batch == NULL) return;
+	group = batch->group;
+
+	pthread_mutex_lock(&group->lock);
+	for (i = 0; i < group->nbatches && group->batches[i] != batch; i++);
+	if (i < group->nbatches) {
+		group->batches[i] = group->batches[--group->nbatches];
+	}
+	pthread_mutex_unlock(&group->lock);
+
+	if (batch->ownGroup) {
+		SIDH_batch_group_free(group);
+	}
+	pthread_cond_destroy(&batch->changed);
+	pthread_mutex_destroy(&batch->lock);
+	batch_epoch_free(&batch->buf[0], batch->capacity);
+	batch_epoch_free(&batch->buf[1], batch->capacity);
+	free(batch);
+}
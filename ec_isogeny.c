@@ -11,6 +11,7 @@
 
 #include "SIDH_internal.h"
 #include <math.h>
+#include <stdlib.h>
 #include <pthread.h>
 #include <semaphore.h>
 
@@ -43,7 +44,6 @@ void j_inv(const f2elm_t A, const f2elm_t C, f2elm_t jinv)
 
 void j_inv_batch(f2elm_t A, f2elm_t C, f2elm_t jinv, batch_struct* batch) {
 	f2elm_t t0, t1;
-	int tempCnt;
 
 	fp2sqr751_mont(A, jinv);                           // jinv = A^2
 	fp2sqr751_mont(C, t1);                             // t1 = C^2
@@ -59,25 +59,7 @@ void j_inv_batch(f2elm_t A, f2elm_t C, f2elm_t jinv, batch_struct* batch) {
 	fp2mul751_mont(t0, t1, t0);                        // t0 = t0*t1
 	fp2add751(t0, t0, t0);                             // t0 = t0+t0
 	fp2add751(t0, t0, t0);                             // t0 = t0+t0
-
-	pthread_mutex_lock(&batch->arrayLock);
-	fp2copy751(jinv, batch->invArray[batch->cntr]);
-	tempCnt = batch->cntr;
-	batch->cntr++;
-	pthread_mutex_unlock(&batch->arrayLock);
-
-	int i;
-	if (tempCnt+1 == batch->batchSize) {
-		partial_batched_inv(batch->invArray, batch->invDest, batch->batchSize);
-		for (i = 0; i < batch->batchSize - 1; i++) {
-			sem_post(&batch->sign_sem);
-		}
-	} else {
-		sem_wait(&batch->sign_sem);
-	}
-	fp2copy751(batch->invDest[tempCnt], jinv);
-	batch->cntr = 0;
-
+	batch_invert(jinv, batch);                         // jinv = 1/jinv
 	fp2mul751_mont(jinv, t0, jinv);                    // jinv = t0*jinv
 }
 
@@ -312,72 +294,259 @@ CRYPTO_STATUS BigMont_ladder(unsigned char* x, digit_t* m, unsigned char* xout,
 }
 
 
+static void select_felm(const felm_t x, const felm_t y, felm_t z, const digit_t option)
+{ // Select either x or y depending on the value of option.
+  // If option = 0 then z <- x, else if option = 0xFF...FF then z <- y.
+    unsigned int i;
+
+    for (i = 0; i < NWORDS_FIELD; i++) {
+        z[i] = (option & (x[i] ^ y[i])) ^ x[i];
+    }
+}
+
+
+static void eccadd_basefield(const point_basefield_full_proj_t P, const point_basefield_full_proj_t Q, point_basefield_full_proj_t R)
+{ // Complete point addition R = P+Q on E0: y^2=x^3+x over GF(p) in projective XYZ coordinates (Renes-Costello-Batina with a=1, b=0).
+  // Valid for all inputs, including P = Q and the point at infinity (0:1:0). R may alias P or Q.
+    felm_t t0, t1, t2, t3, t4, t5;
+
+    fpmul751_mont(P->X, Q->X, t0);                     // t0 = X1*X2
+    fpmul751_mont(P->Y, Q->Y, t1);                     // t1 = Y1*Y2
+    fpmul751_mont(P->Z, Q->Z, t2);                     // t2 = Z1*Z2
+    fpadd751(P->X, P->Y, t3);
+    fpadd751(Q->X, Q->Y, t4);
+    fpmul751_mont(t3, t4, t3);
+    fpsub751(t3, t0, t3);
+    fpsub751(t3, t1, t3);                              // t3 = X1*Y2+X2*Y1
+    fpadd751(P->X, P->Z, t4);
+    fpadd751(Q->X, Q->Z, t5);
+    fpmul751_mont(t4, t5, t4);
+    fpsub751(t4, t0, t4);
+    fpsub751(t4, t2, t4);                              // t4 = X1*Z2+X2*Z1
+    fpadd751(P->Y, P->Z, t5);
+    fpadd751(Q->Y, Q->Z, R->X);
+    fpmul751_mont(t5, R->X, t5);
+    fpsub751(t5, t1, t5);
+    fpsub751(t5, t2, t5);                              // t5 = Y1*Z2+Y2*Z1
+    fpsub751(t1, t4, R->X);                            // X3 = Y1*Y2-(X1*Z2+X2*Z1)
+    fpadd751(t1, t4, R->Z);                            // Z3 = Y1*Y2+(X1*Z2+X2*Z1)
+    fpsub751(t0, t2, t4);                              // t4 = X1*X2-Z1*Z2
+    fpadd751(t0, t0, t1);
+    fpadd751(t1, t0, t1);
+    fpadd751(t1, t2, t1);                              // t1 = 3*X1*X2+Z1*Z2
+    fpmul751_mont(R->X, R->Z, R->Y);
+    fpmul751_mont(t1, t4, t0);
+    fpadd751(R->Y, t0, R->Y);                          // Y3 = (Y1*Y2+X1*Z2+X2*Z1)*(Y1*Y2-X1*Z2-X2*Z1)+(3*X1*X2+Z1*Z2)*(X1*X2-Z1*Z2)
+    fpmul751_mont(t3, R->X, R->X);
+    fpmul751_mont(t5, t4, t0);
+    fpsub751(R->X, t0, R->X);                          // X3 = (X1*Y2+X2*Y1)*(Y1*Y2-X1*Z2-X2*Z1)-(Y1*Z2+Y2*Z1)*(X1*X2-Z1*Z2)
+    fpmul751_mont(t5, R->Z, R->Z);
+    fpmul751_mont(t3, t1, t0);
+    fpadd751(R->Z, t0, R->Z);                          // Z3 = (Y1*Z2+Y2*Z1)*(Y1*Y2+X1*Z2+X2*Z1)+(X1*Y2+X2*Y1)*(3*X1*X2+Z1*Z2)
+}
+
+
+static void eccmadd_basefield(const point_basefield_t Q, point_basefield_full_proj_t P)
+{ // Complete mixed point addition P = P+Q on E0: y^2=x^3+x over GF(p), with Q = (x,y) affine. Same formulas as eccadd_basefield() with Z2 = 1.
+    felm_t t0, t1, t2, t3, t4, t5;
+
+    fpmul751_mont(P->X, Q->x, t0);                     // t0 = X1*x2
+    fpmul751_mont(P->Y, Q->y, t1);                     // t1 = Y1*y2
+    fpadd751(P->X, P->Y, t3);
+    fpadd751(Q->x, Q->y, t4);
+    fpmul751_mont(t3, t4, t3);
+    fpsub751(t3, t0, t3);
+    fpsub751(t3, t1, t3);                              // t3 = X1*y2+x2*Y1
+    fpmul751_mont(Q->x, P->Z, t4);
+    fpadd751(t4, P->X, t4);                            // t4 = X1+x2*Z1
+    fpmul751_mont(Q->y, P->Z, t5);
+    fpadd751(t5, P->Y, t5);                            // t5 = Y1+y2*Z1
+    fpadd751(t0, t0, t2);
+    fpadd751(t2, t0, t2);
+    fpadd751(t2, P->Z, t2);                            // t2 = 3*X1*x2+Z1
+    fpsub751(t0, P->Z, t0);                            // t0 = X1*x2-Z1
+    fpsub751(t1, t4, P->X);
+    fpadd751(t1, t4, P->Z);
+    fpmul751_mont(P->X, P->Z, P->Y);
+    fpmul751_mont(t2, t0, t1);
+    fpadd751(P->Y, t1, P->Y);                          // Y3 = (y1*y2+t4)*(y1*y2-t4)+t2*t0
+    fpmul751_mont(t3, P->X, P->X);
+    fpmul751_mont(t5, t0, t1);
+    fpsub751(P->X, t1, P->X);                          // X3 = t3*(Y1*y2-t4)-t5*t0
+    fpmul751_mont(t5, P->Z, P->Z);
+    fpmul751_mont(t3, t2, t1);
+    fpadd751(P->Z, t1, P->Z);                          // Z3 = t5*(Y1*y2+t4)+t3*t2
+}
+
+
+CRYPTO_STATUS fixed_base_table(const point_basefield_t P, const unsigned int nbits, digit_t* table, PCurveIsogenyStruct CurveIsogeny)
+{ // Fills in the fixed-base table used by secret_pt(): for B = [16^i]P, row i holds the affine points [1]B, [3]B, ..., [15]B.
+  // Input:  point P = (x,y) on E0: y^2=x^3+x over GF(p) in Montgomery representation, scalar bitlength nbits.
+  // Output: table with FIXED_BASE_NWORDS(nbits) digits.
+    unsigned int i, j, k, npoints = FIXED_BASE_ROWS(nbits)*FIXED_BASE_POINTS;
+    felm_t (*T)[2] = (felm_t(*)[2])table;
+    point_basefield_full_proj *S;
+    point_basefield_full_proj_t B, D;
+    felm_t *Zinv, t0;
+
+    S = (point_basefield_full_proj*)malloc(npoints*sizeof(point_basefield_full_proj));
+    Zinv = (felm_t*)malloc(npoints*sizeof(felm_t));
+    if (S == NULL || Zinv == NULL) {
+        free(S);
+        free(Zinv);
+        return CRYPTO_ERROR_NO_MEMORY;
+    }
+
+    fpcopy751(P->x, B->X);
+    fpcopy751(P->y, B->Y);
+    fpcopy751(CurveIsogeny->Montgomery_one, B->Z);
+
+    for (i = 0, k = 0; i < FIXED_BASE_ROWS(nbits); i++) {
+        eccadd_basefield(B, B, D);                     // D = [2]B
+        copy_words((digit_t*)B, (digit_t*)&S[k++], 3*NWORDS_FIELD);
+        for (j = 1; j < FIXED_BASE_POINTS; j++, k++) {
+            eccadd_basefield(&S[k-1], D, &S[k]);       // [2j+1]B = [2j-1]B+[2]B
+        }
+        for (j = 0; j < 3; j++) {
+            eccadd_basefield(D, D, D);
+        }
+        copy_words((digit_t*)D, (digit_t*)B, 3*NWORDS_FIELD);  // B = [16]B
+    }
+
+    // Normalize all points with a single inversion
+    fpcopy751(S[0].Z, Zinv[0]);
+    for (k = 1; k < npoints; k++) {
+        fpmul751_mont(Zinv[k-1], S[k].Z, Zinv[k]);
+    }
+    fpcopy751(Zinv[npoints-1], t0);
+    fpinv751_mont(t0);
+    for (k = npoints-1; k > 0; k--) {
+        fpmul751_mont(t0, Zinv[k-1], Zinv[k]);         // Zinv[k] = 1/Z_k
+        fpmul751_mont(t0, S[k].Z, t0);
+    }
+    fpcopy751(t0, Zinv[0]);
+
+    for (k = 0; k < npoints; k++) {
+        fpmul751_mont(S[k].X, Zinv[k], T[k][0]);
+        fpmul751_mont(S[k].Y, Zinv[k], T[k][1]);
+    }
+
+    clear_words((void*)S, 3*npoints*NWORDS_FIELD);
+    free(S);
+    free(Zinv);
+    return CRYPTO_SUCCESS;
+}
+
+
+static void fixed_base_lookup(const digit_t* row, const int digit, point_basefield_t Q)
+{ // Constant-time lookup of [digit]B from a fixed-base table row, for odd digit in [-15,15].
+    digit_t sign = (digit_t)(0 - (digit_t)((unsigned int)digit >> (8*sizeof(int)-1)));
+    unsigned int j, index = (unsigned int)((digit ^ (int)sign) - (int)sign) >> 1;
+    const felm_t (*T)[2] = (const felm_t(*)[2])row;
+    felm_t t0;
+
+    fpcopy751(T[0][0], Q->x);
+    fpcopy751(T[0][1], Q->y);
+    for (j = 1; j < FIXED_BASE_POINTS; j++) {
+        digit_t mask = 0 - (digit_t)is_digit_zero_ct((digit_t)(j ^ index));
+        select_felm(Q->x, T[j][0], Q->x, mask);
+        select_felm(Q->y, T[j][1], Q->y, mask);
+    }
+    fpcopy751(Q->y, t0);
+    fpneg751(t0);
+    select_felm(Q->y, t0, Q->y, sign);                 // Q = -Q if digit < 0
+}
+
+
+static void fixed_base_mul(const digit_t* table, const digit_t* m, const unsigned int nbits, point_basefield_full_proj_t R, PCurveIsogenyStruct CurveIsogeny)
+{ // Constant-time fixed-base scalar multiplication R = [m]P using the table of P computed by fixed_base_table().
+  // The scalar is recoded into FIXED_BASE_ROWS(nbits) signed odd 4-bit digits, so every row contributes exactly one point addition.
+    unsigned int i, rows = FIXED_BASE_ROWS(nbits);
+    digit_t k[NWORDS_ORDER], even;
+    sdigit_t digit[FIXED_BASE_ROWS(NWORDS_ORDER*RADIX)];
+    point_basefield_t Q;
+    point_basefield_full_proj_t S;
+
+    // Recoding of the odd scalar k = m+1 (m even) or k = m (m odd) into digits in {+-1,+-3,...,+-15}
+    copy_words(m, k, NWORDS_ORDER);
+    even = 0 - (digit_t)(1 - (unsigned int)(k[0] & 1));
+    k[0] |= 1;
+    for (i = 0; i < rows-1; i++) {
+        digit[i] = (sdigit_t)(k[0] & 31) - 16;
+        k[0] = (k[0] & ~(digit_t)31) | 16;
+        mp_shiftr1(k, NWORDS_ORDER);
+        mp_shiftr1(k, NWORDS_ORDER);
+        mp_shiftr1(k, NWORDS_ORDER);
+        mp_shiftr1(k, NWORDS_ORDER);
+    }
+    digit[rows-1] = (sdigit_t)k[0];
+
+    fixed_base_lookup(table, digit[0], Q);
+    fpcopy751(Q->x, R->X);
+    fpcopy751(Q->y, R->Y);
+    fpcopy751(CurveIsogeny->Montgomery_one, R->Z);
+    for (i = 1; i < rows; i++) {
+        fixed_base_lookup(table + i*FIXED_BASE_POINTS*2*NWORDS_FIELD, digit[i], Q);
+        eccmadd_basefield(Q, R);
+    }
+
+    // If m is even, R = R-P
+    fixed_base_lookup(table, -1, Q);
+    copy_words((digit_t*)R, (digit_t*)S, 3*NWORDS_FIELD);
+    eccmadd_basefield(Q, S);
+    select_felm(R->X, S->X, R->X, even);
+    select_felm(R->Y, S->Y, R->Y, even);
+    select_felm(R->Z, S->Z, R->Z, even);
+
+    clear_words((void*)k, NWORDS_ORDER);
+    clear_words((void*)digit, sizeof(digit)/sizeof(sdigit_t));
+}
+
+
 CRYPTO_STATUS secret_pt(const point_basefield_t P, const digit_t* m, const unsigned int AliceOrBob, point_proj_t R, PCurveIsogenyStruct CurveIsogeny)
-{ // Computes key generation entirely in the base field by exploiting a 1-dimensional Montgomery ladder in the trace zero subgroup and
-  // recovering the y-coordinate for the addition. All operations in the base field GF(p).
-  // Input:  The scalar m, point P = (x,y) on E in the base field subgroup and Q = (x1,y1*i) on E in the trace-zero subgroup.
-  //         x,y,x1,y1 are all in the base field.
+{ // Computes key generation entirely in the base field by exploiting the distortion map Q = tau(P) = (-x,y*i) and computing [m]P with the
+  // fixed-base table of P set up by SIDH_curve_initialize(). All operations in the base field GF(p).
+  // Input:  The scalar m, point P = (x,y) on E in the base field subgroup, where P is PA (if AliceOrBob = ALICE) or PB (if AliceOrBob = BOB).
   // Output: R = (RX0+RX1*i)/RZ0 (the x-coordinate of P+[m]Q).
     unsigned int nbits;
-    point_basefield_t Q;
-    point_basefield_proj_t S, T;
-    digit_t *X0 = (digit_t*)S->X, *Z0 = (digit_t*)S->Z, *X1 = (digit_t*)T->X, *Z1 = (digit_t*)T->Z;
-    digit_t *x  = (digit_t*)P->x, *y  = (digit_t*)P->y, *x1 = (digit_t*)Q->x, *y1 = (digit_t*)Q->y;
-    digit_t scalar[NWORDS_ORDER];
-    felm_t t0, t1, t2, A24 = {0};
+    const digit_t* table;
+    point_basefield_full_proj_t S;
+    digit_t *X = (digit_t*)S->X, *Y = (digit_t*)S->Y, *Z = (digit_t*)S->Z, *x = (digit_t*)P->x, *y = (digit_t*)P->y;
+    felm_t t0, t1, t2;
     digit_t *RX0 = (digit_t*)R->X[0], *RX1 = (digit_t*)R->X[1], *RZ0 = (digit_t*)R->Z[0], *RZ1 = (digit_t*)R->Z[1];
 
-    fpcopy751(P->x, Q->x);                         // Q = (-XP,YP)
-    fpcopy751(P->y, Q->y);
-    fpneg751(Q->x);
-
     if (AliceOrBob == ALICE) {
         nbits = CurveIsogeny->oAbits;
+        table = CurveIsogeny->PA_table;
     } else if (AliceOrBob == BOB) {
         nbits = CurveIsogeny->oBbits;
+        table = CurveIsogeny->PB_table;
     } else {
         return CRYPTO_ERROR_INVALID_PARAMETER;
     }
 
-    // Setting curve constant to one (in standard representation), used in xDBLADD_basefield() in the ladder computation
-    A24[0] = 1;
-    copy_words(m, scalar, NWORDS_ORDER);
-    ladder(Q->x, scalar, S, T, A24, nbits, CurveIsogeny->owordbits, CurveIsogeny);
-
-    //RX0 = (2*y*y1*Z0^2*Z1 + Z1*(X0*x1+Z0)*(X0+x1*Z0) - X1*(X0-x1*Z0)^2)*(2*y*y1*Z0^2*Z1 - Z1*(X0*x1+Z0)*(X0+x1*Z0) + X1*(X0-x1*Z0)^2) - 4*y1^2*Z0*Z1^2*(X0+x*Z0)*(X0-x*Z0)^2;
-    //RX1 = 4*y*y1*Z0^2*Z1*(Z1*(X0*x1+Z0)*(X0+x1*Z0) - X1*(X0-x1*Z0)^2);
-    //RZ0 = 4*y1^2*Z0^2*Z1^2*(X0-x*Z0)^2;
-
-    fpmul751_mont(x1, Z0, RX1);
-    fpmul751_mont(X0, x1, RX0);
-    fpsub751(X0, RX1, t0);
-    fpadd751(X0, RX1, RX1);
-    fpsqr751_mont(t0, t0);
-    fpadd751(RX0, Z0, RX0);
-    fpmul751_mont(t0, X1, t0);
-    fpmul751_mont(RX0, RX1, RX0);
-    fpmul751_mont(y1, Z1, t2);
-    fpmul751_mont(y, Z0, t1);
-    fpadd751(t2, t2, t2);
-    fpmul751_mont(t2, Z0, RX1);
-    fpmul751_mont(RX0, Z1, RX0);
-    fpsub751(RX0, t0, RX0);
-    fpmul751_mont(t1, RX1, t1);
-    fpsqr751_mont(RX1, t0);
-    fpmul751_mont(t2, RX1, t2);
-    fpmul751_mont(t1, RX0, RX1);
-    fpadd751(t1, RX0, RZ0);
-    fpadd751(RX1, RX1, RX1);
-    fpsub751(t1, RX0, t1);
-    fpmul751_mont(x, Z0, RX0);
-    fpmul751_mont(t1, RZ0, t1);
-    fpsub751(X0, RX0, RZ0);
-    fpadd751(X0, RX0, RX0);
-    fpsqr751_mont(RZ0, RZ0);
-    fpmul751_mont(t2, RX0, t2);
-    fpmul751_mont(t2, RZ0, t2);
-    fpmul751_mont(RZ0, t0, RZ0);
-    fpsub751(t1, t2, RX0);
+    fixed_base_mul(table, m, nbits, S, CurveIsogeny);   // (X:Y:Z) = [m]P, so that [m]Q = (-X/Z,Y/Z*i)
+
+    //RX0 = (y^2*Z^2-Y^2)*Z + (X-x*Z)*(X+x*Z)^2;
+    //RX1 = -2*y*Y*Z^2;
+    //RZ0 = Z*(X+x*Z)^2;
+
+    fpmul751_mont(x, Z, t0);
+    fpadd751(X, t0, t1);
+    fpsub751(X, t0, t0);
+    fpsqr751_mont(t1, t1);
+    fpmul751_mont(t0, t1, t0);
+    fpmul751_mont(Z, t1, RZ0);
+    fpmul751_mont(y, Z, t1);
+    fpsqr751_mont(t1, t2);
+    fpmul751_mont(t1, Y, t1);
+    fpmul751_mont(t1, Z, t1);
+    fpadd751(t1, t1, RX1);
+    fpneg751(RX1);
+    fpsqr751_mont(Y, t1);
+    fpsub751(t2, t1, t2);
+    fpmul751_mont(t2, Z, t2);
+    fpadd751(t2, t0, RX0);
     fpzero751(RZ1);
 
     return CRYPTO_SUCCESS;
@@ -441,6 +610,66 @@ CRYPTO_STATUS ladder_3_pt(const f2elm_t xP, const f2elm_t xQ, const f2elm_t xPQ,
 }
 
 
+void prepare_3_pt_ladder(const f2elm_t xQ, const f2elm_t A, f2elm_t (*table)[2], const unsigned int nbits, PCurveIsogenyStruct CurveIsogeny)
+{ // Precomputes the doublings of Q used by ladder_3_pt_prepared.
+  // Input:  affine point xQ and Montgomery constant A.
+  // Output: table[i] = {Xi+Zi, Xi-Zi} for (Xi:Zi) = x([2^i]Q), 0 <= i < nbits
+    point_proj_t R = {0};
+    f2elm_t A24, C24 = {0};
+    unsigned int i;
+
+    fpcopy751(CurveIsogeny->Montgomery_one, C24[0]);
+    fp2add751(C24, C24, C24);                          // C24 = 2
+    fp2add751(A, C24, A24);                            // A24 = A+2
+    fp2add751(C24, C24, C24);                          // C24 = 4
+    fp2copy751(xQ, R->X);
+    fpcopy751(CurveIsogeny->Montgomery_one, (digit_t*)R->Z);
+
+    for (i = 0; i < nbits; i++) {
+        fp2add751(R->X, R->Z, table[i][0]);
+        fp2sub751(R->X, R->Z, table[i][1]);
+        xDBL(R, R, A24, C24);
+    }
+}
+
+
+void ladder_3_pt_prepared(const f2elm_t xP, const f2elm_t xPQ, const f2elm_t (*table)[2], const digit_t* m, const unsigned int nbits, point_proj_t W, PCurveIsogenyStruct CurveIsogeny)
+{ // Computes P+[m]Q via a right-to-left x-only ladder, with the doublings of Q taken from prepare_3_pt_ladder.
+  // Each bit costs one differential addition: after bit i, W = P+[m mod 2^(i+1)]Q and V = W-[2^(i+1)]Q, and the bit
+  // either adds [2^i]Q to W (difference V) or subtracts it from V (difference W).
+  // Input:  affine points xP, xPQ = x(P-Q) and the table of Q.
+  // Output: projective Montgomery x-coordinates of x(P+[m]Q)=WX/WZ
+    point_proj_t V = {0};
+    f2elm_t t0, t1;
+    unsigned int i, bit;
+    digit_t mask;
+
+    fp2copy751(xP, W->X);
+    fpcopy751(CurveIsogeny->Montgomery_one, (digit_t*)W->Z);
+    fpzero751(W->Z[1]);
+    fp2copy751(xPQ, V->X);
+    fpcopy751(CurveIsogeny->Montgomery_one, (digit_t*)V->Z);
+
+    for (i = 0; i < nbits; i++) {
+        bit = (unsigned int)(m[i/RADIX] >> (i%RADIX)) & 1;
+        mask = 0 - (digit_t)bit;
+
+        swap_points(W, V, mask);                       // V is the point that moves, W the difference
+        fp2sub751(V->X, V->Z, t0);                     // t0 = XV-ZV
+        fp2add751(V->X, V->Z, t1);                     // t1 = XV+ZV
+        fp2mul751_mont(t0, table[i][0], t0);           // t0 = (XV-ZV)*(Xi+Zi)
+        fp2mul751_mont(t1, table[i][1], t1);           // t1 = (XV+ZV)*(Xi-Zi)
+        fp2add751(t0, t1, V->X);                       // XV = t0+t1
+        fp2sub751(t0, t1, V->Z);                       // ZV = t0-t1
+        fp2sqr751_mont(V->X, V->X);                    // XV = (t0+t1)^2
+        fp2sqr751_mont(V->Z, V->Z);                    // ZV = (t0-t1)^2
+        fp2mul751_mont(W->Z, V->X, V->X);              // XV = ZW*XV
+        fp2mul751_mont(W->X, V->Z, V->Z);              // ZV = XW*ZV
+        swap_points(W, V, mask);
+    }
+}
+
+
 void get_4_isog(const point_proj_t P, f2elm_t A, f2elm_t C, f2elm_t* coeff)
 { // Computes the corresponding 4-isogeny of a projective Montgomery point (X4:Z4) of order 4.
   // Input:  projective point of order four P = (X4:Z4).
@@ -649,37 +878,12 @@ void inv_4_way_batch(f2elm_t z1, f2elm_t z2, f2elm_t z3, f2elm_t z4, batch_struc
 	// Input:  z1,z2,z3,z4
 	// Output: 1/z1,1/z2,1/z3,1/z4 (override inputs).
 	f2elm_t t0, t1, t2;
-	int tempCnt;
 
 	fp2mul751_mont(z1, z2, t0);                      // t0 = z1*z2
 	fp2mul751_mont(z3, z4, t1);                      // t1 = z3*z4
 	fp2mul751_mont(t0, t1, t2);                      // t2 = z1*z2*z3*z4
 
-	//printf("%s:%d\n", __FILE__, __LINE__);
-	pthread_mutex_lock(&batch->arrayLock);
-	//printf("%s:%d cntr=%d\n", __FILE__, __LINE__, cntr);
-	fp2copy751(t2, batch->invArray[batch->cntr]);
-	tempCnt = batch->cntr;
-	//printf("%s:%d Adding element %d to inversion buffer \n", __FILE__, __LINE__, tempCnt);
-	batch->cntr++;
-	pthread_mutex_unlock(&batch->arrayLock);
-
-	int i;
-
-	//printf("%s:%d cntr=%d, batchSize=%d\n", __FILE__, __LINE__, cntr, batchSize);
-
-	if (tempCnt+1 == batch->batchSize) {
-		partial_batched_inv(batch->invArray, batch->invDest, batch->batchSize);
-
-		for (i = 0; i < batch->batchSize; i++) {
-			sem_post(&batch->sign_sem);
-		}
-	} else {
-		sem_wait(&batch->sign_sem);
-	}
-
-	fp2copy751(batch->invDest[tempCnt], t2);
-	batch->cntr = 0;
+	batch_invert(t2, batch);                         // t2 = 1/(z1*z2*z3*z4)
 
 	fp2mul751_mont(t0, t2, t0);                      // t0 = 1/(z3*z4)
 	fp2mul751_mont(t1, t2, t1);                      // t1 = 1/(z1*z2)
@@ -689,8 +893,6 @@ void inv_4_way_batch(f2elm_t z1, f2elm_t z2, f2elm_t z3, f2elm_t z4, batch_struc
 	fp2mul751_mont(z1, t1, t2);                      // t2 = 1/z2
 	fp2mul751_mont(z2, t1, z1);                      // z1 = 1/z1
 	fp2copy751(t2, z2);                              // z2 = 1/z2
-
-	//printf("%s:%d Batched inversion complete \n", __FILE__, __LINE__);
 }
 
 void distort_and_diff(const felm_t xP, point_proj_t D, PCurveIsogenyStruct CurveIsogeny)
@@ -983,71 +1185,183 @@ static void get_pt_on_curve(f2elm_t A, unsigned int* r, f2elm_t x, f2elm_t y)
   }
 
 
-static void get_3_torsion_elt(f2elm_t A, unsigned int* r, point_proj_t P, point_proj_t P3, unsigned int* triples, PCurveIsogenyStruct CurveIsogeny)
+typedef struct {
+	point_proj_t R3, R4;                             // [3^238]R1 and [3^238]R2
+	f2elm_t fX, fY, f0;                              // Line through the first point of order 3, R = (X:Y:1) is kept if fX*X+fY*Y+f0 is no cube
+	unsigned int r, pts_found;
+} basis_search;
+
+
+static bool basis_lanes(void)
+{ // Whether the curves of a basis search can run on the 8-lane arithmetic
+#if defined(X64_IFMA_LANES)
+	static int supported = -1;
+
+	if (supported < 0) {
+		supported = fp_x8_supported();
+	}
+	return supported != 0;
+#else
+	return false;
+#endif
+}
+
+
+#if defined(X64_IFMA_LANES)
+static void pack_points_x8(const point_proj* P, const f2elm_t* A, const f2elm_t one, const int n, point_proj_x8_t Q, f2elm_x8_t A8, f2elm_x8_t C8)
+{ // Moves n <= NLANES points and their curves A/1 to the lanes, lanes beyond n repeat the first one
+	f2elm_t lanes[NLANES];
+	int i;
+
+	for (i = 0; i < NLANES; i++) fp2copy751(P[(i < n) ? i : 0].X, lanes[i]);
+	fp2pack751_x8(lanes, Q->X);
+	for (i = 0; i < NLANES; i++) fp2copy751(P[(i < n) ? i : 0].Z, lanes[i]);
+	fp2pack751_x8(lanes, Q->Z);
+	for (i = 0; i < NLANES; i++) fp2copy751(A[(i < n) ? i : 0], lanes[i]);
+	fp2pack751_x8(lanes, A8);
+	for (i = 0; i < NLANES; i++) fp2copy751(one, lanes[i]);
+	fp2pack751_x8(lanes, C8);
+}
+
+
+static void unpack_points_x8(const point_proj_x8_t Q, point_proj* P, const int n)
 {
-	point_proj_t PP;
-	f2elm_t A24, C24, one = {0};
-	felm_t t0, t1, t2, zero = {0};
+	f2elm_t lanes[NLANES];
+	int i;
 
-	*triples = 0;
-	fpcopy751(CurveIsogeny->Montgomery_one, one[0]);
-	fpadd751(one[0], one[0], C24[0]);
-	fpzero751(C24[1]);
+	fp2unpack751_x8(Q->X, lanes);
+	for (i = 0; i < n; i++) fp2copy751(lanes[i], P[i].X);
+	fp2unpack751_x8(Q->Z, lanes);
+	for (i = 0; i < n; i++) fp2copy751(lanes[i], P[i].Z);
+}
+#endif
 
-	get_X_on_curve(A, r, P->X, t0, t1, t2);
-	fp2copy751(one, P->Z);                           // Z = 1
-	xDBLe(P, P, A, one, 372);
 
-	fp2copy751(P->X, PP->X);                         // XX = X
-	fp2copy751(P->Z, PP->Z);                         // ZZ = Z
+static void xDBLe_batch(const point_proj* P, point_proj* Q, const f2elm_t* A, const f2elm_t one, const int n, const int e)
+{ // Q[i] = [2^e]P[i] on the curves A[i] for n <= BASIS_BATCH points, in lockstep when the 8-lane arithmetic is available
+	int i;
 
-	fp2add751(A, C24, A24);                          // A24 = A+2
-	fpadd751(C24[0], C24[0], C24[0]);                // C24 = 4
+#if defined(X64_IFMA_LANES)
+	if (n > 1 && basis_lanes()) {
+		point_proj_x8_t R;
+		f2elm_x8_t A8, C8;
 
-	fp2correction751(PP->Z);
-	while (fpequal751_non_constant_time(PP->Z[0], zero) == false || fpequal751_non_constant_time(PP->Z[1], zero) == false) {
-		fp2copy751(PP->X, P3->X);                    // X3 = XX
-		fp2copy751(PP->Z, P3->Z);                    // Z3 = ZZ
-		xTPL(PP, PP, A24, C24);
-		(*triples)++;
-		fp2correction751(PP->Z);
+		pack_points_x8(P, A, one, n, R, A8, C8);
+		xDBLe_x8(R, R, A8, C8, e);
+		unpack_points_x8(R, Q, n);
+		return;
+	}
+#endif
+	for (i = 0; i < n; i++) {
+		xDBLe(&P[i], &Q[i], A[i], one, e);
 	}
 }
 
 
-void generate_3_torsion_basis(f2elm_t A, point_full_proj_t R1, point_full_proj_t R2, PCurveIsogenyStruct CurveIsogeny)
-{ // Produces points R1 and R2 such that {R1, R2} is a basis for E[3^239].
-  // Input:   curve constant A.
-  // Outputs: R1 = (X1:Y1:Z1) and R2 = (X2:Y2:Z2).
-	point_proj_t R, R3, R4;
-	felm_t *X  = (felm_t*)R->X,  *Z  = (felm_t*)R->Z;
-	felm_t *X3 = (felm_t*)R3->X, *Z3 = (felm_t*)R3->Z;
-	felm_t *X4 = (felm_t*)R4->X, *Z4 = (felm_t*)R4->Z;
-	felm_t *X1 = (felm_t*)R1->X, *Y1 = (felm_t*)R1->Y, *Z1 = (felm_t*)R1->Z;
-	felm_t *X2 = (felm_t*)R2->X, *Y2 = (felm_t*)R2->Y, *Z2 = (felm_t*)R2->Z;
-	f2elm_t u, v, c, f, t0, f0, fX, fY, Y, Y3, one = {0};
+static void xTPLe_batch(const point_proj* P, point_proj* Q, const f2elm_t* A, const f2elm_t one, const int n, const int e)
+{ // Q[i] = [3^e]P[i] on the curves A[i] for n <= BASIS_BATCH points, in lockstep when the 8-lane arithmetic is available
+	int i;
+
+#if defined(X64_IFMA_LANES)
+	if (n > 1 && basis_lanes()) {
+		point_proj_x8_t R;
+		f2elm_x8_t A8, C8;
+
+		pack_points_x8(P, A, one, n, R, A8, C8);
+		xTPLe_x8(R, R, A8, C8, e);
+		unpack_points_x8(R, Q, n);
+		return;
+	}
+#endif
+	for (i = 0; i < n; i++) {
+		xTPLe(&P[i], &Q[i], A[i], one, e);
+	}
+}
+
+
+static void triple_to_order_3(const point_proj* P, point_proj* P3, unsigned int* triples, const f2elm_t* A, const f2elm_t one, const int n)
+{ // Triples each of the n <= BASIS_BATCH points P[i] until it vanishes: triples[i] is the number of triplings that takes
+  // and P3[i] the last multiple before it, a point of order 3.
+	point_proj_t PP;
+	f2elm_t A24, C24;
 	felm_t zero = {0};
-	unsigned int r = 1;
-	unsigned int triples = 0, pts_found = 0;
+	int i;
 
-	get_3_torsion_elt(A, &r, R, R3, &triples, CurveIsogeny);
-	fpcopy751(CurveIsogeny->Montgomery_one, one[0]);
-	fpzero751(zero);
+#if defined(X64_IFMA_LANES)
+	if (n > 1 && basis_lanes()) {
+		point_proj_x8_t R, prev;
+		f2elm_x8_t A8, C8;
+		unsigned int j, full = (1 << NLANES) - 1, mask, found;
 
-	if (triples == 239) {
-		pts_found = 1;
-		fp2copy751(X, X1);                           // X1 = X
-		fp2copy751(Z, Z1);                           // Z1 = Z
-		fp2mul751_mont(A, Z1, u);                    // u = A*Z1
-		fp2add751(u, X1, u);                         // u = u+X1
-		fp2mul751_mont(u, X1, u);                    // u = u*X1
-		fp2sqr751_mont(Z1, v);                       // v = Z1^2
-		fp2add751(u, v, u);                          // u = u+v
-		fp2mul751_mont(u, X1, u);                    // u = u*X1
-		fp2mul751_mont(v, Z1, v);                    // v = v*Z1
-		sqrt_Fp2_frac(u, v, Y1);                     // Y1 = sqrt(u/v)
-		fp2mul751_mont(Y1, Z1, Y1);                  // Y1 = Y1*Z1
+		for (i = 0; i < n; i++) {
+			triples[i] = 0;
+		}
+		pack_points_x8(P, A, one, n, R, A8, C8);
+		fp2add751_x8(C8, C8, C8);                    // C24 = 2
+		fp2add751_x8(A8, C8, A8);                    // A24 = A+2
+		fp2add751_x8(C8, C8, C8);                    // C24 = 4
+		mask = fp2iszero751_x8(R->Z);
+		for (j = 1; mask != full; j++) {
+			copy_words((digit_t*)R, (digit_t*)prev, sizeof(point_proj_x8)/sizeof(digit_t));
+			xTPL_x8(R, R, A8, C8);
+			found = fp2iszero751_x8(R->Z) & ~mask;
+			if (found != 0) {                        // The lanes that just vanished take the previous multiple
+				point_proj lanes[NLANES];
+
+				unpack_points_x8(prev, lanes, NLANES);
+				for (i = 0; i < n; i++) {
+					if (found & (1 << i)) {
+						fp2copy751(lanes[i].X, P3[i].X);
+						fp2copy751(lanes[i].Z, P3[i].Z);
+						triples[i] = j;
+					}
+				}
+				mask |= found;
+			}
+		}
+		return;
+	}
+#endif
+	for (i = 0; i < n; i++) {
+		triples[i] = 0;
+		fp2add751(one, one, C24);                    // C24 = 2
+		fp2add751(A[i], C24, A24);                   // A24 = A+2
+		fp2add751(C24, C24, C24);                    // C24 = 4
+		fp2copy751(P[i].X, PP->X);                   // XX = X
+		fp2copy751(P[i].Z, PP->Z);                   // ZZ = Z
+
+		fp2correction751(PP->Z);
+		while (fpequal751_non_constant_time(PP->Z[0], zero) == false || fpequal751_non_constant_time(PP->Z[1], zero) == false) {
+			fp2copy751(PP->X, P3[i].X);              // X3 = XX
+			fp2copy751(PP->Z, P3[i].Z);              // Z3 = ZZ
+			xTPL(PP, PP, A24, C24);
+			triples[i]++;
+			fp2correction751(PP->Z);
+		}
 	}
+}
+
+
+static void basis_point_y(const f2elm_t A, point_full_proj_t R)
+{ // Sets the y-coordinate of R = (X:Y:Z) from its x-coordinate, up to sign
+	f2elm_t u, v;
+
+	fp2mul751_mont(A, R->Z, u);                      // u = A*Z
+	fp2add751(u, R->X, u);                           // u = u+X
+	fp2mul751_mont(u, R->X, u);                      // u = u*X
+	fp2sqr751_mont(R->Z, v);                         // v = Z^2
+	fp2add751(u, v, u);                              // u = u+v
+	fp2mul751_mont(u, R->X, u);                      // u = u*X
+	fp2mul751_mont(v, R->Z, v);                      // v = v*Z
+	sqrt_Fp2_frac(u, v, R->Y);                       // Y = sqrt(u/v)
+	fp2mul751_mont(R->Y, R->Z, R->Y);                // Y = Y*Z
+}
+
+
+static void basis_search_line(const f2elm_t A, basis_search* s)
+{ // The line through the point of order 3 in s->R3 that the cube test evaluates
+	felm_t *X3 = (felm_t*)s->R3->X, *Z3 = (felm_t*)s->R3->Z;
+	f2elm_t u, v, c, t0, Y3;
 
 	fp2mul751_mont(A, Z3, u);                        // u = A*Z3
 	fp2add751(u, X3, u);                             // u = u+X3
@@ -1058,70 +1372,181 @@ void generate_3_torsion_basis(f2elm_t A, point_full_proj_t R1, point_full_proj_t
 	fp2mul751_mont(v, Z3, v);                        // v = v*Z3
 	sqrt_Fp2_frac(u, v, Y3);                         // Y3 = sqrt(u/v)
 	fp2mul751_mont(Y3, Z3, Y3);                      // Y3 = Y3*Z3
-	fp2sqr751_mont(X3, f0);                          // f0 = X3^2
+	fp2sqr751_mont(X3, s->f0);                       // f0 = X3^2
 	fp2sqr751_mont(Z3, t0);                          // t0 = Z3^2
-	fp2mul751_mont(X3, Z3, fX);                      // fX = X3*Z3
-	fp2mul751_mont(A, fX, fX);                       // fX = A*fX
-	fp2add751(fX, fX, fX);                           // fX = fX+fX
-	fp2add751(fX, t0, fX);                           // fX = fX+t0
-	fp2add751(fX, f0, fX);                           // fX = fX+f0
-	fp2add751(fX, f0, fX);                           // fX = fX+f0
-	fp2add751(fX, f0, fX);                           // fX = fX+f0
-	fp2sub751(t0, f0, f0);                           // f0 = t0-f0
-	fp2mul751_mont(fX, Z3, fX);                      // fX = fX*Z3
-	fp2mul751_mont(Y3, Z3, fY);                      // fY = Y3*Z3
-	fp2add751(fY, fY, fY);                           // fY = fY+fY
-	fp2neg751(fY);                                   // fY = -fY
-	fp2add751(fY, fY, c);                            // c = fY+fY
-	fp2mul751_mont(fY, Z3, fY);                      // fY = fY*Z3
-	fp2mul751_mont(f0, X3, f0);                      // f0 = f0*X3
+	fp2mul751_mont(X3, Z3, s->fX);                   // fX = X3*Z3
+	fp2mul751_mont(A, s->fX, s->fX);                 // fX = A*fX
+	fp2add751(s->fX, s->fX, s->fX);                  // fX = fX+fX
+	fp2add751(s->fX, t0, s->fX);                     // fX = fX+t0
+	fp2add751(s->fX, s->f0, s->fX);                  // fX = fX+f0
+	fp2add751(s->fX, s->f0, s->fX);                  // fX = fX+f0
+	fp2add751(s->fX, s->f0, s->fX);                  // fX = fX+f0
+	fp2sub751(t0, s->f0, s->f0);                     // f0 = t0-f0
+	fp2mul751_mont(s->fX, Z3, s->fX);                // fX = fX*Z3
+	fp2mul751_mont(Y3, Z3, s->fY);                   // fY = Y3*Z3
+	fp2add751(s->fY, s->fY, s->fY);                  // fY = fY+fY
+	fp2neg751(s->fY);                                // fY = -fY
+	fp2add751(s->fY, s->fY, c);                      // c = fY+fY
+	fp2mul751_mont(s->fY, Z3, s->fY);                // fY = fY*Z3
+	fp2mul751_mont(s->f0, X3, s->f0);                // f0 = f0*X3
 	fp2mul751_mont(c, Y3, c);                        // c = c*Y3
-	fp2mul751_mont(fX, c, fX);                       // fX = c*fX
-	fp2mul751_mont(fY, c, fY);                       // fY = c*fY
-	fp2mul751_mont(f0, c, f0);                       // f0 = c*f0
+	fp2mul751_mont(s->fX, c, s->fX);                 // fX = c*fX
+	fp2mul751_mont(s->fY, c, s->fY);                 // fY = c*fY
+	fp2mul751_mont(s->f0, c, s->f0);                 // f0 = c*f0
+}
 
-	do {
-		while (pts_found < 2) {
-			r++;
-			get_pt_on_curve(A, &r, X, Y);
-			fp2mul751_mont(fX, X, f);                    // f = fX*X
-			fp2mul751_mont(fY, Y, t0);                   // t0 = fY*Y
-			fp2add751(f, t0, f);                         // f = f+t0
-			fp2add751(f, f0, f);                         // f = f+f0
-
-			if (is_cube_Fp2(f, CurveIsogeny) == false) {
-				fp2copy751(one, Z);                      // Z = 1
-				xDBLe(R, R, A, one, 372);
-				fp2mul751_mont(A, Z, u);                 // u = A*Z
-				fp2add751(u, X, u);                      // u = u+X
-				fp2mul751_mont(u, X, u);                 // u = u*X
-				fp2sqr751_mont(Z, v);                    // v = Z^2
-				fp2add751(u, v, u);                      // u = u+v
-				fp2mul751_mont(u, X, u);                 // u = u*X
-				fp2mul751_mont(v, Z, v);                 // v = v*Z
-				sqrt_Fp2_frac(u, v, Y);                  // Y = sqrt(u/v)
-				fp2mul751_mont(Y, Z, Y);                 // Y = Y*Z
-
-				if (pts_found == 0) {
-					fp2copy751(X, X1);                   // X1 = X
-					fp2copy751(Y, Y1);                   // Y1 = Y
-					fp2copy751(Z, Z1);                   // Z1 = Z
-					xTPLe(R, R3, A, one, 238);
+
+void generate_3_torsion_basis(f2elm_t A, point_full_proj_t R1, point_full_proj_t R2, PCurveIsogenyStruct CurveIsogeny)
+{ // Produces points R1 and R2 such that {R1, R2} is a basis for E[3^239].
+  // Input:   curve constant A.
+  // Outputs: R1 = (X1:Y1:Z1) and R2 = (X2:Y2:Z2).
+	unsigned int hint[2];
+
+	generate_3_torsion_basis_hint(A, R1, R2, hint, CurveIsogeny);
+}
+
+
+void generate_3_torsion_basis_hint(f2elm_t A, point_full_proj_t R1, point_full_proj_t R2, unsigned int hint[2], PCurveIsogenyStruct CurveIsogeny)
+{ // Produces points R1 and R2 such that {R1, R2} is a basis for E[3^239].
+  // Input:   curve constant A.
+  // Outputs: R1 = (X1:Y1:Z1) and R2 = (X2:Y2:Z2),
+  //          hint = the values of the search counter r at which R1 and R2 were found.
+
+	generate_3_torsion_basis_batch((f2elm_t*)A, R1, R2, (unsigned int (*)[2])hint, 1, CurveIsogeny);
+}
+
+
+void generate_3_torsion_basis_batch(f2elm_t* A, point_full_proj* R1, point_full_proj* R2, unsigned int (*hint)[2], int n, PCurveIsogenyStruct CurveIsogeny)
+{ // Produces points R1[i] and R2[i] such that {R1[i], R2[i]} is a basis for E[3^239] on each of the n curves A[i],
+  // with hint[i] as generate_3_torsion_basis_hint. The search runs over BASIS_BATCH curves at a time: every round tries
+  // the next candidate of each curve still searching, with one inversion for all cube tests, and the ladders of the kept
+  // candidates run in lockstep on the 8-lane arithmetic when available.
+	basis_search s[BASIS_BATCH];
+	point_proj P[BASIS_BATCH], P3[BASIS_BATCH];
+	point_full_proj_t R;
+	f2elm_t As[BASIS_BATCH], f[BASIS_BATCH], Y, t0, one = {0};
+	felm_t t1, t2, zero = {0};
+	unsigned int triples[BASIS_BATCH];
+	bool cube[BASIS_BATCH];
+	int i, j, k, m, cnt, idx[BASIS_BATCH];
+
+	fpcopy751(CurveIsogeny->Montgomery_one, one[0]);
+
+	for (i = 0; i < n; i += m) {
+		m = (n - i < BASIS_BATCH) ? n - i : BASIS_BATCH;
+
+		for (k = 0; k < m; k++) {
+			s[k].r = 1;
+			s[k].pts_found = 0;
+			get_X_on_curve(A[i+k], &s[k].r, P[k].X, t0[0], t1, t2);
+			fp2copy751(one, P[k].Z);                 // Z = 1
+		}
+		xDBLe_batch(P, P, &A[i], one, m, 372);
+		triple_to_order_3(P, P3, triples, &A[i], one, m);
+
+		for (k = 0; k < m; k++) {
+			fp2copy751(P3[k].X, s[k].R3->X);
+			fp2copy751(P3[k].Z, s[k].R3->Z);
+			if (triples[k] == 239) {
+				s[k].pts_found = 1;
+				hint[i+k][0] = s[k].r;
+				fp2copy751(P[k].X, R1[i+k].X);       // X1 = X
+				fp2copy751(P[k].Z, R1[i+k].Z);       // Z1 = Z
+				basis_point_y(A[i+k], &R1[i+k]);
+			}
+			basis_search_line(A[i+k], &s[k]);
+		}
+
+		while (true) {
+			cnt = 0;
+			for (k = 0; k < m; k++) {
+				if (s[k].pts_found < 2) {
+					s[k].r++;
+					get_pt_on_curve(A[i+k], &s[k].r, P[k].X, Y);
+					fp2mul751_mont(s[k].fX, P[k].X, f[cnt]);    // f = fX*X
+					fp2mul751_mont(s[k].fY, Y, t0);             // t0 = fY*Y
+					fp2add751(f[cnt], t0, f[cnt]);              // f = f+t0
+					fp2add751(f[cnt], s[k].f0, f[cnt]);         // f = f+f0
+					idx[cnt++] = k;
+				}
+			}
+			if (cnt == 0) {
+				break;
+			}
+			is_cube_Fp2_batch(f, cube, cnt, CurveIsogeny);
+
+			for (j = 0, k = 0; j < cnt; j++) {           // Keep the candidates that are no cubes
+				if (cube[j] == false) {
+					idx[k] = idx[j];
+					fp2copy751(P[idx[j]].X, P3[k].X);
+					fp2copy751(one, P3[k].Z);            // Z = 1
+					fp2copy751(A[i+idx[j]], As[k]);
+					k++;
+				}
+			}
+			cnt = k;
+			xDBLe_batch(P3, P3, As, one, cnt, 372);
+
+			for (j = 0; j < cnt; j++) {
+				k = idx[j];
+				fp2copy751(P3[j].X, R->X);
+				fp2copy751(P3[j].Z, R->Z);
+				basis_point_y(As[j], R);
+				if (s[k].pts_found == 0) {
+					hint[i+k][0] = s[k].r;
+					copy_words((digit_t*)R, (digit_t*)&R1[i+k], 3*2*NWORDS_FIELD);
 				} else {
-					fp2copy751(X, X2);                   // X2 = X
-					fp2copy751(Y, Y2);                   // Y2 = Y
-					fp2copy751(Z, Z2);                   // Z2 = Z
-					xTPLe(R, R4, A, one, 238);
+					hint[i+k][1] = s[k].r;
+					copy_words((digit_t*)R, (digit_t*)&R2[i+k], 3*2*NWORDS_FIELD);
+				}
+			}
+			xTPLe_batch(P3, P3, As, one, cnt, 238);
+
+			for (j = 0; j < cnt; j++) {
+				k = idx[j];
+				if (s[k].pts_found == 0) {
+					fp2copy751(P3[j].X, s[k].R3->X);
+					fp2copy751(P3[j].Z, s[k].R3->Z);
+					s[k].pts_found = 1;
+				} else {                                 // Done once [3^238]R2 is independent of [3^238]R1
+					fp2copy751(P3[j].X, s[k].R4->X);
+					fp2copy751(P3[j].Z, s[k].R4->Z);
+					fp2mul751_mont(s[k].R3->X, s[k].R4->Z, t0);
+					fp2mul751_mont(s[k].R4->X, s[k].R3->Z, Y);
+					fp2sub751(t0, Y, t0);
+					fp2correction751(t0);
+					if (fpequal751_non_constant_time(t0[0], zero) == false || fpequal751_non_constant_time(t0[1], zero) == false) {
+						s[k].pts_found = 2;
+					}
 				}
-				pts_found++;
 			}
 		}
-		fp2mul751_mont(X3, Z4, t0);
-		fp2mul751_mont(X4, Z3, v);
-		fp2sub751(t0, v, t0);
-		fp2correction751(t0);
-		pts_found--;
-	} while (fpequal751_non_constant_time(t0[0], zero) == true && fpequal751_non_constant_time(t0[1], zero) == true);
+	}
+}
+
+
+static void get_3_torsion_pt(f2elm_t A, unsigned int r, point_full_proj_t R, const f2elm_t one)
+{ // Recomputes the point generate_3_torsion_basis_hint finds at counter value r: R = [2^372](x_r:1), with its y-coordinate.
+	point_proj_t P;
+	felm_t t0, t1, t2;
+
+	get_X_on_curve(A, &r, P->X, t0, t1, t2);
+	fp2copy751(one, P->Z);                           // Z = 1
+	xDBLe(P, P, A, one, 372);
+	fp2copy751(P->X, R->X);
+	fp2copy751(P->Z, R->Z);
+	basis_point_y(A, R);
+}
+
+
+void generate_3_torsion_basis_from_hint(f2elm_t A, point_full_proj_t R1, point_full_proj_t R2, const unsigned int hint[2], PCurveIsogenyStruct CurveIsogeny)
+{ // Produces the basis generate_3_torsion_basis_hint found for curve constant A directly from its hint, without the search.
+  // Nothing is checked: a wrong hint gives points that are not a basis for E[3^239].
+	f2elm_t one = {0};
+
+	fpcopy751(CurveIsogeny->Montgomery_one, one[0]);
+	get_3_torsion_pt(A, hint[0], R1, one);
+	get_3_torsion_pt(A, hint[1], R2, one);
 }
 
 
@@ -210,7 +210,7 @@ void fpsqr751_mont(const felm_t ma, felm_t mc)
 { // 751-bit Comba multi-precision squaring, c = a^2 mod p751.
     dfelm_t temp = {0};
 
-    mp_mul(ma, ma, temp, NWORDS_FIELD);
+    mp_sqr(ma, temp, NWORDS_FIELD);
     rdc_mont(temp, mc);
 }
 
@@ -356,13 +356,9 @@ void fpinv751_chain_mont(felm_t a)
 
 void fpinv751_mont(felm_t a)
 { // Field inversion using Montgomery arithmetic, a = a^(-1)*R mod p751.
-    felm_t tt;
+  // Runs in constant time, through the divsteps where 128-bit integers are available and the exponentiation otherwise.
 
-    fpcopy751(a, tt);
-    fpinv751_chain_mont(tt);
-    fpsqr751_mont(tt, tt);
-    fpsqr751_mont(tt, tt);
-    fpmul751_mont(a, tt, a);
+    fpinv751_mont_safegcd(a);
 }
 
 
@@ -460,6 +456,216 @@ void fpinv751_mont_bingcd(felm_t a)
 }
 
 
+#if defined(__SIZEOF_INT128__) && (RADIX == 64)
+
+// Constant-time inversion with the divsteps of Bernstein and Yang, "Fast constant-time gcd computation and modular inversion".
+// Values are held in signed 62-bit limbs, and 62 divsteps at a time are applied to them as one 2x2 transition matrix.
+#define SAFEGCD_LIMBS      13          // 13*62 = 806 bits, room for 751-bit values with a sign
+#define SAFEGCD_BATCHES    35          // 35*62 = 2170 divsteps, at least the floor((49*751+57)/17) = 2168 needed for 751 bits
+#define SAFEGCD_M62        (UINT64_MAX >> 2)
+
+typedef __int128 safegcd_int128;
+typedef struct { int64_t v[SAFEGCD_LIMBS]; } safegcd_signed62;
+
+
+static void safegcd_to_signed62(const digit_t* a, safegcd_signed62* r)
+{ // Splits a 751-bit value into 62-bit limbs
+	unsigned int i, bit;
+
+	for (i = 0; i < SAFEGCD_LIMBS; i++) {
+		bit = 62*i;
+		r->v[i] = a[bit/64] >> (bit%64);
+		if (bit%64 > 2 && bit/64 + 1 < NWORDS_FIELD) {
+			r->v[i] |= a[bit/64 + 1] << (64 - bit%64);
+		}
+		r->v[i] &= SAFEGCD_M62;
+	}
+}
+
+
+static void safegcd_from_signed62(const safegcd_signed62* a, digit_t* r)
+{ // Joins 62-bit limbs, all of them in [0, 2^62), into a 751-bit value
+	unsigned int i, bit;
+
+	for (i = 0; i < NWORDS_FIELD; i++) {
+		r[i] = 0;
+	}
+	for (i = 0; i < SAFEGCD_LIMBS; i++) {
+		bit = 62*i;
+		r[bit/64] |= (digit_t)a->v[i] << (bit%64);
+		if (bit%64 > 2 && bit/64 + 1 < NWORDS_FIELD) {
+			r[bit/64 + 1] |= (digit_t)a->v[i] >> (64 - bit%64);
+		}
+	}
+}
+
+
+static int64_t safegcd_divsteps_62(int64_t delta, uint64_t f0, uint64_t g0, int64_t t[4])
+{ // Applies 62 divsteps to the low words of f and g. Returns the new delta and in t the matrix [u,v;q,r] such that
+  // 2^62*f' = u*f + v*g and 2^62*g' = q*f + r*g.
+	uint64_t u = 1, v = 0, q = 0, r = 1, f = f0, g = g0, c1, c2, x, y, z;
+	int i;
+
+	for (i = 0; i < 62; i++) {
+		c1 = (uint64_t)(-delta >> 63);      // delta > 0
+		c2 = -(g & 1);                      // g odd
+		x = (f ^ c1) - c1;                  // -f if delta > 0, f otherwise
+		y = (u ^ c1) - c1;
+		z = (v ^ c1) - c1;
+		g += x & c2;                        // g = g-f or g+f if g is odd
+		q += y & c2;
+		r += z & c2;
+		c1 &= c2;                           // delta > 0 and g odd: swap, (delta,f,g) = (1-delta,g,(g-f)/2)
+		delta = (delta ^ (int64_t)c1) - (int64_t)c1 + 1;
+		f += g & c1;
+		u += q & c1;
+		v += r & c1;
+		g >>= 1;
+		u <<= 1;
+		v <<= 1;
+	}
+	t[0] = (int64_t)u;
+	t[1] = (int64_t)v;
+	t[2] = (int64_t)q;
+	t[3] = (int64_t)r;
+	return delta;
+}
+
+
+static void safegcd_update_fg(safegcd_signed62* f, safegcd_signed62* g, const int64_t t[4])
+{ // [f,g] = t*[f,g]/2^62, the division is exact
+	safegcd_int128 cf, cg;
+	int i;
+
+	cf = (safegcd_int128)t[0] * f->v[0] + (safegcd_int128)t[1] * g->v[0];
+	cg = (safegcd_int128)t[2] * f->v[0] + (safegcd_int128)t[3] * g->v[0];
+	cf >>= 62;
+	cg >>= 62;
+	for (i = 1; i < SAFEGCD_LIMBS; i++) {
+		cf += (safegcd_int128)t[0] * f->v[i] + (safegcd_int128)t[1] * g->v[i];
+		cg += (safegcd_int128)t[2] * f->v[i] + (safegcd_int128)t[3] * g->v[i];
+		f->v[i-1] = (int64_t)cf & SAFEGCD_M62;
+		g->v[i-1] = (int64_t)cg & SAFEGCD_M62;
+		cf >>= 62;
+		cg >>= 62;
+	}
+	f->v[SAFEGCD_LIMBS-1] = (int64_t)cf;
+	g->v[SAFEGCD_LIMBS-1] = (int64_t)cg;
+}
+
+
+static void safegcd_update_de(safegcd_signed62* d, safegcd_signed62* e, const int64_t t[4], const safegcd_signed62* m, uint64_t minv62)
+{ // [d,e] = t*[d,e]/2^62 mod m, keeping both in (-2*m, m)
+	int64_t sd, se, md, me;
+	safegcd_int128 cd, ce;
+	int i;
+
+	// start md,me at the multiples of m that bring negative inputs back in range, then make the low 62 bits vanish
+	sd = d->v[SAFEGCD_LIMBS-1] >> 63;
+	se = e->v[SAFEGCD_LIMBS-1] >> 63;
+	md = (t[0] & sd) + (t[1] & se);
+	me = (t[2] & sd) + (t[3] & se);
+	cd = (safegcd_int128)t[0] * d->v[0] + (safegcd_int128)t[1] * e->v[0];
+	ce = (safegcd_int128)t[2] * d->v[0] + (safegcd_int128)t[3] * e->v[0];
+	md -= (minv62 * (uint64_t)cd + md) & SAFEGCD_M62;
+	me -= (minv62 * (uint64_t)ce + me) & SAFEGCD_M62;
+	cd += (safegcd_int128)m->v[0] * md;
+	ce += (safegcd_int128)m->v[0] * me;
+	cd >>= 62;
+	ce >>= 62;
+	for (i = 1; i < SAFEGCD_LIMBS; i++) {
+		cd += (safegcd_int128)t[0] * d->v[i] + (safegcd_int128)t[1] * e->v[i] + (safegcd_int128)m->v[i] * md;
+		ce += (safegcd_int128)t[2] * d->v[i] + (safegcd_int128)t[3] * e->v[i] + (safegcd_int128)m->v[i] * me;
+		d->v[i-1] = (int64_t)cd & SAFEGCD_M62;
+		e->v[i-1] = (int64_t)ce & SAFEGCD_M62;
+		cd >>= 62;
+		ce >>= 62;
+	}
+	d->v[SAFEGCD_LIMBS-1] = (int64_t)cd;
+	e->v[SAFEGCD_LIMBS-1] = (int64_t)ce;
+}
+
+
+static void safegcd_normalize(safegcd_signed62* r, int64_t sign, const safegcd_signed62* m)
+{ // r = r or -r for a negative sign, brought from (-2*m, m) to [0, m) with limbs in [0, 2^62)
+	int64_t mask;
+	int i, pass;
+
+	mask = r->v[SAFEGCD_LIMBS-1] >> 63;
+	for (i = 0; i < SAFEGCD_LIMBS; i++) {
+		r->v[i] += m->v[i] & mask;
+	}
+	mask = sign >> 63;
+	for (i = 0; i < SAFEGCD_LIMBS; i++) {
+		r->v[i] = (r->v[i] ^ mask) - mask;
+	}
+	for (pass = 0; pass < 2; pass++) {
+		for (i = 0; i < SAFEGCD_LIMBS - 1; i++) {
+			r->v[i+1] += r->v[i] >> 62;
+			r->v[i] &= SAFEGCD_M62;
+		}
+		if (pass == 0) {
+			mask = r->v[SAFEGCD_LIMBS-1] >> 63;
+			for (i = 0; i < SAFEGCD_LIMBS; i++) {
+				r->v[i] += m->v[i] & mask;
+			}
+		}
+	}
+}
+
+
+void fpinv751_mont_safegcd(felm_t a)
+{ // Constant-time field inversion via divsteps using Montgomery arithmetic, a = a^-1*R mod p751.
+	safegcd_signed62 m, f, g, d = {{0}}, e;
+	felm_t t;
+	uint64_t minv62;
+	int64_t delta = 1, tr[4];
+	int i;
+
+	fpcopy751(a, t);
+	fpcorrection751(t);
+	safegcd_to_signed62((digit_t*)&p751, &m);
+	safegcd_to_signed62(t, &g);
+	f = m;
+	// d/e tracks f/g, so starting from e = R^2 the result comes out as R^2/(a*R) = a^-1*R
+	safegcd_to_signed62((digit_t*)&Montgomery_R2, &e);
+
+	minv62 = (uint64_t)m.v[0];                       // Newton iteration for p751^-1 mod 2^64
+	for (i = 0; i < 5; i++) {
+		minv62 *= 2 - (uint64_t)m.v[0] * minv62;
+	}
+
+	for (i = 0; i < SAFEGCD_BATCHES; i++) {
+		delta = safegcd_divsteps_62(delta, (uint64_t)f.v[0], (uint64_t)g.v[0], tr);
+		safegcd_update_de(&d, &e, tr, &m, minv62);
+		safegcd_update_fg(&f, &g, tr);
+	}
+
+	// g = 0 and f = +-1 now, so the inverse is d up to the sign of f
+	safegcd_normalize(&d, f.v[SAFEGCD_LIMBS-1], &m);
+	safegcd_from_signed62(&d, a);
+	clear_words((void*)&d, sizeof(d)/sizeof(digit_t));
+	clear_words((void*)&e, sizeof(e)/sizeof(digit_t));
+	clear_words((void*)&g, sizeof(g)/sizeof(digit_t));
+	clear_words((void*)t, NWORDS_FIELD);
+}
+
+#else
+
+void fpinv751_mont_safegcd(felm_t a)
+{ // Without 128-bit integers the constant-time inversion falls back to the exponentiation
+	felm_t tt;
+
+	fpcopy751(a, tt);
+	fpinv751_chain_mont(tt);
+	fpsqr751_mont(tt, tt);
+	fpsqr751_mont(tt, tt);
+	fpmul751_mont(a, tt, a);
+}
+
+#endif
+
+
 /***********************************************/
 /************* GF(p^2) FUNCTIONS ***************/
 
@@ -512,6 +718,8 @@ void fp2correction751(f2elm_t a)
 }
 
 
+#if !defined(X64_ASM_KERNELS)    // Otherwise provided by the x64 implementation
+
 void fp2sqr751_mont(const f2elm_t a, f2elm_t c)
 { // GF(p751^2) squaring using Montgomery arithmetic, c = a^2 in GF(p751^2).
   // Inputs: a = a0+a1*i, where a0, a1 are in [0, 2*p751-1]
@@ -552,6 +760,8 @@ void fp2mul751_mont(const f2elm_t a, const f2elm_t b, f2elm_t c)
     rdc_mont(tt2, c[1]);                             // c[1] = (a0+a1)*(b0+b1) - a0*b0 - a1*b1
 }
 
+#endif
+
 
 void to_fp2mont(const f2elm_t a, f2elm_t mc)
 { // Conversion of a GF(p751^2) element to Montgomery representation,
@@ -654,8 +864,7 @@ void select_f2elm(const f2elm_t x, const f2elm_t y, f2elm_t z, const digit_t opt
 
 void mont_n_way_inv(const f2elm_t* vec, const int n, f2elm_t* out)
 { // n-way simultaneous inversion using Montgomery's trick.
-  // SECURITY NOTE: This function does not run in constant time.
-  // Also, vec and out CANNOT be the same variable!
+  // vec and out CANNOT be the same variable!
 	f2elm_t t1;
 	int i;
 
@@ -665,7 +874,7 @@ void mont_n_way_inv(const f2elm_t* vec, const int n, f2elm_t* out)
 	}
 
 	fp2copy751(out[n-1], t1);                        // t1 = 1/out[n-1]
-	fp2inv751_mont_bingcd(t1);
+	fp2inv751_mont(t1);
 
 	for (i = n-1; i >= 1; i--) {
 		fp2mul751_mont(out[i-1], t1, out[i]);        // out[i] = t1*out[i-1]
@@ -680,7 +889,6 @@ void mont_n_way_inv_batched(const f2elm_t* vec, const int n, f2elm_t* out, batch
   // Also, vec and out CANNOT be the same variable!
 	f2elm_t t1;
 	int i;
-  int tempCnt;
 
 	fp2copy751(vec[0], out[0]);                      // out[0] = vec[0]
 	for (i = 1; i < n; i++) {
@@ -688,22 +896,7 @@ void mont_n_way_inv_batched(const f2elm_t* vec, const int n, f2elm_t* out, batch
 	}
 
 	fp2copy751(out[n-1], t1);                        // t1 = 1/out[n-1]
-
-  pthread_mutex_lock(&batch->arrayLock);
-	fp2copy751(t1, batch->invArray[batch->cntr]);
-	tempCnt = batch->cntr;
-	batch->cntr++;
-	pthread_mutex_unlock(&batch->arrayLock);
-
-  if (tempCnt+1 == batch->batchSize) {
-    partial_batched_inv(batch->invArray, batch->invDest, batch->batchSize);
-    for (int i = 0; i < batch->batchSize - 1; i++) {
-      sem_post(&batch->sign_sem);
-    }
-  } else {
-    sem_wait(&batch->sign_sem);
-  }
-  fp2copy751(batch->invDest[tempCnt], t1);
+	batch_invert(t1, batch);
 
 	for (i = n-1; i >= 1; i--) {
 		fp2mul751_mont(out[i-1], t1, out[i]);        // out[i] = t1*out[i-1]
@@ -962,7 +1155,7 @@ bool is_cube_Fp2(f2elm_t u, PCurveIsogenyStruct CurveIsogeny)
 	fpsqr751_mont(u[0], v[0]);              // v0 = u0^2
     fpsqr751_mont(u[1], v[1]);              // v1 = u1^2
     fpadd751(v[0], v[1], t0);               // t0 = v0+v1
-    fpinv751_mont_bingcd(t0);               // Fp inversion with binary Euclid
+    fpinv751_mont(t0);                      // Fp inversion, constant time
     fpsub751(v[0], v[1], v[0]);             // v0 = v0-v1
     fpmul751_mont(u[0], u[1], v[1]);        // v1 = u0*u1
     fpadd751(v[1], v[1], v[1]);             // v1 = 2*v1
@@ -987,6 +1180,74 @@ bool is_cube_Fp2(f2elm_t u, PCurveIsogenyStruct CurveIsogeny)
     }
 }
 
+void is_cube_Fp2_batch(const f2elm_t* u, bool* cube, int n, PCurveIsogenyStruct CurveIsogeny)
+{ // cube[i] = is_cube_Fp2(u[i]) for n GF(p751^2) elements. Up to BASIS_BATCH of them share one inversion through
+  // Montgomery's trick, and their exponentiations, which are independent, are interleaved step by step.
+    f2elm_t v[BASIS_BATCH];
+    felm_t t0[BASIS_BATCH], prod[BASIS_BATCH], inv, t, zero = {0}, one = {0};
+    digit_t isZero[BASIS_BATCH], z;
+    unsigned int e, j;
+    int i, k, m;
+
+    fpcopy751(CurveIsogeny->Montgomery_one, one);
+    for (i = 0; i < n; i += m) {
+        m = (n - i < BASIS_BATCH) ? n - i : BASIS_BATCH;
+
+        for (k = 0; k < m; k++) {
+            fpsqr751_mont(u[i+k][0], v[k][0]);          // v0 = u0^2
+            fpsqr751_mont(u[i+k][1], v[k][1]);          // v1 = u1^2
+            fpadd751(v[k][0], v[k][1], t0[k]);          // t0 = v0+v1
+            fpcopy751(t0[k], t);
+            fpcorrection751(t);
+            for (j = 0, z = 0; j < NWORDS_FIELD; j++) {
+                z |= t[j];
+            }
+            isZero[k] = 0 - (digit_t)is_digit_zero_ct(z); // u = 0 is no cube, its t0 must not zero the product
+            for (j = 0; j < NWORDS_FIELD; j++) {        // t0 = one if u = 0, selected without branching on u
+                t0[k][j] = (t0[k][j] & ~isZero[k]) | (one[j] & isZero[k]);
+            }
+            if (k == 0) {
+                fpcopy751(t0[k], prod[k]);
+            } else {
+                fpmul751_mont(prod[k-1], t0[k], prod[k]);
+            }
+        }
+        fpcopy751(prod[m-1], inv);
+        fpinv751_mont(inv);
+        for (k = m-1; k > 0; k--) {
+            fpmul751_mont(inv, prod[k-1], t);           // t = 1/t0[k]
+            fpmul751_mont(inv, t0[k], inv);
+            fpcopy751(t, t0[k]);
+        }
+        fpcopy751(inv, t0[0]);
+
+        for (k = 0; k < m; k++) {
+            fpsub751(v[k][0], v[k][1], v[k][0]);        // v0 = v0-v1
+            fpmul751_mont(u[i+k][0], u[i+k][1], v[k][1]); // v1 = u0*u1
+            fpadd751(v[k][1], v[k][1], v[k][1]);        // v1 = 2*v1
+            fpneg751(v[k][1]);                          // v1 = -v1
+            fpmul751_mont(v[k][0], t0[k], v[k][0]);     // v0 = v0*t0
+            fpmul751_mont(v[k][1], t0[k], v[k][1]);     // v1 = v1*t0
+        }
+
+        for (e = 0; e < 372; e++) {
+            for (k = 0; k < m; k++) {
+                sqr_Fp2_cycl(v[k], one);
+            }
+        }
+        for (e = 0; e < 238; e++) {
+            for (k = 0; k < m; k++) {
+                cube_Fp2_cycl(v[k], one);
+            }
+        }
+
+        for (k = 0; k < m; k++) {
+            fp2correction751(v[k]);
+            cube[i+k] = isZero[k] == 0 && fpequal751_non_constant_time(v[k][0], one) == true && fpequal751_non_constant_time(v[k][1], zero) == true;
+        }
+    }
+}
+
 
 void multiply(const digit_t* a, const digit_t* b, digit_t* c, const unsigned int nwords)
 { // Multiprecision comba multiply, c = a*b, where lng(a) = lng(b) = nwords.
@@ -1293,45 +1554,14 @@ void inv_mod_orderA(const digit_t* a, digit_t* c)
 }
 
 void partial_batched_inv (const f2elm_t* vec, f2elm_t* dest, const int n)
-{
+{ // n-way inversion through the GF(p751) norms a0^2+a1^2 of the elements (0 stays 0).
+  // The scratch lives on the heap, so n is not bounded by the stack. Without memory the elements are inverted one by one.
 	int i;
-	felm_t t0[n]; //a portion of vec elements
-	felm_t t1[n]; //b portion of vec elements
-	felm_t den[n]; //denominator of vec elements
-
-	//convert f2elm to felm denominators
-	for (i = 0; i < n; i++) {
-		//compute den[i] = a[i][0]^2 + a[i][1]^2
-		fpsqr751_mont((vec[i])[0], t0[i]);
-		fpsqr751_mont((vec[i])[1], t1[i]);
-		fpadd751(t0[i], t1[i], den[i]);
-	}
-
-
-	//invert felms
-	felm_t a[n];
-
-	fpcopy751(den[0], a[0]);                      // a[0] = den[0]
-	for (i = 1; i < n; i++) {
-		fpmul751_mont(a[i-1], den[i], a[i]);    // a[i] = a[i-1]*den[i]
-	}
-
 
-	felm_t a_inv;
-	fpcopy751(a[n-1], a_inv);                        // a_inv = 1/a[n-1]
-	fpinv751_mont_bingcd(a_inv);
-
-	for (i = n-1; i >= 1; i--) {
-		fpmul751_mont(a[i-1], a_inv, a[i]);        // a[i] = a_inv*dest[i-1]
-		fpmul751_mont(a_inv, den[i], a_inv);              // a_inv = a_inv*den[i]
-	}
-
-	fpcopy751(a_inv, a[0]);                          // dest[0] = a_inv
-
-	//convert from felm denominators to f2elm
-	for (i = 0; i < n; i++) {
-		fpmul751_mont(a[i],vec[i][0],dest[i][0]);
-		fpneg751((vec[i])[1]);
-		fpmul751_mont(a[i],vec[i][1],dest[i][1]);
+	if (batched_inv_pool(vec, dest, n, NULL, 0) != CRYPTO_SUCCESS) {
+		for (i = 0; i < n; i++) {
+			fp2copy751(vec[i], dest[i]);
+			fp2inv751_mont(dest[i]);
+		}
 	}
 }
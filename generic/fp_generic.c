@@ -197,6 +197,44 @@ void mp_mul_comba(const digit_t* a, const digit_t* b, digit_t* c, const unsigned
 }
 
 
+void mp_sqr(const digit_t* a, digit_t* c, const unsigned int nwords)
+{ // Multiprecision comba squaring, c = a^2, where lng(a) = nwords.
+  // Each cross product a[j]*a[i-j], j < i-j, is computed once and doubled before the square term is added.
+    unsigned int i, j;
+    digit_t t = 0, u = 0, v = 0, s0, s1, s2, UV[2];
+    unsigned int carry = 0;
+
+    for (i = 0; i < 2*nwords-1; i++) {
+        s0 = 0;
+        s1 = 0;
+        s2 = 0;
+        for (j = (i < nwords) ? 0 : i-nwords+1; j < i-j; j++) {
+            MUL(a[j], a[i-j], UV+1, UV[0]); 
+            ADDC(0, UV[0], s0, carry, s0); 
+            ADDC(carry, UV[1], s1, carry, s1); 
+            s2 += carry;
+        }
+        SHIFTL(s2, s1, 1, s2, RADIX);
+        SHIFTL(s1, s0, 1, s1, RADIX);
+        s0 <<= 1;
+        if ((i & 1) == 0) {
+            MUL(a[i/2], a[i/2], UV+1, UV[0]); 
+            ADDC(0, UV[0], s0, carry, s0); 
+            ADDC(carry, UV[1], s1, carry, s1); 
+            s2 += carry;
+        }
+        ADDC(0, s0, v, carry, v); 
+        ADDC(carry, s1, u, carry, u); 
+        t += s2 + carry;
+        c[i] = v;
+        v = u; 
+        u = t;
+        t = 0;
+    }
+    c[2*nwords-1] = v; 
+}
+
+
 void rdc_mont(const dfelm_t ma, felm_t mc)
 { // Efficient Montgomery reduction using comba and exploiting the special form of the prime p751.
   // mc = ma*R^-1 mod p751x2, where R = 2^768.
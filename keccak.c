@@ -69,53 +69,232 @@ void keccakf(uint64_t st[25], int rounds)
     }
 }
 
-// compute a keccak hash (md) of given byte length from "in"
+// start an incremental hash producing mdlen bytes
 
-int keccak(const uint8_t *in, int inlen, uint8_t *md, int mdlen)
+void keccak_init(keccak_state *ks, int mdlen)
 {
-    uint64_t st[25];    
-    uint8_t temp[200];
-    int i, rsiz, rsizw;
+    memset(ks->st, 0, sizeof(ks->st));
+    ks->pos = 0;
+    ks->rsiz = 200 - 2 * mdlen;
+    ks->mdlen = mdlen;
+}
 
-    rsiz = 200 - 2 * mdlen;
-    rsizw = rsiz / 8;
-    
-    memset(st, 0, sizeof(st));
+// absorb inlen more bytes of input
 
-    //printf("check1\n");
+void keccak_absorb(keccak_state *ks, const uint8_t *in, int inlen)
+{
+    int i, rsizw = ks->rsiz / 8;
+
+    // complete a buffered block first
+    if (ks->pos > 0) {
+        int take = ks->rsiz - ks->pos;
+        if (take > inlen)
+            take = inlen;
+        memcpy(ks->buf + ks->pos, in, take);
+        ks->pos += take;
+        in += take;
+        inlen -= take;
 
-    for ( ; inlen >= rsiz; inlen -= rsiz, in += rsiz) {
+        if (ks->pos < ks->rsiz)
+            return;
         for (i = 0; i < rsizw; i++)
-            st[i] ^= ((uint64_t *) in)[i];
-        keccakf(st, KECCAK_ROUNDS);
+            ks->st[i] ^= ((uint64_t *) ks->buf)[i];
+        keccakf(ks->st, KECCAK_ROUNDS);
+        ks->pos = 0;
     }
 
-    //printf("check2\n");
-    
-    //printf("in: %d, inlen")
-    
-    // last block and padding
-    memcpy(temp, in, inlen);
-    temp[inlen++] = 1;
+    // whole blocks straight from the input
+    for ( ; inlen >= ks->rsiz; inlen -= ks->rsiz, in += ks->rsiz) {
+        for (i = 0; i < rsizw; i++)
+            ks->st[i] ^= ((uint64_t *) in)[i];
+        keccakf(ks->st, KECCAK_ROUNDS);
+    }
 
-    //printf("check2.5\n");
+    memcpy(ks->buf, in, inlen);
+    ks->pos = inlen;
+}
 
-    memset(temp + inlen, 0, rsiz - inlen);
-    temp[rsiz - 1] |= 0x80;
+// last block and padding, then output the hash
 
-    //printf("check3\n");
+void keccak_squeeze(keccak_state *ks, uint8_t *md)
+{
+    int i, rsizw = ks->rsiz / 8;
+
+    ks->buf[ks->pos++] = 1;
+    memset(ks->buf + ks->pos, 0, ks->rsiz - ks->pos);
+    ks->buf[ks->rsiz - 1] |= 0x80;
 
     for (i = 0; i < rsizw; i++)
-        st[i] ^= ((uint64_t *) temp)[i];
+        ks->st[i] ^= ((uint64_t *) ks->buf)[i];
 
-    //printf("check4\n");
+    keccakf(ks->st, KECCAK_ROUNDS);
 
-    keccakf(st, KECCAK_ROUNDS);
+    memcpy(md, ks->st, ks->mdlen);
+}
 
-    //printf("check5\n");
+// compute a keccak hash (md) of given byte length from "in"
 
-    memcpy(md, st, mdlen);
+int keccak(const uint8_t *in, int inlen, uint8_t *md, int mdlen)
+{
+    keccak_state ks;
+
+    keccak_init(&ks, mdlen);
+    keccak_absorb(&ks, in, inlen);
+    keccak_squeeze(&ks, md);
 
     return 0;
 }
 
+// multi-buffer keccak
+
+#if (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(_AMD64_))
+#define KECCAK_MULTI_BUFFER
+#include <immintrin.h>
+#endif
+
+static int simd_level = -1;     // not detected yet
+static int simd_cap = KECCAK_SIMD_AVX512;
+
+int keccak_simd_level(void)
+{
+    if (simd_level < 0) {
+        int level = KECCAK_SIMD_NONE;
+#ifdef KECCAK_MULTI_BUFFER
+        __builtin_cpu_init();
+        if (__builtin_cpu_supports("avx512f"))
+            level = KECCAK_SIMD_AVX512;
+        else if (__builtin_cpu_supports("avx2"))
+            level = KECCAK_SIMD_AVX2;
+#endif
+        simd_level = level;
+    }
+    return (simd_level < simd_cap) ? simd_level : simd_cap;
+}
+
+void keccak_set_simd_level(int level)
+{
+    simd_cap = level;
+}
+
+// lane-parallel permutation and sponge, written once for both vector widths:
+// V is the vector type, N the number of lanes and the remaining macros the operations on V
+
+#define KECCAK_MULTI(NAME, TARGET, V, N, LOAD, STORE, XOR, ROL, ANDNXOR, SET1)                  \
+__attribute__((target(TARGET)))                                                                 \
+static void NAME##_permute(V st[25])                                                           \
+{                                                                                               \
+    int i, j, round;                                                                            \
+    V t, bc[5];                                                                                 \
+                                                                                                \
+    for (round = 0; round < KECCAK_ROUNDS; round++) {                                           \
+        for (i = 0; i < 5; i++)                                                                 \
+            bc[i] = XOR(XOR(XOR(st[i], st[i + 5]), XOR(st[i + 10], st[i + 15])), st[i + 20]);   \
+        for (i = 0; i < 5; i++) {                                                               \
+            t = XOR(bc[(i + 4) % 5], ROL(bc[(i + 1) % 5], 1));                                  \
+            for (j = 0; j < 25; j += 5)                                                         \
+                st[j + i] = XOR(st[j + i], t);                                                  \
+        }                                                                                       \
+        t = st[1];                                                                              \
+        for (i = 0; i < 24; i++) {                                                              \
+            j = keccakf_piln[i];                                                                \
+            bc[0] = st[j];                                                                      \
+            st[j] = ROL(t, keccakf_rotc[i]);                                                    \
+            t = bc[0];                                                                          \
+        }                                                                                       \
+        for (j = 0; j < 25; j += 5) {                                                           \
+            for (i = 0; i < 5; i++)                                                             \
+                bc[i] = st[j + i];                                                              \
+            for (i = 0; i < 5; i++)                                                             \
+                st[j + i] = ANDNXOR(bc[i], bc[(i + 1) % 5], bc[(i + 2) % 5]);                   \
+        }                                                                                       \
+        st[0] = XOR(st[0], SET1(keccakf_rndc[round]));                                          \
+    }                                                                                           \
+}                                                                                               \
+                                                                                                \
+__attribute__((target(TARGET)))                                                                 \
+static void NAME(const uint8_t *in[N], int inlen, uint8_t *md[N], int mdlen)                   \
+{                                                                                               \
+    V st[25];                                                                                   \
+    uint64_t lanes[N], out[N][25];                                                              \
+    uint8_t temp[N][200];                                                                       \
+    int i, k, off, rsiz = 200 - 2 * mdlen, rsizw = rsiz / 8;                                    \
+                                                                                                \
+    for (i = 0; i < 25; i++)                                                                    \
+        st[i] = SET1(0);                                                                        \
+                                                                                                \
+    for (off = 0; inlen - off >= rsiz; off += rsiz) {                                           \
+        for (i = 0; i < rsizw; i++) {                                                           \
+            for (k = 0; k < N; k++)                                                             \
+                memcpy(&lanes[k], in[k] + off + 8 * i, 8);                                      \
+            st[i] = XOR(st[i], LOAD(lanes));                                                    \
+        }                                                                                       \
+        NAME##_permute(st);                                                                     \
+    }                                                                                           \
+                                                                                                \
+    for (k = 0; k < N; k++) {                                                                   \
+        memcpy(temp[k], in[k] + off, inlen - off);                                              \
+        temp[k][inlen - off] = 1;                                                               \
+        memset(temp[k] + inlen - off + 1, 0, rsiz - (inlen - off) - 1);                         \
+        temp[k][rsiz - 1] |= 0x80;                                                              \
+    }                                                                                           \
+    for (i = 0; i < rsizw; i++) {                                                               \
+        for (k = 0; k < N; k++)                                                                 \
+            memcpy(&lanes[k], temp[k] + 8 * i, 8);                                              \
+        st[i] = XOR(st[i], LOAD(lanes));                                                        \
+    }                                                                                           \
+    NAME##_permute(st);                                                                         \
+                                                                                                \
+    for (i = 0; i < (mdlen + 7) / 8; i++) {                                                     \
+        STORE(lanes, st[i]);                                                                    \
+        for (k = 0; k < N; k++)                                                                 \
+            out[k][i] = lanes[k];                                                               \
+    }                                                                                           \
+    for (k = 0; k < N; k++)                                                                     \
+        memcpy(md[k], out[k], mdlen);                                                           \
+}
+
+#ifdef KECCAK_MULTI_BUFFER
+
+#define AVX2_LOAD(p)            _mm256_loadu_si256((const __m256i *)(p))
+#define AVX2_STORE(p, x)        _mm256_storeu_si256((__m256i *)(p), x)
+#define AVX2_ROL(x, n)          _mm256_or_si256(_mm256_sll_epi64(x, _mm_cvtsi32_si128(n)), _mm256_srl_epi64(x, _mm_cvtsi32_si128(64 - (n))))
+#define AVX2_ANDNXOR(a, b, c)   _mm256_xor_si256(a, _mm256_andnot_si256(b, c))
+#define AVX2_SET1(x)            _mm256_set1_epi64x((long long)(x))
+
+KECCAK_MULTI(keccak_x4_avx2, "avx2", __m256i, 4, AVX2_LOAD, AVX2_STORE, _mm256_xor_si256, AVX2_ROL, AVX2_ANDNXOR, AVX2_SET1)
+
+#define AVX512_LOAD(p)          _mm512_loadu_si512((const void *)(p))
+#define AVX512_STORE(p, x)      _mm512_storeu_si512((void *)(p), x)
+#define AVX512_ROL(x, n)        _mm512_rolv_epi64(x, _mm512_set1_epi64(n))
+#define AVX512_ANDNXOR(a, b, c) _mm512_ternarylogic_epi64(a, b, c, 0xD2)    // a ^ (~b & c)
+#define AVX512_SET1(x)          _mm512_set1_epi64((long long)(x))
+
+KECCAK_MULTI(keccak_x8_avx512, "avx512f", __m512i, 8, AVX512_LOAD, AVX512_STORE, _mm512_xor_si512, AVX512_ROL, AVX512_ANDNXOR, AVX512_SET1)
+
+#endif
+
+void keccak_x4(const uint8_t *in[4], int inlen, uint8_t *md[4], int mdlen)
+{
+    int k;
+
+#ifdef KECCAK_MULTI_BUFFER
+    if (keccak_simd_level() >= KECCAK_SIMD_AVX2) {
+        keccak_x4_avx2(in, inlen, md, mdlen);
+        return;
+    }
+#endif
+    for (k = 0; k < 4; k++)
+        keccak(in[k], inlen, md[k], mdlen);
+}
+
+void keccak_x8(const uint8_t *in[8], int inlen, uint8_t *md[8], int mdlen)
+{
+#ifdef KECCAK_MULTI_BUFFER
+    if (keccak_simd_level() >= KECCAK_SIMD_AVX512) {
+        keccak_x8_avx512(in, inlen, md, mdlen);
+        return;
+    }
+#endif
+    keccak_x4(in, inlen, md, mdlen);
+    keccak_x4(in + 4, inlen, md + 4, mdlen);
+}
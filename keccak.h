@@ -18,8 +18,41 @@
 // compute a keccak hash (md) of given byte length from "in"
 int keccak(const uint8_t *in, int inlen, uint8_t *md, int mdlen);
 
+// incremental hashing: the input can be absorbed in pieces of any length,
+// squeezing gives the same hash as keccak() over the concatenated pieces
+typedef struct {
+    uint64_t st[25];
+    uint8_t buf[200];   // partial block not yet absorbed
+    int pos;            // bytes in buf
+    int rsiz;           // rate in bytes
+    int mdlen;
+} keccak_state;
+
+void keccak_init(keccak_state *ks, int mdlen);
+
+void keccak_absorb(keccak_state *ks, const uint8_t *in, int inlen);
+
+// pad, permute and write the mdlen byte hash; ks has to be initialized again before reuse
+void keccak_squeeze(keccak_state *ks, uint8_t *md);
+
 // update the state
 void keccakf(uint64_t st[25], int norounds);
 
+// multi-buffer hashing: 4 (8) independent inputs of the same length are hashed together,
+// md[i] receives the same hash keccak() computes for in[i]
+void keccak_x4(const uint8_t *in[4], int inlen, uint8_t *md[4], int mdlen);
+void keccak_x8(const uint8_t *in[8], int inlen, uint8_t *md[8], int mdlen);
+
+// instruction set used by keccak_x4/keccak_x8
+#define KECCAK_SIMD_NONE    0
+#define KECCAK_SIMD_AVX2    1   // 4 lanes per permutation
+#define KECCAK_SIMD_AVX512  2   // 8 lanes per permutation
+
+// best level supported by the processor, or the level it was capped at
+int keccak_simd_level(void);
+
+// cap the level used by keccak_x4/keccak_x8 (benchmarks); a level above what the processor supports is ignored
+void keccak_set_simd_level(int level);
+
 #endif
 
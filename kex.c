@@ -511,46 +511,26 @@ CRYPTO_STATUS EphemeralSecretAgreement_A(const unsigned char* PrivateKeyA, const
     return Status;
 }
 
-CRYPTO_STATUS SecretAgreement_A(unsigned char* pPrivateKeyA, unsigned char* pPublicKeyB, unsigned char* pSharedSecretA, PCurveIsogenyStruct CurveIsogeny, point_proj_t kerngen, batch_struct* batch)
-{ // Alice's shared secret generation
-  // It produces a shared secret key pSharedSecretA using her secret key pPrivateKeyA and Bob's public key pPublicKeyB
-  // Inputs: Alice's pPrivateKeyA is an even integer in the range [2, oA-2], where oA = 2^372 (i.e., 372 bits in total).
-  //         Bob's pPublicKeyB consists of 4 elements in GF(p751^2), i.e., 751 bytes in total.
-  // Output: a shared secret pSharedSecretA that consists of one element in GF(p751^2), i.e., 1502 bits in total.
-  // CurveIsogeny must be set up in advance using SIDH_curve_initialize().
+static CRYPTO_STATUS SecretAgreement_walk_A(point_proj_t R, f2elm_t A, unsigned char* pSharedSecretA, PCurveIsogenyStruct CurveIsogeny, batch_struct* batch, const int* cancel)
+{ // Alice's isogeny walk from her kernel generator R on Bob's curve with coefficient A (Montgomery representation),
+  // common to SecretAgreement_A and SecretAgreement_Prepared_A. R and A are cleared.
     unsigned int pwords = NBITS_TO_NWORDS(CurveIsogeny->pwordbits);
     unsigned int i, row, m, index = 0, pts_index[MAX_INT_POINTS_ALICE], npts = 0;
-    point_proj_t R, pts[MAX_INT_POINTS_ALICE];
-    publickey_t* PublicKeyB = (publickey_t*)pPublicKeyB;
-    f2elm_t jinv, coeff[5], A, C = {0}, PKB2, PKB3, PKB4;
-    CRYPTO_STATUS Status = CRYPTO_ERROR_UNKNOWN;
-
-    if (pPrivateKeyA == NULL || pPublicKeyB == NULL || pSharedSecretA == NULL || is_CurveIsogenyStruct_null(CurveIsogeny)) {
-        return CRYPTO_ERROR_INVALID_PARAMETER;
-    }
-
-    to_fp2mont(((f2elm_t*)PublicKeyB)[0], A);         // Extracting and converting Bob's public curve parameters to Montgomery representation
-    to_fp2mont(((f2elm_t*)PublicKeyB)[1], PKB2);
-    to_fp2mont(((f2elm_t*)PublicKeyB)[2], PKB3);
-    to_fp2mont(((f2elm_t*)PublicKeyB)[3], PKB4);
+    point_proj_t pts[MAX_INT_POINTS_ALICE];
+    f2elm_t jinv, coeff[5], C = {0};
+    CRYPTO_STATUS Status = CRYPTO_SUCCESS;
 
     fpcopy751(CurveIsogeny->C, C[0]);
     to_mont(C[0], C[0]);
 
-    if (kerngen == NULL) {
-        Status = ladder_3_pt(PKB2, PKB3, PKB4, (digit_t*)pPrivateKeyA, ALICE, R, A, CurveIsogeny);
-        if (Status != CRYPTO_SUCCESS) {
-            return Status;
-        }
-    } else {
-        fp2copy751(kerngen->X, R->X);
-        fp2copy751(kerngen->Z, R->Z);
-    }
-
     first_4_isog(R, A, A, C, CurveIsogeny);
 
     index = 0;
     for (row = 1; row < MAX_Alice; row++) {
+        if (cancel != NULL && __atomic_load_n(cancel, __ATOMIC_RELAXED)) {
+            Status = CRYPTO_ERROR_CANCELLED;
+            goto cleanup;
+        }
         while (index < MAX_Alice-row) {
             fp2copy751(R->X, pts[npts]->X);
             fp2copy751(R->Z, pts[npts]->Z);
@@ -582,7 +562,7 @@ CRYPTO_STATUS SecretAgreement_A(unsigned char* pPrivateKeyA, unsigned char* pPub
 
     from_fp2mont(jinv, (felm_t*)pSharedSecretA);      // Converting back to standard representation
 
-// Cleanup:
+cleanup:
     clear_words((void*)R, 2*2*pwords);
     clear_words((void*)pts, MAX_INT_POINTS_ALICE*2*2*pwords);
     clear_words((void*)A, 2*pwords);
@@ -594,6 +574,78 @@ CRYPTO_STATUS SecretAgreement_A(unsigned char* pPrivateKeyA, unsigned char* pPub
 }
 
 
+CRYPTO_STATUS SecretAgreement_A(unsigned char* pPrivateKeyA, unsigned char* pPublicKeyB, unsigned char* pSharedSecretA, PCurveIsogenyStruct CurveIsogeny, point_proj_t kerngen, batch_struct* batch, const int* cancel)
+{ // Alice's shared secret generation
+  // It produces a shared secret key pSharedSecretA using her secret key pPrivateKeyA and Bob's public key pPublicKeyB
+  // Inputs: Alice's pPrivateKeyA is an even integer in the range [2, oA-2], where oA = 2^372 (i.e., 372 bits in total).
+  //         Bob's pPublicKeyB consists of 4 elements in GF(p751^2), i.e., 751 bytes in total.
+  // Output: a shared secret pSharedSecretA that consists of one element in GF(p751^2), i.e., 1502 bits in total.
+  // CurveIsogeny must be set up in advance using SIDH_curve_initialize().
+    point_proj_t R;
+    publickey_t* PublicKeyB = (publickey_t*)pPublicKeyB;
+    f2elm_t A, PKB2, PKB3, PKB4;
+    CRYPTO_STATUS Status = CRYPTO_ERROR_UNKNOWN;
+
+    if (pPrivateKeyA == NULL || pPublicKeyB == NULL || pSharedSecretA == NULL || is_CurveIsogenyStruct_null(CurveIsogeny)) {
+        return CRYPTO_ERROR_INVALID_PARAMETER;
+    }
+
+    to_fp2mont(((f2elm_t*)PublicKeyB)[0], A);         // Extracting and converting Bob's public curve parameters to Montgomery representation
+    to_fp2mont(((f2elm_t*)PublicKeyB)[1], PKB2);
+    to_fp2mont(((f2elm_t*)PublicKeyB)[2], PKB3);
+    to_fp2mont(((f2elm_t*)PublicKeyB)[3], PKB4);
+
+    if (kerngen == NULL) {
+        Status = ladder_3_pt(PKB2, PKB3, PKB4, (digit_t*)pPrivateKeyA, ALICE, R, A, CurveIsogeny);
+        if (Status != CRYPTO_SUCCESS) {
+            return Status;
+        }
+    } else {
+        fp2copy751(kerngen->X, R->X);
+        fp2copy751(kerngen->Z, R->Z);
+    }
+
+    return SecretAgreement_walk_A(R, A, pSharedSecretA, CurveIsogeny, batch, cancel);
+}
+
+
+CRYPTO_STATUS SecretAgreement_Prepared_A(unsigned char* pPrivateKeyA, const PreparedPublicKey* PreparedKeyB, unsigned char* pSharedSecretA, PCurveIsogenyStruct CurveIsogeny, batch_struct* batch, const int* cancel)
+{ // Alice's shared secret generation against a public key prepared with PublicKeyPreparation_B
+  // Same as SecretAgreement_A, without the conversion of the public key and with a cheaper 3-point ladder.
+    point_proj_t R;
+    f2elm_t A;
+
+    if (pPrivateKeyA == NULL || PreparedKeyB == NULL || pSharedSecretA == NULL || is_CurveIsogenyStruct_null(CurveIsogeny) || CurveIsogeny->oAbits != PREPARED_LADDER_BITS) {
+        return CRYPTO_ERROR_INVALID_PARAMETER;
+    }
+
+    fp2copy751(PreparedKeyB->A, A);
+    ladder_3_pt_prepared(PreparedKeyB->xP, PreparedKeyB->xPQ, PreparedKeyB->LadderQ, (digit_t*)pPrivateKeyA, CurveIsogeny->oAbits, R, CurveIsogeny);
+
+    return SecretAgreement_walk_A(R, A, pSharedSecretA, CurveIsogeny, batch, cancel);
+}
+
+
+CRYPTO_STATUS PublicKeyPreparation_B(const unsigned char* pPublicKeyB, PreparedPublicKey* PreparedKeyB, PCurveIsogenyStruct CurveIsogeny)
+{ // Converts Bob's public key for SecretAgreement_Prepared_A and precomputes the doublings of its point Q
+  // Inputs: Bob's pPublicKeyB consists of 4 elements in GF(p751^2).
+  // Output: PreparedKeyB, about 143KB.
+    const f2elm_t* PublicKeyB = (const f2elm_t*)pPublicKeyB;
+
+    if (pPublicKeyB == NULL || PreparedKeyB == NULL || is_CurveIsogenyStruct_null(CurveIsogeny) || CurveIsogeny->oAbits != PREPARED_LADDER_BITS) {
+        return CRYPTO_ERROR_INVALID_PARAMETER;
+    }
+
+    to_fp2mont(PublicKeyB[0], PreparedKeyB->A);
+    to_fp2mont(PublicKeyB[1], PreparedKeyB->xP);
+    to_fp2mont(PublicKeyB[2], PreparedKeyB->xQ);
+    to_fp2mont(PublicKeyB[3], PreparedKeyB->xPQ);
+    prepare_3_pt_ladder(PreparedKeyB->xQ, PreparedKeyB->A, PreparedKeyB->LadderQ, PREPARED_LADDER_BITS, CurveIsogeny);
+
+    return CRYPTO_SUCCESS;
+}
+
+
 CRYPTO_STATUS EphemeralSecretAgreement_B(const unsigned char* PrivateKeyB, const unsigned char* PublicKeyA, unsigned char* SharedSecretB, PCurveIsogenyStruct CurveIsogeny)
 { // Bob's ephemeral shared secret computation
   // It produces a shared secret key SharedSecretB using his secret key PrivateKeyB and Alice's public key PublicKeyA
@@ -662,7 +714,17 @@ CRYPTO_STATUS EphemeralSecretAgreement_B(const unsigned char* PrivateKeyB, const
     return Status;
 }
 
-CRYPTO_STATUS SecretAgreement_B(unsigned char* pPrivateKeyB, unsigned char* pPublicKeyA, unsigned char* pSharedSecretB, PCurveIsogenyStruct CurveIsogeny, point_proj_t kerngen, point_proj_t extractpoint, batch_struct* batch)
+static bool is_point_at_infinity(const point_proj_t P)
+{ // Returns true if the projective point P = (X:Z) has Z = 0, i.e., it is the point at infinity.
+  // Z is fully reduced first, the field arithmetic may leave it equal to p.
+    f2elm_t Z;
+
+    fp2copy751(P->Z, Z);
+    fp2correction751(Z);
+    return is_felm_zero(Z[0]) && is_felm_zero(Z[1]);
+}
+
+CRYPTO_STATUS SecretAgreement_B(unsigned char* pPrivateKeyB, unsigned char* pPublicKeyA, unsigned char* pSharedSecretB, PCurveIsogenyStruct CurveIsogeny, point_proj_t kerngen, point_proj_t extractpoint, batch_struct* batch, const int* cancel)
 { // Bob's shared secret generation
   // It produces a shared secret key pSharedSecretB using his secret key pPrivateKeyB and Alice's public key pPublicKeyA
   // Inputs: Bob's pPrivateKeyB is an integer in the range [1, oB-1], where oA = 3^239 (i.e., 379 bits in total).
@@ -711,6 +773,10 @@ CRYPTO_STATUS SecretAgreement_B(unsigned char* pPrivateKeyB, unsigned char* pPub
 
     index = 0;
     for (row = 1; row < MAX_Bob; row++) {
+        if (cancel != NULL && __atomic_load_n(cancel, __ATOMIC_RELAXED)) {
+            Status = CRYPTO_ERROR_CANCELLED;
+            goto cleanup;
+        }
         while (index < MAX_Bob-row) {
             fp2copy751(R->X, pts[npts]->X);
             fp2copy751(R->Z, pts[npts]->Z);
@@ -720,6 +786,11 @@ CRYPTO_STATUS SecretAgreement_B(unsigned char* pPrivateKeyB, unsigned char* pPub
             xTPLe(R, R, A, C, (int)m);
             index += m;
         }
+        if (is_point_at_infinity(R)) {
+            // every leaf of the strategy must have order 3, or the kernel generator has order less than 3^239
+            Status = CRYPTO_ERROR_INVALID_ORDER;
+            goto cleanup;
+        }
         get_3_isog(R, A, C);
 
         for (i = 0; i < npts; i++) {
@@ -732,6 +803,10 @@ CRYPTO_STATUS SecretAgreement_B(unsigned char* pPrivateKeyB, unsigned char* pPub
         npts -= 1;
     }
 
+    if (is_point_at_infinity(R)) {
+        Status = CRYPTO_ERROR_INVALID_ORDER;
+        goto cleanup;
+    }
     get_3_isog(R, A, C);
 
 		if (batch != NULL) {
@@ -742,7 +817,7 @@ CRYPTO_STATUS SecretAgreement_B(unsigned char* pPrivateKeyB, unsigned char* pPub
 
     from_fp2mont(jinv, (felm_t*)pSharedSecretB);      // Converting back to standard representation
 
-// Cleanup:
+cleanup:
     clear_words((void*)R, 2*2*pwords);
     clear_words((void*)pts, MAX_INT_POINTS_BOB*2*2*pwords);
     clear_words((void*)A, 2*pwords);
@@ -752,6 +827,158 @@ CRYPTO_STATUS SecretAgreement_B(unsigned char* pPrivateKeyB, unsigned char* pPub
     return Status;
 }
 
+#if defined(X64_IFMA_LANES)
+static void SecretAgreement_B_x8(unsigned char** pPrivateKeyB, unsigned char** pPublicKeyA, unsigned char** pSharedSecretB, const unsigned int n, PCurveIsogenyStruct CurveIsogeny, point_proj* kerngen, point_proj* extractpoint, CRYPTO_STATUS* status)
+{ // SecretAgreement_B for n <= NLANES inputs, the isogeny walks of which run in lockstep on the 8-lane arithmetic.
+  // Lanes beyond n repeat the first input.
+    unsigned int i, row, m, index = 0, pts_index[MAX_INT_POINTS_BOB], npts = 0, infinity = 0;
+    point_proj_x8_t R, pts[MAX_INT_POINTS_BOB];
+    f2elm_x8_t A, C;
+    f2elm_t lanesA[NLANES], lanesC[NLANES], lanesX[NLANES], lanesZ[NLANES], PKA2, PKA3, PKA4, jinv;
+    point_proj_t K;
+
+    for (i = 0; i < n; i++) {
+        publickey_t* PublicKeyA = (publickey_t*)pPublicKeyA[i];
+
+        to_fp2mont(((f2elm_t*)PublicKeyA)[0], lanesA[i]);    // Extracting and converting Alice's public curve parameters to Montgomery representation
+        fp2zero751(lanesC[i]);
+        fpcopy751(CurveIsogeny->C, lanesC[i][0]);
+        to_mont(lanesC[i][0], lanesC[i][0]);
+
+        status[i] = CRYPTO_SUCCESS;
+        if (kerngen == NULL) {
+            to_fp2mont(((f2elm_t*)PublicKeyA)[1], PKA2);
+            to_fp2mont(((f2elm_t*)PublicKeyA)[2], PKA3);
+            to_fp2mont(((f2elm_t*)PublicKeyA)[3], PKA4);
+            status[i] = ladder_3_pt(PKA2, PKA3, PKA4, (digit_t*)pPrivateKeyB[i], BOB, K, lanesA[i], CurveIsogeny);
+            if (extractpoint != NULL && status[i] == CRYPTO_SUCCESS) {
+                fp2copy751(K->X, extractpoint[i].X);
+                fp2copy751(K->Z, extractpoint[i].Z);
+            }
+        } else {
+            fp2copy751(kerngen[i].X, K->X);
+            fp2copy751(kerngen[i].Z, K->Z);
+        }
+        fp2copy751(K->X, lanesX[i]);
+        fp2copy751(K->Z, lanesZ[i]);
+    }
+    for (i = n; i < NLANES; i++) {
+        fp2copy751(lanesA[0], lanesA[i]);
+        fp2copy751(lanesC[0], lanesC[i]);
+        fp2copy751(lanesX[0], lanesX[i]);
+        fp2copy751(lanesZ[0], lanesZ[i]);
+    }
+    fp2pack751_x8(lanesA, A);
+    fp2pack751_x8(lanesC, C);
+    fp2pack751_x8(lanesX, R->X);
+    fp2pack751_x8(lanesZ, R->Z);
+
+    // Same strategy as SecretAgreement_B, the leaves of every lane are checked for order 3
+    for (row = 1; row < MAX_Bob; row++) {
+        while (index < MAX_Bob-row) {
+            copy_words((digit_t*)R, (digit_t*)pts[npts], sizeof(point_proj_x8)/sizeof(digit_t));
+            pts_index[npts] = index;
+            npts += 1;
+            m = splits_Bob[MAX_Bob-index-row];
+            xTPLe_x8(R, R, A, C, (int)m);
+            index += m;
+        }
+        infinity |= fp2iszero751_x8(R->Z);
+        get_3_isog_x8(R, A, C);
+
+        for (i = 0; i < npts; i++) {
+            eval_3_isog_x8(R, pts[i]);
+        }
+
+        copy_words((digit_t*)pts[npts-1], (digit_t*)R, sizeof(point_proj_x8)/sizeof(digit_t));
+        index = pts_index[npts-1];
+        npts -= 1;
+    }
+
+    infinity |= fp2iszero751_x8(R->Z);
+    get_3_isog_x8(R, A, C);
+    fp2unpack751_x8(A, lanesA);
+    fp2unpack751_x8(C, lanesC);
+
+    for (i = 0; i < n; i++) {
+        if (status[i] == CRYPTO_SUCCESS && (infinity & (1 << i))) {
+            status[i] = CRYPTO_ERROR_INVALID_ORDER;
+        }
+        if (status[i] == CRYPTO_SUCCESS) {
+            j_inv(lanesA[i], lanesC[i], jinv);
+            from_fp2mont(jinv, (felm_t*)pSharedSecretB[i]);    // Converting back to standard representation
+        }
+    }
+
+    clear_words((void*)R, sizeof(point_proj_x8)/sizeof(digit_t));
+    clear_words((void*)pts, MAX_INT_POINTS_BOB*sizeof(point_proj_x8)/sizeof(digit_t));
+    clear_words((void*)A, sizeof(f2elm_x8_t)/sizeof(digit_t));
+    clear_words((void*)C, sizeof(f2elm_x8_t)/sizeof(digit_t));
+    clear_words((void*)lanesA, NLANES*2*NWORDS_FIELD);
+    clear_words((void*)lanesC, NLANES*2*NWORDS_FIELD);
+    clear_words((void*)lanesX, NLANES*2*NWORDS_FIELD);
+    clear_words((void*)lanesZ, NLANES*2*NWORDS_FIELD);
+    clear_words((void*)K, 2*2*NWORDS_FIELD);
+    clear_words((void*)jinv, 2*NWORDS_FIELD);
+}
+#endif
+
+
+unsigned int SecretAgreement_B_lanes_width(void)
+{ // Number of inputs SecretAgreement_B_lanes runs in lockstep
+#if defined(X64_IFMA_LANES)
+    static int supported = -1;
+
+    if (supported < 0) {
+        supported = fp_x8_supported();
+    }
+    return supported ? NLANES : 1;
+#else
+    return 1;
+#endif
+}
+
+
+CRYPTO_STATUS SecretAgreement_B_lanes(unsigned char** pPrivateKeyB, unsigned char** pPublicKeyA, unsigned char** pSharedSecretB, const unsigned int n, PCurveIsogenyStruct CurveIsogeny, point_proj* kerngen, point_proj* extractpoint, CRYPTO_STATUS* status)
+{ // Bob's shared secret generation for n independent inputs
+  // Same as n calls to SecretAgreement_B without batch or cancel: input i is pPrivateKeyB[i] (unused if kerngen is given),
+  // pPublicKeyA[i] and, if kerngen is not NULL, kerngen[i]; extractpoint[i] receives its kernel generator if extractpoint is not NULL.
+  // status[i] receives the result of input i, the return value is the first failure or CRYPTO_SUCCESS.
+  // Up to SecretAgreement_B_lanes_width() inputs at a time have their isogeny walks computed in lockstep.
+    unsigned int i, width = SecretAgreement_B_lanes_width(), group;
+    CRYPTO_STATUS Status = CRYPTO_SUCCESS;
+
+    if ((kerngen == NULL && pPrivateKeyB == NULL) || pPublicKeyA == NULL || pSharedSecretB == NULL || status == NULL || is_CurveIsogenyStruct_null(CurveIsogeny)) {
+        return CRYPTO_ERROR_INVALID_PARAMETER;
+    }
+    for (i = 0; i < n; i++) {
+        if ((kerngen == NULL && pPrivateKeyB[i] == NULL) || pPublicKeyA[i] == NULL || pSharedSecretB[i] == NULL) {
+            return CRYPTO_ERROR_INVALID_PARAMETER;
+        }
+    }
+
+    for (i = 0; i < n; i += group) {
+        group = (n - i < width) ? n - i : width;
+#if defined(X64_IFMA_LANES)
+        if (group > 1) {
+            SecretAgreement_B_x8((kerngen == NULL) ? &pPrivateKeyB[i] : NULL, &pPublicKeyA[i], &pSharedSecretB[i], group, CurveIsogeny,
+                                 (kerngen == NULL) ? NULL : &kerngen[i], (extractpoint == NULL) ? NULL : &extractpoint[i], &status[i]);
+            continue;
+        }
+#endif
+        status[i] = SecretAgreement_B((kerngen == NULL) ? pPrivateKeyB[i] : NULL, pPublicKeyA[i], pSharedSecretB[i], CurveIsogeny,
+                                      (kerngen == NULL) ? NULL : &kerngen[i], (extractpoint == NULL) ? NULL : &extractpoint[i], NULL, NULL);
+    }
+
+    for (i = 0; i < n; i++) {
+        if (status[i] != CRYPTO_SUCCESS) {
+            Status = status[i];
+            break;
+        }
+    }
+    return Status;
+}
+
 ///////////////////////////////////////////////////////////////////////////////////
 ///////////////          KEY EXCHANGE USING DECOMPRESSION           ///////////////
 
@@ -1249,16 +1476,35 @@ static void print_whole_decomp_tests (f2elm_t A, point_t psiS, point_t R1, point
 ///////////////////////////////////////////////////////////////////////////////////
 ///////////////             COMPRESSION FOR SIGNATURES              ///////////////
 
-CRYPTO_STATUS compressPsiS(const point_proj* psiS, unsigned char* CompressedPsiS, int* compBit, const f2elm_t A, PCurveIsogenyStruct CurveIsogeny, batch_struct* batch) {
+CRYPTO_STATUS compressPsiS(const point_proj* psiS, unsigned char* CompressedPsiS, int* compBit, unsigned char* basisHint, const f2elm_t A, PCurveIsogenyStruct CurveIsogeny, batch_struct* batch) {
 // Inputs:  psiS - a point in projective coordinates - computed by SecretAgreementB
 //          A - f2elm in montgomery form - the A value for the signers curve
 //          CurveIsogeny - SIDHp751
 // Outputs: CompressedPsiS - f2elm in subgroub E[3^239] - ainv*b or binv*a
 //          compBit - a bit signifying if ainv*b (0) or binv*a (1) was computed
+//          basisHint - the search counters of the basis {R1, R2}, lets decompressPsiS skip the search (0 if they do not fit)
 
-	CRYPTO_STATUS Status = CRYPTO_SUCCESS;
 	point_full_proj_t P, Q;
-	point_proj_t Pnot, Qnot, psiSTriple;
+	f2elm_t A_temp;
+	unsigned int hint[2];
+
+	// generate projective basis {P, Q} generating E[3^239] which gives affine basis {R1, R2} //
+	fp2copy751(A, A_temp);
+	generate_3_torsion_basis_hint(A_temp, P, Q, hint, CurveIsogeny);
+	*basisHint = pack_basis_hint(hint);
+
+	return compressPsiS_basis(psiS, CompressedPsiS, compBit, A, P, Q, CurveIsogeny, batch);
+}
+
+CRYPTO_STATUS compressPsiS_basis(const point_proj* psiS, unsigned char* CompressedPsiS, int* compBit, const f2elm_t A, const point_full_proj* P, const point_full_proj* Q, PCurveIsogenyStruct CurveIsogeny, batch_struct* batch) {
+// Inputs:  psiS - a point in projective coordinates - computed by SecretAgreementB
+//          A - f2elm in montgomery form - the A value for the signers curve
+//          P, Q - the basis of E[3^239] generate_3_torsion_basis_hint or generate_3_torsion_basis_batch found for A
+//          CurveIsogeny - SIDHp751
+// Outputs: CompressedPsiS - f2elm in subgroub E[3^239] - ainv*b or binv*a
+//          compBit - a bit signifying if ainv*b (0) or binv*a (1) was computed
+
+	CRYPTO_STATUS Status = CRYPTO_SUCCESS;
 	point_t psiSa, notPsiSa, R1, R2;
 	point_t R1not, R2not;
 	digit_t *comp = CompressedPsiS;
@@ -1270,54 +1516,12 @@ CRYPTO_STATUS compressPsiS(const point_proj* psiS, unsigned char* CompressedPsiS
 	uint64_t Montgomery_rprime[NWORDS64_ORDER] = {0x48062A91D3AB563D, 0x6CE572751303C2F5, 0x5D1319F3F160EC9D, 0xE35554E8C2D5623A, 0xCA29300232BC79A5, 0x8AAD843D646D78C5}; // Value -(3^239)^-1 mod 2^384
 	unsigned int bita, bitb;
 	f2elm_t tmp, tmp2, t, inf, one = {0};
-	int error;
 	fpcopy751(CurveIsogeny->Montgomery_one, one[0]);
 	fp2copy751(A, A_temp);
 
-	// check that psi(S) has full order -----------------------------------//
-	copy_words((digit_t*)psiS, (digit_t*)psiSTriple, 2*2*NWORDS_FIELD);
-	for (int i=0; i < 238; i++) {
-		xTPL(psiSTriple, psiSTriple, A_temp, CurveIsogeny->C);
-
-		if (is_felm_zero(((felm_t*)psiSTriple->Z)[0]) && is_felm_zero(((felm_t*)psiSTriple->Z)[1])) {
-      #ifdef TEST_RUN_PRINTS
-        printf ("Error: order of psi(S) falls short of 3^239\n");
-      #endif
-			return CRYPTO_ERROR_INVALID_ORDER;
-		}
-	}
-	//---------------------------------------------------------------------//
-
-	// generate projective basis {P, Q} generating E[3^239] which gives affine basis {R1, R2} //
-	generate_3_torsion_basis(A_temp, P, Q, CurveIsogeny);
-
-	// check that P and Q have full order ----------------------------------------------//
-	fp2copy751(P->X, Pnot->X);
-	fp2copy751(P->Z, Pnot->Z);
-	fp2copy751(Q->X, Qnot->X);
-	fp2copy751(Q->Z, Qnot->Z);
-	for (int i=0; i < 238; i++) {
-		xTPL(Pnot, Pnot, A, CurveIsogeny->C);
-		xTPL(Qnot, Qnot, A, CurveIsogeny->C);
-
-		if (is_felm_zero(((felm_t*)Pnot->Z)[0]) && is_felm_zero(((felm_t*)Pnot->Z)[1])) {
-      #ifdef TEST_RUN_PRINTS
-        printf ("Error: order of P falls short of 3^239\n");
-      #endif
-			error++;
-		}
-		if (is_felm_zero(((felm_t*)Qnot->Z)[0]) && is_felm_zero(((felm_t*)Qnot->Z)[1])) {
-      #ifdef TEST_RUN_PRINTS
-        printf ("Error: order of Q falls short of 3^239\n");
-      #endif
-			error++;
-		}
-		if (error) {
-			return CRYPTO_ERROR_INVALID_ORDER;
-		}
-	}
-	//----------------------------------------------------------------------------------//
+	// psi(S) is the kernel generator SecretAgreement_B has just walked, which already checked it has full order
 
+	// P and Q have full order by construction
 	// convert P, Q, and psiS to affine coordinates -//
 	fp2copy751(P->Z, vec[0]);
 	fp2copy751(Q->Z, vec[1]);
@@ -1566,10 +1770,11 @@ CRYPTO_STATUS compressPsiS_test(const point_proj* psiS, unsigned char* Compresse
 	return Status;
 }
 
-CRYPTO_STATUS decompressPsiS(const unsigned char* CompressedPsiS, point_proj* S, int compBit, const f2elm_t A, PCurveIsogenyStruct CurveIsogeny, batch_struct* batch) {
+CRYPTO_STATUS decompressPsiS(const unsigned char* CompressedPsiS, point_proj* S, int compBit, unsigned char basisHint, const f2elm_t A, PCurveIsogenyStruct CurveIsogeny, batch_struct* batch) {
 // Inputs:  CompressedPsiS: x s.t. psi(S) = R1 + [x]R2 or psi(S) = [x]R1 + R2
 //          CurveIsogeny - SIDHp751
 //          compBit - a bit signifying if ainv*b (0) or binv*a (1) was computed
+//          basisHint - the hint compressPsiS gave, {R1, R2} is searched for if it is 0 or out of range
 // Outputs: point S generating the same kernel as the original psi(S)
 //
   CRYPTO_STATUS Status = CRYPTO_SUCCESS;
@@ -1577,7 +1782,6 @@ CRYPTO_STATUS decompressPsiS(const unsigned char* CompressedPsiS, point_proj* S,
   point_full_proj_t P, Q;                    //points used in the construction of {R1,R2}
   point_full_proj_t S_temp;
   point_proj_t temp1;
-  point_proj_t Pnot, Qnot;
   point_t R1, R2;
   digit_t* comp = (digit_t*)CompressedPsiS;
   f2elm_t vec[2], Zinv[2];
@@ -1588,41 +1792,20 @@ CRYPTO_STATUS decompressPsiS(const unsigned char* CompressedPsiS, point_proj* S,
   unsigned int bit;
   f2elm_t tmp, one = {0};
   f2elm_t A_temp, A24;
-  int error = 0;
+  unsigned int hint[2];
 
   fp2copy751(A, A_temp);
   fpcopy751(CurveIsogeny->Montgomery_one, one[0]);
   //to_fp2mont((felm_t*)comp, comp);
 
   // generate projective basis {P, Q} generating E[3^239] which gives affine basis {R1, R2} //
-  generate_3_torsion_basis(A_temp, P, Q, CurveIsogeny);
-
-  // check that P and Q have full order ----------------------------------------------//
-  fp2copy751(P->X, Pnot->X);
-  fp2copy751(P->Z, Pnot->Z);
-  fp2copy751(Q->X, Qnot->X);
-  fp2copy751(Q->Z, Qnot->Z);
-  for (int i=0; i < 238; i++) {
-    xTPL(Pnot, Pnot, A_temp, CurveIsogeny->C);
-    xTPL(Qnot, Qnot, A_temp, CurveIsogeny->C);
-
-    if (is_felm_zero(((felm_t*)Pnot->Z)[0]) && is_felm_zero(((felm_t*)Pnot->Z)[1])) {
-      #ifdef TEST_RUN_PRINTS
-      printf ("Error: order of P falls short of 3^239\n");
-      #endif
-      error++;
-    }
-    if (is_felm_zero(((felm_t*)Qnot->Z)[0]) && is_felm_zero(((felm_t*)Qnot->Z)[1])) {
-      #ifdef TEST_RUN_PRINTS
-      printf ("Error: order of Q falls short of 3^239\n");
-      #endif
-      error++;
-    }
-    if (error) {
-      return CRYPTO_ERROR_INVALID_ORDER;
-    }
+  // a wrong hint gives a wrong psi(S), which the order check in SecretAgreement_B or the commitment comparison rejects
+  unpack_basis_hint(basisHint, hint);
+  if (hint[0] != 0 && hint[1] != 0) {
+    generate_3_torsion_basis_from_hint(A_temp, P, Q, hint, CurveIsogeny);
+  } else {
+    generate_3_torsion_basis(A_temp, P, Q, CurveIsogeny);
   }
-  //----------------------------------------------------------------------------------//
 
   fp2copy751(P->Z, vec[0]);
   fp2copy751(Q->Z, vec[1]);
@@ -11,12 +11,15 @@
 
 #include "../SIDH.h"
 #include "../SIDH_internal.h"
+#include "../thread_pool.h"
 #include "test_extras.h"
 #include <malloc.h>
 #include <stdio.h>
 
 extern const unsigned int splits_Alice[MAX_Alice];
 extern const unsigned int splits_Bob[MAX_Bob];
+extern const uint64_t p751[NWORDS_FIELD];
+extern const uint64_t p751x2[NWORDS_FIELD];
 
 
 // Benchmark and test parameters  
@@ -44,6 +47,7 @@ bool fp_test()
     bool OK = true;
     int n, passed;
     felm_t a, b, c, d, e, f, ma, mb, mc, md, me, mf;
+    dfelm_t aa, bb;
 
     printf("\n--------------------------------------------------------------------------------------------------------\n\n"); 
     printf("Testing field arithmetic over GF(p751): \n\n"); 
@@ -170,6 +174,35 @@ bool fp_test()
     else { printf("  GF(p) multiplication tests... FAILED"); printf("\n"); return false; }
     printf("\n");
 
+#if defined(X64_ASM_KERNELS)
+    // MULX/ADX multiplication and reduction kernels against the MUL/ADC kernels
+    if (select_fp_kernels()) {
+        dfelm_t cc, dd;                                        // The reductions write a double-length buffer
+
+        passed = 1;
+        for (n=0; n<TEST_LOOPS; n++)
+        {
+            fprandom751_test(a); fprandom751_test(b);
+            if (n == 0) {
+                fpcopy751((digit_t*)p751x2, a);
+                a[0] -= 1;                                     // a = b = 2*p751-1, the largest inputs in Montgomery arithmetic
+                fpcopy751(a, b);
+            }
+
+            mul751_asm(a, b, aa);
+            mul751_mulx_asm(a, b, bb);
+            if (fpcompare751(aa,bb)!=0 || fpcompare751(aa+NWORDS_FIELD,bb+NWORDS_FIELD)!=0) { passed=0; break; }
+
+            rdc751_asm(aa, cc);
+            rdc751_mulx_asm(aa, dd);
+            if (fpcompare751(cc,dd)!=0) { passed=0; break; }
+        }
+        if (passed==1) printf("  MULX/ADX kernel tests ........................................... PASSED");
+        else { printf("  MULX/ADX kernel tests... FAILED"); printf("\n"); return false; }
+        printf("\n");
+    }
+#endif
+
     // Field squaring over the prime p751
     passed = 1;
     for (n=0; n<TEST_LOOPS; n++)
@@ -181,6 +214,16 @@ bool fp_test()
         fpmul751_mont(ma, ma, mc);                             // c = a*a 
         if (fpcompare751(mb,mc)!=0) { passed=0; break; }
 
+        mp_sqr(ma, aa, NWORDS_FIELD);                          // aa = a^2 as integers
+        mp_mul(ma, ma, bb, NWORDS_FIELD);                      // bb = a*a as integers
+        if (fpcompare751(aa,bb)!=0 || fpcompare751(aa+NWORDS_FIELD,bb+NWORDS_FIELD)!=0) { passed=0; break; }
+
+        fpcopy751((digit_t*)p751x2, a);
+        a[0] -= 1;                                             // a = 2*p751-1, the largest input in Montgomery arithmetic
+        mp_sqr(a, aa, NWORDS_FIELD);
+        mp_mul(a, a, bb, NWORDS_FIELD);
+        if (fpcompare751(aa,bb)!=0 || fpcompare751(aa+NWORDS_FIELD,bb+NWORDS_FIELD)!=0) { passed=0; break; }
+
         fpzero751(a); to_mont(a, ma);
         fpsqr751_mont(ma, md);                                 // d = 0^2 
         if (fpcompare751(ma,md)!=0) { passed=0; break; }
@@ -204,10 +247,28 @@ bool fp_test()
 		fprandom751_test(a);
 		to_mont(a, ma);
 		fpcopy751(ma, mb);
-		fpinv751_mont(ma);                                     // a = a^-1 by exponentiation
+		fpinv751_mont(ma);                                     // a = a^-1 by divsteps
 		fpinv751_mont_bingcd(mb);                              // b = a^-1 by binary GCD
 		if (fpcompare751(ma, mb) != 0) { passed = 0; break; }
     }
+    for (n=0; passed==1 && n<TEST_LOOPS+4; n++)
+    {
+        if (n == 0) { fpzero751(a); a[0]=1; }                  // 1, p-1, 0 and p (an unreduced 0) first
+        else if (n == 1) { fpcopy751((digit_t*)p751, a); a[0]--; }
+        else if (n == 2) fpzero751(a);
+        else if (n == 3) fpcopy751((digit_t*)p751, a);
+        else fprandom751_test(a);
+        fpcopy751(a, ma);
+        fpcopy751(a, mb);
+        fpinv751_mont_safegcd(ma);                             // a = a^-1 by divsteps
+        fpcopy751(mb, mc);                                     // b = a^-1 by exponentiation, (b^((p-3)/4))^4*b
+        fpinv751_chain_mont(mc);
+        fpsqr751_mont(mc, mc);
+        fpsqr751_mont(mc, mc);
+        fpmul751_mont(mb, mc, mb);
+        fpcorrection751(mb);
+        if (fpcompare751(ma, mb) != 0) { passed = 0; break; }
+    }
     if (passed==1) printf("  GF(p) inversion tests............................................ PASSED");
     else { printf("  GF(p) inversion tests... FAILED"); printf("\n"); return false; }
     printf("\n");
@@ -350,6 +411,94 @@ bool fp2_test()
     if (passed==1) printf("  GF(p^2) squaring tests........................................... PASSED");
     else { printf("  GF(p^2) squaring tests... FAILED"); printf("\n"); return false; }
     printf("\n");
+
+#if defined(X64_ASM_KERNELS)
+    // Fused GF(p751^2) kernels against the schoolbook formulas over GF(p751)
+    passed = 1;
+    for (n=0; n<TEST_LOOPS; n++)
+    {
+        fp2random751_test(ma); fp2random751_test(mb);
+        if (n == 0) {
+            fpcopy751((digit_t*)p751x2, ma[0]);
+            ma[0][0] -= 1;                                      // a0 = a1 = b0 = b1 = 2*p751-1
+            fpcopy751(ma[0], ma[1]); fp2copy751(ma, mb);
+        }
+
+        fpmul751_mont(ma[0], mb[0], e[0]); fpmul751_mont(ma[1], mb[1], e[1]);
+        fpsub751(e[0], e[1], mc[0]);                            // c = a*b = (a0*b0 - a1*b1) + (a0*b1 + a1*b0)*i
+        fpmul751_mont(ma[0], mb[1], e[0]); fpmul751_mont(ma[1], mb[0], e[1]);
+        fpadd751(e[0], e[1], mc[1]);
+        fp2correction751(mc);
+
+        fp2mul751_asm(ma, mb, md); fp2correction751(md);
+        if (fp2compare751(mc,md)!=0) { passed=0; break; }
+        if (select_fp_kernels()) {
+            fp2mul751_mulx_asm(ma, mb, me); fp2correction751(me);
+            if (fp2compare751(mc,me)!=0) { passed=0; break; }
+        }
+
+        fpmul751_mont(ma[0], ma[0], e[0]); fpmul751_mont(ma[1], ma[1], e[1]);
+        fpsub751(e[0], e[1], mc[0]);                            // c = a^2 = (a0^2 - a1^2) + 2*a0*a1*i
+        fpmul751_mont(ma[0], ma[1], e[0]);
+        fpadd751(e[0], e[0], mc[1]);
+        fp2correction751(mc);
+
+        fp2sqr751_asm(ma, md); fp2correction751(md);
+        if (fp2compare751(mc,md)!=0) { passed=0; break; }
+        if (select_fp_kernels()) {
+            fp2sqr751_mulx_asm(ma, me); fp2correction751(me);
+            if (fp2compare751(mc,me)!=0) { passed=0; break; }
+        }
+    }
+    if (passed==1) printf("  GF(p^2) fused kernel tests ...................................... PASSED");
+    else { printf("  GF(p^2) fused kernel tests... FAILED"); printf("\n"); return false; }
+    printf("\n");
+#endif
+
+#if defined(X64_IFMA_LANES)
+    // 8-lane GF(p751^2) arithmetic against the scalar functions, lane by lane
+    if (fp_x8_supported()) {
+        f2elm_t la[NLANES], lb[NLANES], lc[NLANES];
+        f2elm_x8_t xa, xb, xc;
+        int i;
+
+        passed = 1;
+        for (n=0; n<TEST_LOOPS/NLANES && passed; n++)
+        {
+            for (i=0; i<NLANES; i++) { fp2random751_test(la[i]); fp2random751_test(lb[i]); }
+            if (n == 0) {
+                fpcopy751((digit_t*)p751x2, la[0][0]);
+                la[0][0][0] -= 1;                               // Lane 0: a0 = a1 = b0 = b1 = 2*p751-1
+                fpcopy751(la[0][0], la[0][1]); fp2copy751(la[0], lb[0]);
+            }
+            fp2pack751_x8((const f2elm_t*)la, xa); fp2pack751_x8((const f2elm_t*)lb, xb);
+
+            fp2mul751_mont_x8(xa, xb, xc); fp2unpack751_x8(xc, lc);
+            for (i=0; i<NLANES; i++) {
+                fp2mul751_mont(la[i], lb[i], mc); fp2correction751(mc); fp2correction751(lc[i]);
+                if (fp2compare751(mc,lc[i])!=0) { passed=0; break; }
+            }
+            fp2sqr751_mont_x8(xa, xc); fp2unpack751_x8(xc, lc);
+            for (i=0; i<NLANES; i++) {
+                fp2sqr751_mont(la[i], mc); fp2correction751(mc); fp2correction751(lc[i]);
+                if (fp2compare751(mc,lc[i])!=0) { passed=0; break; }
+            }
+            fp2add751_x8(xa, xb, xc); fp2unpack751_x8(xc, lc);
+            for (i=0; i<NLANES; i++) {
+                fp2add751(la[i], lb[i], mc); fp2correction751(mc); fp2correction751(lc[i]);
+                if (fp2compare751(mc,lc[i])!=0) { passed=0; break; }
+            }
+            fp2sub751_x8(xa, xb, xc); fp2unpack751_x8(xc, lc);
+            for (i=0; i<NLANES; i++) {
+                fp2sub751(la[i], lb[i], mc); fp2correction751(mc); fp2correction751(lc[i]);
+                if (fp2compare751(mc,lc[i])!=0) { passed=0; break; }
+            }
+        }
+        if (passed==1) printf("  GF(p^2) 8-lane tests ............................................ PASSED");
+        else { printf("  GF(p^2) 8-lane tests... FAILED"); printf("\n"); return false; }
+        printf("\n");
+    }
+#endif
     
     // Inversion over GF(p751^2)
     passed = 1;
@@ -375,6 +524,39 @@ bool fp2_test()
     }
     if (passed==1) printf("  GF(p^2) inversion tests.......................................... PASSED");
     else { printf("  GF(p^2) inversion tests... FAILED"); printf("\n"); return false; }
+    printf("\n");
+
+    // Batched inversion over GF(p751^2) of a large batch, shared out over a worker pool, then again in place
+    passed = 1;
+    {
+        const int nbig = 2000;
+        f2elm_t *big = (f2elm_t*)malloc(nbig*sizeof(f2elm_t)), *big_inv = (f2elm_t*)malloc(nbig*sizeof(f2elm_t));
+        worker_pool *pool = pool_create(3);
+
+        if (big == NULL || big_inv == NULL || pool == NULL) passed = 0;
+        for (n=0; passed==1 && n<nbig; n++) {
+            fp2random751_test(a);
+            if (n % 97 == 0) fp2zero751(a);                    // zeros stay zero
+            to_fp2mont(a, big[n]);
+        }
+        if (passed==1 && batched_inv_pool((const f2elm_t*)big, big_inv, nbig, pool, 3) != CRYPTO_SUCCESS) passed = 0;
+        for (n=0; passed==1 && n<nbig; n++) {
+            fp2copy751(big[n], mb);
+            if (n % 97 != 0) fp2inv751_mont(mb);
+            fp2correction751(mb); fp2correction751(big_inv[n]);
+            if (fp2compare751(mb, big_inv[n]) != 0) passed = 0;
+        }
+        if (passed==1) partial_batched_inv((const f2elm_t*)big, big, nbig);
+        for (n=0; passed==1 && n<nbig; n++) {
+            fp2correction751(big[n]);
+            if (fp2compare751(big[n], big_inv[n]) != 0) passed = 0;
+        }
+        if (pool != NULL) pool_free(pool);
+        free(big);
+        free(big_inv);
+    }
+    if (passed==1) printf("  GF(p^2) pooled batched inversion tests........................... PASSED");
+    else { printf("  GF(p^2) pooled batched inversion tests... FAILED"); printf("\n"); return false; }
     printf("\n");
     
 		//SECTION FOR TESTING N WAY BATCHED INVERSION ALGO//////////
@@ -385,7 +567,7 @@ bool fp2_test()
 		int q;
 		for (q = 0; q < 100; q++) {
 			fp2random751_test(batch[q]);
-			fpcopy751(batch[q], test_inv[q]);
+			fp2copy751(batch[q], test_inv[q]);
 		}	
 		
 		//make empty buffer for inverted elements
@@ -393,18 +575,18 @@ bool fp2_test()
 
 		//do batched inversion and regular inversions
 		for (q = 0; q < 100; q++) {
-			to_mont(batch[q], mbatch[q]);
+			to_fp2mont(batch[q], mbatch[q]);
 		}
 		partial_batched_inv(mbatch, mbatch_inv, 100);
 		for (q = 0; q < 100; q++) {
-			from_mont(mbatch_inv[q], batch_inv[q]);
+			from_fp2mont(mbatch_inv[q], batch_inv[q]);
 		}
 
 		for (q = 0; q < 100; q++) {
 			f2elm_t mtmp;
-			to_mont(test_inv[q], mtmp);
+			to_fp2mont(test_inv[q], mtmp);
 			fp2inv751_mont(mtmp);
-			from_mont(mtmp, test_inv[q]);
+			from_fp2mont(mtmp, test_inv[q]);
 		}
 
 		//test that the batched inversion matches individual inversions 
@@ -434,6 +616,9 @@ bool fp_run()
         
     printf("\n--------------------------------------------------------------------------------------------------------\n\n"); 
     printf("Benchmarking field arithmetic over GF(p751): \n\n"); 
+#if defined(X64_ASM_KERNELS)
+    printf("  Multiplication and reduction kernels: %s \n\n", select_fp_kernels() ? "MULX/ADCX/ADOX" : "MUL/ADC"); 
+#endif
         
     fprandom751_test(a); fprandom751_test(b); fprandom751_test(c);
 
@@ -473,6 +658,42 @@ bool fp_run()
     printf("  GF(p) multiplication runs in .................................... %7lld ", cycles/BENCH_LOOPS); print_unit;
     printf("\n");
 
+    // GF(p) squaring using p751
+    cycles = 0;
+    for (n=0; n<BENCH_LOOPS; n++)
+    {
+        cycles1 = cpucycles(); 
+        fpsqr751_mont(a, c);
+        cycles2 = cpucycles();
+        cycles = cycles+(cycles2-cycles1);
+    }
+    printf("  GF(p) squaring runs in .......................................... %7lld ", cycles/BENCH_LOOPS); print_unit;
+    printf("\n");
+
+    // 751-bit integer multiplication
+    cycles = 0;
+    for (n=0; n<BENCH_LOOPS; n++)
+    {
+        cycles1 = cpucycles(); 
+        mp_mul(a, b, aa, NWORDS_FIELD);
+        cycles2 = cpucycles();
+        cycles = cycles+(cycles2-cycles1);
+    }
+    printf("  Integer multiplication runs in .................................. %7lld ", cycles/BENCH_LOOPS); print_unit;
+    printf("\n");
+
+    // 751-bit integer squaring
+    cycles = 0;
+    for (n=0; n<BENCH_LOOPS; n++)
+    {
+        cycles1 = cpucycles(); 
+        mp_sqr(a, aa, NWORDS_FIELD);
+        cycles2 = cpucycles();
+        cycles = cycles+(cycles2-cycles1);
+    }
+    printf("  Integer squaring runs in ........................................ %7lld ", cycles/BENCH_LOOPS); print_unit;
+    printf("\n");
+
     // GF(p) reduction using p751
     cycles = 0;
     for (n=0; n<BENCH_LOOPS; n++)
@@ -496,6 +717,18 @@ bool fp_run()
         cycles2 = cpucycles();
         cycles = cycles+(cycles2-cycles1);
     }
+    printf("  GF(p) inversion (divsteps) runs in .............................. %7lld ", cycles/SMALL_BENCH_LOOPS); print_unit;
+    printf("\n");
+
+    // GF(p) inversion, exponentiation
+    cycles = 0;
+    for (n=0; n<SMALL_BENCH_LOOPS; n++)
+    {
+        cycles1 = cpucycles(); 
+        fpinv751_chain_mont(a);
+        cycles2 = cpucycles();
+        cycles = cycles+(cycles2-cycles1);
+    }
     printf("  GF(p) inversion (exponentiation) runs in ........................ %7lld ", cycles/SMALL_BENCH_LOOPS); print_unit;
     printf("\n");
 
@@ -584,7 +817,7 @@ bool fp2_run()
         cycles2 = cpucycles();
         cycles = cycles+(cycles2-cycles1);
     }
-    printf("  GF(p^2) inversion (exponentiation) runs in ...................... %7lld ", cycles/SMALL_BENCH_LOOPS); print_unit;
+    printf("  GF(p^2) inversion (divsteps) runs in ............................ %7lld ", cycles/SMALL_BENCH_LOOPS); print_unit;
     printf("\n");
 
 	// GF(p^2) inversion with binary GCD (NOT constant time!!!)
@@ -631,6 +864,31 @@ bool fp2_run()
 	printf("  100 GF(p^2) batched partial inversions runs in .................. %7lld ", cycles); print_unit;
 	printf("\n");
 
+	// GF(p^2) batched inversion of a large batch, by the caller and over a pool
+	{
+		const int nbig = 4000;
+		f2elm_t *big = (f2elm_t*)malloc(nbig*sizeof(f2elm_t));
+		worker_pool *pool = pool_create(0);
+
+		if (big != NULL && pool != NULL) {
+			for (q = 0; q < nbig; q++) {
+				fp2random751_test(big[q]);
+			}
+			cycles1 = cpucycles();
+			batched_inv_pool((const f2elm_t*)big, big, nbig, NULL, 0);
+			cycles2 = cpucycles();
+			printf("  4000 GF(p^2) batched inversions runs in ......................... %7lld ", cycles2-cycles1); print_unit;
+			printf("\n");
+			cycles1 = cpucycles();
+			batched_inv_pool((const f2elm_t*)big, big, nbig, pool, pool->nworkers);
+			cycles2 = cpucycles();
+			printf("  4000 GF(p^2) batched inversions over %2d workers runs in ......... %7lld ", pool->nworkers, cycles2-cycles1); print_unit;
+			printf("\n");
+		}
+		if (pool != NULL) pool_free(pool);
+		free(big);
+	}
+
 	return OK;
 }
 
@@ -763,6 +1021,58 @@ cleanup:
 }
 
 
+static void secret_pt_ladder(const point_basefield_t P, const digit_t* m, const unsigned int nbits, point_proj_t R, PCurveIsogenyStruct CurveIsogeny)
+{ // Reference for secret_pt(): x(P+[m]Q) for Q = (-x,y*i) from the x-only Montgomery ladder in the base field and a recovery of the y-coordinate
+    point_basefield_t Q;
+    point_basefield_proj_t S, T;
+    digit_t *X0 = (digit_t*)S->X, *Z0 = (digit_t*)S->Z, *X1 = (digit_t*)T->X, *Z1 = (digit_t*)T->Z;
+    digit_t *x = (digit_t*)P->x, *y = (digit_t*)P->y, *x1 = (digit_t*)Q->x, *y1 = (digit_t*)Q->y;
+    digit_t scalar[NWORDS_ORDER];
+    felm_t t0, t1, t2, A24 = {0};
+    digit_t *RX0 = (digit_t*)R->X[0], *RX1 = (digit_t*)R->X[1], *RZ0 = (digit_t*)R->Z[0], *RZ1 = (digit_t*)R->Z[1];
+
+    fpcopy751(P->x, Q->x);
+    fpcopy751(P->y, Q->y);
+    fpneg751(Q->x);
+
+    A24[0] = 1;
+    copy_words(m, scalar, NWORDS_ORDER);
+    ladder(Q->x, scalar, S, T, A24, nbits, CurveIsogeny->owordbits, CurveIsogeny);
+
+    fpmul751_mont(x1, Z0, RX1);
+    fpmul751_mont(X0, x1, RX0);
+    fpsub751(X0, RX1, t0);
+    fpadd751(X0, RX1, RX1);
+    fpsqr751_mont(t0, t0);
+    fpadd751(RX0, Z0, RX0);
+    fpmul751_mont(t0, X1, t0);
+    fpmul751_mont(RX0, RX1, RX0);
+    fpmul751_mont(y1, Z1, t2);
+    fpmul751_mont(y, Z0, t1);
+    fpadd751(t2, t2, t2);
+    fpmul751_mont(t2, Z0, RX1);
+    fpmul751_mont(RX0, Z1, RX0);
+    fpsub751(RX0, t0, RX0);
+    fpmul751_mont(t1, RX1, t1);
+    fpsqr751_mont(RX1, t0);
+    fpmul751_mont(t2, RX1, t2);
+    fpmul751_mont(t1, RX0, RX1);
+    fpadd751(t1, RX0, RZ0);
+    fpadd751(RX1, RX1, RX1);
+    fpsub751(t1, RX0, t1);
+    fpmul751_mont(x, Z0, RX0);
+    fpmul751_mont(t1, RZ0, t1);
+    fpsub751(X0, RX0, RZ0);
+    fpadd751(X0, RX0, RX0);
+    fpsqr751_mont(RZ0, RZ0);
+    fpmul751_mont(t2, RX0, t2);
+    fpmul751_mont(t2, RZ0, t2);
+    fpmul751_mont(RZ0, t0, RZ0);
+    fpsub751(t1, t2, RX0);
+    fpzero751(RZ1);
+}
+
+
 bool ecpoints_test(PCurveIsogenyStaticData CurveIsogenyData)
 {
 	bool OK = true;
@@ -770,10 +1080,17 @@ bool ecpoints_test(PCurveIsogenyStaticData CurveIsogenyData)
 	unsigned int pbytes = (CurveIsogenyData->pwordbits + 7)/8;      // Number of bytes in a field element 
 	unsigned int obytes = (CurveIsogenyData->owordbits + 7)/8;      // Number of bytes in an element in [1, order]
 	unsigned char *PrivateKeyA, *PublicKeyA, *PrivateKeyB, *PublicKeyB;
+	unsigned int j, party;
+	digit_t m[NWORDS_ORDER], one_word[NWORDS_ORDER] = {1};
+	point_basefield_t P;
 	f2elm_t t0, t1;
 	f2elm_t A, C, zero, one, PK0, PK1, PK2;
 	point_full_proj_t R1, R2;
 	point_proj_t P1, P2, P3, P4;
+	f2elm_t As[BASIS_BATCH+2];
+	point_full_proj B1[BASIS_BATCH+2], B2[BASIS_BATCH+2];
+	unsigned int hints[BASIS_BATCH+2][2], hint[2];
+	bool cube[BASIS_BATCH+2];
 	PCurveIsogenyStruct CurveIsogeny = {0};
 	CRYPTO_STATUS Status = CRYPTO_SUCCESS;
 	bool passed;
@@ -893,6 +1210,92 @@ bool ecpoints_test(PCurveIsogenyStaticData CurveIsogenyData)
 	else { printf("  Computing 3-torsion basis tests... FAILED"); printf("\n"); return false; }
 	printf("\n");
 
+	// Generating 3-torsion bases for more curves than one batch holds, compared with the search on each curve
+	passed = 1;
+	for (i = 0; i < BASIS_BATCH+2; i++)
+	{
+		Status = EphemeralKeyGeneration_B(PrivateKeyB, PublicKeyB, CurveIsogeny);
+		if (Status != CRYPTO_SUCCESS) {
+			OK = false;
+			goto cleanup;
+		}
+		to_fp2mont(((f2elm_t*)PublicKeyB)[0], PK0);
+		to_fp2mont(((f2elm_t*)PublicKeyB)[1], PK1);
+		to_fp2mont(((f2elm_t*)PublicKeyB)[2], PK2);
+		get_A(PK0, PK1, PK2, As[i], CurveIsogeny);
+	}
+	generate_3_torsion_basis_batch(As, B1, B2, hints, BASIS_BATCH+2, CurveIsogeny);
+	for (i = 0; i < BASIS_BATCH+2; i++)
+	{
+		generate_3_torsion_basis_hint(As[i], R1, R2, hint, CurveIsogeny);
+		if (hint[0] != hints[i][0] || hint[1] != hints[i][1]) { passed = 0; break; }
+		fp2mul751_mont(R1->X, B1[i].Z, t0);
+		fp2mul751_mont(B1[i].X, R1->Z, t1);
+		fp2correction751(t0);
+		fp2correction751(t1);
+		if (fp2compare751(t0, t1) != 0) { passed = 0; break; }
+		fp2mul751_mont(R2->X, B2[i].Z, t0);
+		fp2mul751_mont(B2[i].X, R2->Z, t1);
+		fp2correction751(t0);
+		fp2correction751(t1);
+		if (fp2compare751(t0, t1) != 0) { passed = 0; break; }
+	}
+	// Batched cube test, with a zero and a cube among the inputs
+	fp2zero751(As[1]);
+	fp2sqr751_mont(As[2], t0);
+	fp2mul751_mont(As[2], t0, As[2]);
+	is_cube_Fp2_batch(As, cube, BASIS_BATCH+2, CurveIsogeny);
+	for (i = 0; i < BASIS_BATCH+2; i++)
+	{
+		if (cube[i] != is_cube_Fp2(As[i], CurveIsogeny)) { passed = 0; break; }
+	}
+	if (cube[1] == true || cube[2] == false) passed = 0;
+	if (passed == 1) printf("  Computing batched 3-torsion basis tests................................ PASSED");
+	else { printf("  Computing batched 3-torsion basis tests... FAILED"); printf("\n"); return false; }
+	printf("\n");
+
+	// Fixed-base secret points against the ladder, for random scalars of both parties and for 0, 1, 2^372-1 and order-1
+	// (for m = 0 both end on Z = 0, so only the projective (X:Z) is compared)
+	passed = 1;
+	for (party = ALICE; party <= BOB && passed; party++)
+	{
+		unsigned int nbits = (party == ALICE) ? CurveIsogeny->oAbits : CurveIsogeny->oBbits;
+
+		to_mont((digit_t*)((party == ALICE) ? CurveIsogeny->PA : CurveIsogeny->PB), (digit_t*)P);
+		to_mont(((digit_t*)((party == ALICE) ? CurveIsogeny->PA : CurveIsogeny->PB)) + NWORDS_FIELD, ((digit_t*)P) + NWORDS_FIELD);
+		for (i = 0; i < ECPT_TEST_LOOPS+4; i++)
+		{
+			clear_words((void*)m, NWORDS_ORDER);
+			if (i == 1) {
+				m[0] = 1;
+			} else if (i == 2) {
+				for (j = 0; j < 372; j++) m[j/RADIX] |= (digit_t)1 << (j%RADIX);
+			} else if (i == 3) {
+				copy_words((party == ALICE) ? CurveIsogeny->Aorder : CurveIsogeny->Border, m, NWORDS_ORDER);
+				mp_sub(m, one_word, m, NWORDS_ORDER);
+			} else if (i > 3) {
+				Status = random_mod_order(m, party, CurveIsogeny);
+				if (Status != CRYPTO_SUCCESS) {
+					OK = false;
+					goto cleanup;
+				}
+			}
+			secret_pt(P, m, party, P1, CurveIsogeny);
+			secret_pt_ladder(P, m, nbits, P2, CurveIsogeny);
+			fp2mul751_mont(P1->X, P2->Z, t0);
+			fp2mul751_mont(P2->X, P1->Z, t1);
+			fp2correction751(t0);
+			fp2correction751(t1);
+			if (fp2compare751(t0, t1) != 0) { printf("m%d\n", i); passed = 0; break; }
+			fp2correction751(P1->X);
+			fp2correction751(P1->Z);
+			if (fp2compare751(P1->X, zero) == 0 && fp2compare751(P1->Z, zero) == 0) { printf("Z%d\n", i); passed = 0; break; }
+		}
+	}
+	if (passed == 1) printf("  Fixed-base secret point tests.......................................... PASSED");
+	else { printf("  Fixed-base secret point tests... FAILED"); printf("\n"); return false; }
+	printf("\n");
+
 cleanup:
 	SIDH_curve_free(CurveIsogeny);    
     free(PrivateKeyA);    
@@ -2051,15 +2454,15 @@ int main()
 {
     bool OK = true;
 
-    //OK = OK && fp_test();        // Test field operations using p751
+    OK = OK && fp_test();        // Test field operations using p751
     OK = OK && fp_run();         // Benchmark field operations using p751
 
-    //OK = OK && fp2_test();       // Test arithmetic functions over GF(p751^2)
+    OK = OK && fp2_test();       // Test arithmetic functions over GF(p751^2)
     OK = OK && fp2_run();        // Benchmark arithmetic functions over GF(p751^2)
     
     //OK = OK && ecisog_run(&CurveIsogeny_SIDHp751);       // Benchmark elliptic curve and isogeny functions
 
-    //OK = OK && ecpoints_test(&CurveIsogeny_SIDHp751);    // Test point generation functions
+    OK = OK && ecpoints_test(&CurveIsogeny_SIDHp751);      // Test point generation functions
     //OK = OK && ecpairing_test(&CurveIsogeny_SIDHp751);   // Test pairing functions
     //OK = OK && ecph_test(&CurveIsogeny_SIDHp751);        // Test Pohlig-Hellman functions    
     //OK = OK && eccompress_test(&CurveIsogeny_SIDHp751);  // Test Pohlig-Hellman functions
@@ -14,6 +14,8 @@
 #include "test_extras.h"
 #include <stdlib.h>
 #include <stdio.h>
+#include <time.h>
+#include <unistd.h>
 
 
 CRYPTO_STATUS cryptotest_signature() {
@@ -28,7 +30,7 @@ CRYPTO_STATUS cryptotest_signature() {
 	PrivateKey = (unsigned char*)calloc(1, obytes);        // One element in [1, order]
 	PublicKey = (unsigned char*)calloc(1, 4*2*pbytes);     // Four elements in GF(p^2)
 
-	struct Signature sig;
+	struct Signature sig = {0};
 
 	PCurveIsogenyStruct CurveIsogeny = {0};
 
@@ -79,6 +81,7 @@ CRYPTO_STATUS cryptotest_signature() {
 	}
 
 cleanup:
+		signature_free(&sig);
 		SIDH_curve_free(CurveIsogeny);
 		free(PrivateKey);
 		free(PublicKey);
@@ -99,7 +102,7 @@ CRYPTO_STATUS cryptotest_signature_batchedinv() {
 	PrivateKey = (unsigned char*)calloc(1, obytes);        // One element in [1, order]
 	PublicKey = (unsigned char*)calloc(1, 4*2*pbytes);     // Four elements in GF(p^2)
 
-	struct Signature sig;
+	struct Signature sig = {0};
 
 	PCurveIsogenyStruct CurveIsogeny = {0};
 
@@ -150,6 +153,7 @@ CRYPTO_STATUS cryptotest_signature_batchedinv() {
 	}
 
 cleanup:
+		signature_free(&sig);
 		SIDH_curve_free(CurveIsogeny);
 		free(PrivateKey);
 		free(PublicKey);
@@ -170,7 +174,7 @@ CRYPTO_STATUS cryptotest_signature_compressed() {
 	PrivateKey = (unsigned char*)calloc(1, obytes);        // One element in [1, order]
 	PublicKey = (unsigned char*)calloc(1, 4*2*pbytes);     // Four elements in GF(p^2)
 
-	struct Signature sig;
+	struct Signature sig = {0};
 
 	PCurveIsogenyStruct CurveIsogeny = {0};
 
@@ -221,6 +225,7 @@ CRYPTO_STATUS cryptotest_signature_compressed() {
 	}
 
 cleanup:
+		signature_free(&sig);
 		SIDH_curve_free(CurveIsogeny);
 		free(PrivateKey);
 		free(PublicKey);
@@ -240,7 +245,7 @@ CRYPTO_STATUS cryptotest_signature_CB() {
 	PrivateKey = (unsigned char*)calloc(1, obytes);        // One element in [1, order]
 	PublicKey = (unsigned char*)calloc(1, 4*2*pbytes);     // Four elements in GF(p^2)
 
-	struct Signature sig;
+	struct Signature sig = {0};
 
 	PCurveIsogenyStruct CurveIsogeny = {0};
 
@@ -291,6 +296,7 @@ CRYPTO_STATUS cryptotest_signature_CB() {
 	}
 
 cleanup:
+		signature_free(&sig);
 		SIDH_curve_free(CurveIsogeny);
 		free(PrivateKey);
 		free(PublicKey);
@@ -299,6 +305,422 @@ cleanup:
 }
 
 
+static double elapsed_seconds(const struct timespec *from, const struct timespec *to) {
+	return (double)(to->tv_sec - from->tv_sec) + (double)(to->tv_nsec - from->tv_nsec) / 1e9;
+}
+
+
+// Corrupts the opened response of one round and checks that verification rejects the signature,
+// reporting how long the rejection takes next to a full verification
+CRYPTO_STATUS cryptotest_signature_early_abort(int compressed) {
+	CRYPTO_STATUS Status = CRYPTO_SUCCESS;
+	// Number of bytes in a field element
+	unsigned int pbytes = (CurveIsogeny_SIDHp751.pwordbits + 7)/8;
+	// Number of bytes in an element in [1, order]
+	unsigned int n, obytes = (CurveIsogeny_SIDHp751.owordbits + 7)/8;
+	struct timespec t0, t1, t2;
+	int r;
+
+	// Allocate space for keys
+	unsigned char *PrivateKey, *PublicKey;
+	PrivateKey = (unsigned char*)calloc(1, obytes);        // One element in [1, order]
+	PublicKey = (unsigned char*)calloc(1, 4*2*pbytes);     // Four elements in GF(p^2)
+
+	struct Signature sig = {0};
+
+	PCurveIsogenyStruct CurveIsogeny = {0};
+	SignatureContext *ctx = NULL;
+
+	CurveIsogeny = SIDH_curve_allocate(&CurveIsogeny_SIDHp751);
+	if (CurveIsogeny == NULL) {
+		Status = CRYPTO_ERROR_NO_MEMORY;
+		goto cleanup;
+	}
+
+	Status = SIDH_curve_initialize(CurveIsogeny, &random_bytes_test, &CurveIsogeny_SIDHp751);
+	if (Status != CRYPTO_SUCCESS) {
+		goto cleanup;
+	}
+
+	// one worker per core: the rounds still waiting when the corrupted one fails are never started
+	ctx = signature_context_allocate(CurveIsogeny, 0);
+	if (ctx == NULL) {
+		Status = CRYPTO_ERROR_NO_MEMORY;
+		goto cleanup;
+	}
+
+	Status = isogeny_keygen(CurveIsogeny, PrivateKey, PublicKey);
+	if (Status != CRYPTO_SUCCESS) {
+		goto cleanup;
+	}
+
+	Status = isogeny_sign_ctx(ctx, PrivateKey, PublicKey, &sig, 0, compressed);
+	if (Status != CRYPTO_SUCCESS) {
+		goto cleanup;
+	}
+
+	clock_gettime(CLOCK_MONOTONIC, &t0);
+	Status = isogeny_verify_ctx(ctx, PublicKey, &sig, 0, compressed);
+	clock_gettime(CLOCK_MONOTONIC, &t1);
+	if (Status != CRYPTO_SUCCESS) {
+		goto cleanup;
+	}
+
+	// corrupt the first round opening the random point and the first opening psi(S), whichever kind the verifier
+	// starts with; the response hashes are left alone so the challenge still matches
+	for (r = 0; r < NUM_ROUNDS && (sig.cHash[r/8] & (1 << (r%8))); r++);
+	sig.Randoms[r][1] ^= 1;
+	for (r = 0; r < NUM_ROUNDS && !(sig.cHash[r/8] & (1 << (r%8))); r++);
+	if (compressed) {
+		sig.compPsiS[r][0] ^= 2;
+	} else {
+		// [3]psi(S) only has order 3^238, which the isogeny walk of the verifier has to catch
+		f2elm_t C = {0};
+		fpcopy751(CurveIsogeny->C, C[0]);
+		to_mont(C[0], C[0]);
+		xTPLe(sig.psiS[r], sig.psiS[r], *(f2elm_t*)sig.Commitments1[r], C, 1);
+	}
+
+	Status = isogeny_verify_ctx(ctx, PublicKey, &sig, 0, compressed);
+	clock_gettime(CLOCK_MONOTONIC, &t2);
+	if (Status == CRYPTO_SUCCESS) {
+		Status = CRYPTO_ERROR;
+		goto cleanup;
+	}
+	Status = CRYPTO_SUCCESS;
+
+	printf("  EARLY ABORT%s: valid signature verified in %.2f ms, corrupted signature rejected in %.2f ms\n",
+	       compressed ? " (compressed)" : "", 1000 * elapsed_seconds(&t0, &t1), 1000 * elapsed_seconds(&t1, &t2));
+
+cleanup:
+	signature_free(&sig);
+	signature_context_free(ctx);
+	SIDH_curve_free(CurveIsogeny);
+	free(PrivateKey);
+	free(PublicKey);
+
+	return Status;
+}
+
+
+static int random_calls;
+
+// random_bytes_test, except that every seventh request fails
+static CRYPTO_STATUS random_bytes_flaky(unsigned int nbytes, unsigned char* random_array) {
+	if (__atomic_add_fetch(&random_calls, 1, __ATOMIC_RELAXED) % 7 == 0) {
+		return CRYPTO_ERROR_UNKNOWN;
+	}
+	return random_bytes_test(nbytes, random_array);
+}
+
+static CRYPTO_STATUS random_bytes_failing(unsigned int nbytes, unsigned char* random_array) {
+	return CRYPTO_ERROR_UNKNOWN;
+}
+
+// Signs with a random source that fails now and then, so that rounds are redone, and with one that always fails,
+// so that signing gives up with the status of the failed rounds
+CRYPTO_STATUS cryptotest_signature_retries(void) {
+	CRYPTO_STATUS Status = CRYPTO_SUCCESS;
+	// Number of bytes in a field element
+	unsigned int pbytes = (CurveIsogeny_SIDHp751.pwordbits + 7)/8;
+	// Number of bytes in an element in [1, order]
+	unsigned int obytes = (CurveIsogeny_SIDHp751.owordbits + 7)/8;
+	int retries;
+
+	// Allocate space for keys
+	unsigned char *PrivateKey, *PublicKey;
+	PrivateKey = (unsigned char*)calloc(1, obytes);        // One element in [1, order]
+	PublicKey = (unsigned char*)calloc(1, 4*2*pbytes);     // Four elements in GF(p^2)
+
+	struct Signature sig = {0};
+
+	PCurveIsogenyStruct CurveIsogeny = {0};
+	SignatureContext *ctx = NULL;
+
+	CurveIsogeny = SIDH_curve_allocate(&CurveIsogeny_SIDHp751);
+	if (CurveIsogeny == NULL) {
+		Status = CRYPTO_ERROR_NO_MEMORY;
+		goto cleanup;
+	}
+
+	Status = SIDH_curve_initialize(CurveIsogeny, &random_bytes_test, &CurveIsogeny_SIDHp751);
+	if (Status != CRYPTO_SUCCESS) {
+		goto cleanup;
+	}
+
+	ctx = signature_context_allocate(CurveIsogeny, 0);
+	if (ctx == NULL) {
+		Status = CRYPTO_ERROR_NO_MEMORY;
+		goto cleanup;
+	}
+
+	Status = isogeny_keygen(CurveIsogeny, PrivateKey, PublicKey);
+	if (Status != CRYPTO_SUCCESS) {
+		goto cleanup;
+	}
+
+	CurveIsogeny->RandomBytesFunction = &random_bytes_flaky;
+	Status = isogeny_sign_ctx(ctx, PrivateKey, PublicKey, &sig, 0, 0);
+	retries = ctx->stats.retries;
+	if (Status != CRYPTO_SUCCESS) {
+		goto cleanup;
+	}
+	Status = isogeny_verify_ctx(ctx, PublicKey, &sig, 0, 0);
+	if (Status != CRYPTO_SUCCESS) {
+		goto cleanup;
+	}
+	if (retries == 0) {
+		Status = CRYPTO_ERROR;
+		goto cleanup;
+	}
+
+	// sig still holds the signature above: signing into it again has to release it, and failing leaves nothing behind
+	CurveIsogeny->RandomBytesFunction = &random_bytes_failing;
+	Status = isogeny_sign_ctx(ctx, PrivateKey, PublicKey, &sig, 0, 0);
+	if (Status != CRYPTO_ERROR_UNKNOWN || sig.arena != NULL) {
+		Status = CRYPTO_ERROR;
+		goto cleanup;
+	}
+	Status = CRYPTO_SUCCESS;
+
+	printf("  SIGNING RETRIES: %d rounds redone, a failing random source reported as %s\n", retries, SIDH_get_error_message(CRYPTO_ERROR_UNKNOWN));
+
+cleanup:
+	signature_free(&sig);
+	signature_context_free(ctx);
+	SIDH_curve_free(CurveIsogeny);
+	free(PrivateKey);
+	free(PublicKey);
+
+	return Status;
+}
+
+
+// Signs, serializes and verifies the serialized form, then checks that a corrupted commitment is rejected
+CRYPTO_STATUS cryptotest_signature_wire(int compressed) {
+	CRYPTO_STATUS Status = CRYPTO_SUCCESS;
+	// Number of bytes in a field element
+	unsigned int pbytes = (CurveIsogeny_SIDHp751.pwordbits + 7)/8;
+	// Number of bytes in an element in [1, order]
+	unsigned int n, obytes = (CurveIsogeny_SIDHp751.owordbits + 7)/8;
+	size_t length, full;
+
+	// Allocate space for keys
+	unsigned char *PrivateKey, *PublicKey, *sigBytes = NULL;
+	PrivateKey = (unsigned char*)calloc(1, obytes);        // One element in [1, order]
+	PublicKey = (unsigned char*)calloc(1, 4*2*pbytes);     // Four elements in GF(p^2)
+
+	struct Signature sig = {0};
+
+	PCurveIsogenyStruct CurveIsogeny = {0};
+
+	#ifdef TEST_RUN_PRINTS
+	printf("\n  TESTING SERIALIZED SIGNATURES%s \n", compressed ? " WITH COMPRESSION" : "");
+	printf("  ---------------------------------------------------------\n");
+	#endif
+
+	CurveIsogeny = SIDH_curve_allocate(&CurveIsogeny_SIDHp751);
+	if (CurveIsogeny == NULL) {
+		Status = CRYPTO_ERROR_NO_MEMORY;
+		goto cleanup;
+	}
+
+	Status = SIDH_curve_initialize(CurveIsogeny, &random_bytes_test, &CurveIsogeny_SIDHp751);
+	if (Status != CRYPTO_SUCCESS) {
+		goto cleanup;
+	}
+
+	Status = isogeny_keygen(CurveIsogeny, PrivateKey, PublicKey);
+	if (Status != CRYPTO_SUCCESS) {
+		goto cleanup;
+	}
+
+	Status = isogeny_sign(CurveIsogeny, PrivateKey, PublicKey, &sig, 0, compressed);
+	if (Status != CRYPTO_SUCCESS) {
+		goto cleanup;
+	}
+
+	length = signature_wire_length(CurveIsogeny, &sig);
+	sigBytes = (unsigned char*)malloc(length);
+	if (sigBytes == NULL) {
+		Status = CRYPTO_ERROR_NO_MEMORY;
+		goto cleanup;
+	}
+	Status = signature_serialize(CurveIsogeny, &sig, sigBytes, length);
+	if (Status != CRYPTO_SUCCESS) {
+		goto cleanup;
+	}
+
+	// everything struct Signature carries: both commitments, both responses and both response hashes for every round
+	full = NUM_ROUNDS * (2*2*pbytes + obytes + (compressed ? sizeof(digit_t)*NWORDS_ORDER + 2 : sizeof(point_proj)) + 2*32);
+	printf("  SERIALIZED SIZE %s %zu bytes (%zu with both responses)\n", compressed ? "(compressed) ......" : "..................", length, full);
+
+	Status = isogeny_verify_bytes(CurveIsogeny, PublicKey, sigBytes, length, 0);
+	if (Status != CRYPTO_SUCCESS) {
+		goto cleanup;
+	}
+	#ifdef TEST_RUN_PRINTS
+	printf("  SERIALIZED SIGNATURE VERIFY .............. SUCCESSFUL\n");
+	#endif
+
+	if (compressed) {
+		// the compBit and basis hint bytes of an opened psi(S) are hashed with it: flipping either breaks the challenge,
+		// and a compBit above 1 or a hint the verifier cannot unpack is malformed
+		unsigned char *resp = sigBytes + 1 + NUM_ROUNDS/8 + NUM_ROUNDS*2*2*pbytes;
+		size_t rlength = sizeof(digit_t)*NWORDS_ORDER + 2;
+		unsigned char bit, hint;
+
+		for (n=0; n<NUM_ROUNDS && ((sig.cHash[n/8] >> (n%8)) & 1) == 0; n++) {
+			resp += obytes + HASH_LENGTH;
+		}
+		bit = resp[rlength - 2];
+		hint = resp[rlength - 1];
+		resp[rlength - 2] = bit ^ 0x01;
+		Status = isogeny_verify_bytes(CurveIsogeny, PublicKey, sigBytes, length, 0);
+		resp[rlength - 2] = 2;
+		if (n == NUM_ROUNDS || Status == CRYPTO_SUCCESS ||
+		    isogeny_verify_bytes(CurveIsogeny, PublicKey, sigBytes, length, 0) != CRYPTO_ERROR_INVALID_PARAMETER) {
+			Status = CRYPTO_ERROR;
+			goto cleanup;
+		}
+		resp[rlength - 2] = bit;
+		resp[rlength - 1] = hint ^ 0x01;
+		Status = isogeny_verify_bytes(CurveIsogeny, PublicKey, sigBytes, length, 0);
+		resp[rlength - 1] = 0xFF;
+		if (Status == CRYPTO_SUCCESS ||
+		    isogeny_verify_bytes(CurveIsogeny, PublicKey, sigBytes, length, 0) != CRYPTO_ERROR_INVALID_PARAMETER) {
+			Status = CRYPTO_ERROR;
+			goto cleanup;
+		}
+		resp[rlength - 1] = hint;
+		Status = CRYPTO_SUCCESS;
+		#ifdef TEST_RUN_PRINTS
+		printf("  TAMPERED COMPBIT AND HINT REJECTED ....... SUCCESSFUL\n");
+		#endif
+	}
+
+	// a signature with a modified commitment no longer matches its challenge, and a truncated one is malformed
+	sigBytes[1 + NUM_ROUNDS/8] ^= 0x01;
+	if (isogeny_verify_bytes(CurveIsogeny, PublicKey, sigBytes, length, 0) == CRYPTO_SUCCESS ||
+	    isogeny_verify_bytes(CurveIsogeny, PublicKey, sigBytes, length - 1, 0) != CRYPTO_ERROR_INVALID_PARAMETER) {
+		Status = CRYPTO_ERROR;
+		goto cleanup;
+	}
+	#ifdef TEST_RUN_PRINTS
+	printf("  TAMPERED SIGNATURE REJECTED .............. SUCCESSFUL\n");
+	#endif
+
+cleanup:
+	signature_free(&sig);
+	free(sigBytes);
+	SIDH_curve_free(CurveIsogeny);
+	free(PrivateKey);
+	free(PublicKey);
+
+	return Status;
+}
+
+typedef struct {
+	SignatureContext *ctx;
+	unsigned char *PrivateKey;
+	unsigned char *PublicKey;
+	CRYPTO_STATUS Status;
+} concurrent_signer;
+
+static void *concurrent_sign_verify(void *arg) {
+	concurrent_signer *signer = (concurrent_signer*)arg;
+	struct Signature sig = {0};
+
+	signer->Status = isogeny_sign_ctx(signer->ctx, signer->PrivateKey, signer->PublicKey, &sig, 0, 0);
+	if (signer->Status == CRYPTO_SUCCESS) {
+		signer->Status = isogeny_verify_ctx(signer->ctx, signer->PublicKey, &sig, 0, 0);
+	}
+	signature_free(&sig);
+
+	return NULL;
+}
+
+// Runs nsigners independent sign/verify operations at the same time, each on its own context
+CRYPTO_STATUS cryptotest_signature_concurrent(int nsigners) {
+	CRYPTO_STATUS Status = CRYPTO_SUCCESS;
+	// Number of bytes in a field element
+	unsigned int pbytes = (CurveIsogeny_SIDHp751.pwordbits + 7)/8;
+	// Number of bytes in an element in [1, order]
+	unsigned int n, obytes = (CurveIsogeny_SIDHp751.owordbits + 7)/8;
+	int workers = pool_default_size() / nsigners;
+	int i;
+
+	// Allocate space for keys
+	unsigned char *PrivateKey, *PublicKey;
+	PrivateKey = (unsigned char*)calloc(1, obytes);        // One element in [1, order]
+	PublicKey = (unsigned char*)calloc(1, 4*2*pbytes);     // Four elements in GF(p^2)
+
+	concurrent_signer *signers = (concurrent_signer*)calloc(nsigners, sizeof(concurrent_signer));
+	pthread_t *threads = (pthread_t*)calloc(nsigners, sizeof(pthread_t));
+
+	PCurveIsogenyStruct CurveIsogeny = {0};
+
+	#ifdef TEST_RUN_PRINTS
+	printf("\n  TESTING CONCURRENT SIGNATURE CONTEXTS \n");
+	printf("  ---------------------------------------------------------\n");
+	#endif
+
+	CurveIsogeny = SIDH_curve_allocate(&CurveIsogeny_SIDHp751);
+	if (CurveIsogeny == NULL) {
+		Status = CRYPTO_ERROR_NO_MEMORY;
+		goto cleanup;
+	}
+
+	Status = SIDH_curve_initialize(CurveIsogeny, &random_bytes_test, &CurveIsogeny_SIDHp751);
+	if (Status != CRYPTO_SUCCESS) {
+		goto cleanup;
+	}
+
+	Status = isogeny_keygen(CurveIsogeny, PrivateKey, PublicKey);
+	if (Status != CRYPTO_SUCCESS) {
+		goto cleanup;
+	}
+
+	for (i = 0; i < nsigners; i++) {
+		signers[i].ctx = signature_context_allocate(CurveIsogeny, (workers > 0) ? workers : 1);
+		if (signers[i].ctx == NULL) {
+			Status = CRYPTO_ERROR_NO_MEMORY;
+			goto cleanup;
+		}
+		signers[i].PrivateKey = PrivateKey;
+		signers[i].PublicKey = PublicKey;
+	}
+
+	for (i = 0; i < nsigners; i++) {
+		pthread_create(&threads[i], NULL, concurrent_sign_verify, &signers[i]);
+	}
+	for (i = 0; i < nsigners; i++) {
+		pthread_join(threads[i], NULL);
+		if (signers[i].Status != CRYPTO_SUCCESS) {
+			Status = signers[i].Status;
+		}
+	}
+
+	#ifdef TEST_RUN_PRINTS
+	if (Status == CRYPTO_SUCCESS) {
+		printf("  %d CONCURRENT SIGN/VERIFY ...... SUCCESSFUL\n", nsigners);
+	}
+	#endif
+
+cleanup:
+	for (i = 0; i < nsigners; i++) {
+		signature_context_free(signers[i].ctx);
+	}
+	free(signers);
+	free(threads);
+	SIDH_curve_free(CurveIsogeny);
+	free(PrivateKey);
+	free(PublicKey);
+
+	return Status;
+}
+
+
 CRYPTO_STATUS cryptorun_signature () {
 	CRYPTO_STATUS Status = CRYPTO_SUCCESS;
 	// Number of bytes in a field element
@@ -312,7 +734,7 @@ CRYPTO_STATUS cryptorun_signature () {
 	PrivateKey = (unsigned char*)calloc(1, obytes);        // One element in [1, order]
 	PublicKey = (unsigned char*)calloc(1, 4*2*pbytes);     // Four elements in GF(p^2)
 
-	struct Signature sig;
+	struct Signature sig = {0};
 
 	PCurveIsogenyStruct CurveIsogeny = {0};
 
@@ -362,6 +784,7 @@ CRYPTO_STATUS cryptorun_signature () {
   printf("%lld\n", scycles);
 
 cleanup:
+	signature_free(&sig);
 	SIDH_curve_free(CurveIsogeny);
 	free(PrivateKey);
 	free(PublicKey);
@@ -384,7 +807,7 @@ CRYPTO_STATUS cryptorun_signature_batchedinv () {
 	PrivateKey = (unsigned char*)calloc(1, obytes);        // One element in [1, order]
 	PublicKey = (unsigned char*)calloc(1, 4*2*pbytes);     // Four elements in GF(p^2)
 
-	struct Signature sig;
+	struct Signature sig = {0};
 
 	PCurveIsogenyStruct CurveIsogeny = {0};
 
@@ -434,6 +857,7 @@ CRYPTO_STATUS cryptorun_signature_batchedinv () {
   printf("%lld\n", scycles);
 
 cleanup:
+	signature_free(&sig);
 	SIDH_curve_free(CurveIsogeny);
 	free(PrivateKey);
 	free(PublicKey);
@@ -455,7 +879,7 @@ CRYPTO_STATUS cryptorun_signature_compressed () {
 	PrivateKey = (unsigned char*)calloc(1, obytes);        // One element in [1, order]
 	PublicKey = (unsigned char*)calloc(1, 4*2*pbytes);     // Four elements in GF(p^2)
 
-	struct Signature sig;
+	struct Signature sig = {0};
 
 	PCurveIsogenyStruct CurveIsogeny = {0};
 
@@ -505,6 +929,7 @@ CRYPTO_STATUS cryptorun_signature_compressed () {
   printf("%lld\n", scycles);
 
 cleanup:
+	signature_free(&sig);
 	SIDH_curve_free(CurveIsogeny);
 	free(PrivateKey);
 	free(PublicKey);
@@ -525,7 +950,7 @@ CRYPTO_STATUS cryptorun_signature_CB () {
 	PrivateKey = (unsigned char*)calloc(1, obytes);        // One element in [1, order]
 	PublicKey = (unsigned char*)calloc(1, 4*2*pbytes);     // Four elements in GF(p^2)
 
-	struct Signature sig;
+	struct Signature sig = {0};
 
 	PCurveIsogenyStruct CurveIsogeny = {0};
 
@@ -575,6 +1000,7 @@ CRYPTO_STATUS cryptorun_signature_CB () {
   printf("%lld\n", scycles);
 
 cleanup:
+	signature_free(&sig);
 	SIDH_curve_free(CurveIsogeny);
 	free(PrivateKey);
 	free(PublicKey);
@@ -583,14 +1009,779 @@ cleanup:
 }
 
 
-int main (int argc, char** argv) {
-	srand(2);
+// Offers nsigs sign+verify operations at the given rate (signatures/sec) and reports latency.
+// If ctx is NULL every call spawns its own NUM_THREADS threads, otherwise the rounds run on ctx's pool.
+static CRYPTO_STATUS run_paced_signatures(PCurveIsogenyStruct CurveIsogeny, SignatureContext *ctx, unsigned char *PrivateKey, unsigned char *PublicKey, int rate, int nsigs) {
 	CRYPTO_STATUS Status = CRYPTO_SUCCESS;
+	struct timespec t0, t1, t2, now;
+	double sign_total = 0, verify_total = 0, wall;
+	struct Signature sig = {0};
+	int i;
+
+	clock_gettime(CLOCK_MONOTONIC, &t0);
+	for (i = 0; i < nsigs; i++) {
+		// wait for the next release time of the offered load
+		double release = (double)i / rate;
+		clock_gettime(CLOCK_MONOTONIC, &now);
+		double ahead = release - elapsed_seconds(&t0, &now);
+		if (ahead > 0) {
+			struct timespec pause = {(time_t)ahead, (long)((ahead - (time_t)ahead) * 1e9)};
+			nanosleep(&pause, NULL);
+		}
+
+		clock_gettime(CLOCK_MONOTONIC, &t1);
+		if (ctx == NULL) {
+			Status = isogeny_sign(CurveIsogeny, PrivateKey, PublicKey, &sig, 0, 0);
+		} else {
+			Status = isogeny_sign_ctx(ctx, PrivateKey, PublicKey, &sig, 0, 0);
+		}
+		clock_gettime(CLOCK_MONOTONIC, &t2);
+		sign_total += elapsed_seconds(&t1, &t2);
+		if (Status != CRYPTO_SUCCESS) {
+			return Status;
+		}
+
+		clock_gettime(CLOCK_MONOTONIC, &t1);
+		if (ctx == NULL) {
+			Status = isogeny_verify(CurveIsogeny, PublicKey, &sig, 0, 0);
+		} else {
+			Status = isogeny_verify_ctx(ctx, PublicKey, &sig, 0, 0);
+		}
+		clock_gettime(CLOCK_MONOTONIC, &t2);
+		verify_total += elapsed_seconds(&t1, &t2);
+		signature_free(&sig);
+		if (Status != CRYPTO_SUCCESS) {
+			return Status;
+		}
+	}
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	wall = elapsed_seconds(&t0, &now);
 
-  int vanilla_rounds = atoi(argv[1]);
-  int batched_rounds = atoi(argv[2]);
-  int compressed_rounds = atoi(argv[3]);
-  int CB_rounds = atoi(argv[4]);
+	printf("  %-9s %3d sig/s offered: %7.2f sig/s achieved, sign %9.2f ms, verify %9.2f ms\n",
+	       (ctx == NULL) ? "per-call" : "pooled", rate, nsigs / wall, 1000 * sign_total / nsigs, 1000 * verify_total / nsigs);
+
+	return Status;
+}
+
+
+// Signs and verifies once on ctx with the given chunk size and reports how busy the round dispenser was
+static CRYPTO_STATUS run_chunk_sweep(SignatureContext *ctx, unsigned char *PrivateKey, unsigned char *PublicKey, int chunk) {
+	CRYPTO_STATUS Status;
+	SignatureStats sign_stats;
+	struct Signature sig = {0};
+
+	signature_context_set_chunk(ctx, chunk);
+
+	Status = isogeny_sign_ctx(ctx, PrivateKey, PublicKey, &sig, 0, 0);
+	if (Status != CRYPTO_SUCCESS) {
+		return Status;
+	}
+	sign_stats = ctx->stats;
+
+	Status = isogeny_verify_ctx(ctx, PublicKey, &sig, 0, 0);
+	signature_free(&sig);
+	if (Status != CRYPTO_SUCCESS) {
+		return Status;
+	}
+
+	printf("  %3d workers, chunk %2d: sign %4llu claims (%6llu cycles/claim, %d retried rounds), verify %4llu claims (%6llu cycles/claim)\n",
+	       ctx->pool->nworkers, chunk,
+	       sign_stats.claims, sign_stats.claimCycles / (sign_stats.claims ? sign_stats.claims : 1), sign_stats.retries,
+	       ctx->stats.claims, ctx->stats.claimCycles / (ctx->stats.claims ? ctx->stats.claims : 1));
+
+	return Status;
+}
+
+
+// Verifies sig twice on a context of nworkers workers, the second time with the round costs the first one measured,
+// and reports the latency and how many rounds the workers had to steal from each other
+static CRYPTO_STATUS run_verify_schedule(PCurveIsogenyStruct CurveIsogeny, unsigned char *PublicKey, struct Signature *sig, int nworkers) {
+	CRYPTO_STATUS Status = CRYPTO_SUCCESS;
+	SignatureContext *ctx = signature_context_allocate(CurveIsogeny, nworkers);
+	struct timespec t0, t1;
+	int i;
+
+	if (ctx == NULL) {
+		return CRYPTO_ERROR_NO_MEMORY;
+	}
+
+	for (i = 0; i < 2 && Status == CRYPTO_SUCCESS; i++) {
+		clock_gettime(CLOCK_MONOTONIC, &t0);
+		Status = isogeny_verify_ctx(ctx, PublicKey, sig, 0, 0);
+		clock_gettime(CLOCK_MONOTONIC, &t1);
+
+		printf("  %3d workers, %s: verify %9.2f ms, %3llu steals, round cost bit 0 %10llu, bit 1 %10llu cycles\n",
+		       nworkers, (i == 0) ? "estimated" : "measured ", 1000 * elapsed_seconds(&t0, &t1), ctx->stats.steals,
+		       ctx->roundCost[0][0], ctx->roundCost[0][1]);
+	}
+
+	signature_context_free(ctx);
+	return Status;
+}
+
+
+CRYPTO_STATUS cryptorun_signature_pool (int nsigs) {
+	CRYPTO_STATUS Status = CRYPTO_SUCCESS;
+	// Number of bytes in a field element
+	unsigned int pbytes = (CurveIsogeny_SIDHp751.pwordbits + 7)/8;
+	// Number of bytes in an element in [1, order]
+	unsigned int n, obytes = (CurveIsogeny_SIDHp751.owordbits + 7)/8;
+	int rates[3] = {1, 8, 64};
+	int chunks[4] = {1, 2, 4, 8};
+	int workers[3] = {2, 4, 16};
+	int i;
+
+	// Allocate space for keys
+	unsigned char *PrivateKey, *PublicKey;
+	PrivateKey = (unsigned char*)calloc(1, obytes);        // One element in [1, order]
+	PublicKey = (unsigned char*)calloc(1, 4*2*pbytes);     // Four elements in GF(p^2)
+
+	struct Signature sig = {0};
+
+	PCurveIsogenyStruct CurveIsogeny = {0};
+	SignatureContext *ctx = NULL, *wide = NULL;
+
+	CurveIsogeny = SIDH_curve_allocate(&CurveIsogeny_SIDHp751);
+	if (CurveIsogeny == NULL) {
+		Status = CRYPTO_ERROR_NO_MEMORY;
+		goto cleanup;
+	}
+
+	Status = SIDH_curve_initialize(CurveIsogeny, &random_bytes_test, &CurveIsogeny_SIDHp751);
+	if (Status != CRYPTO_SUCCESS) {
+		goto cleanup;
+	}
+
+	ctx = signature_context_allocate(CurveIsogeny, 0);
+	if (ctx == NULL) {
+		Status = CRYPTO_ERROR_NO_MEMORY;
+		goto cleanup;
+	}
+
+	printf("\n  BENCHMARKING PER-CALL THREADS VS WORKER POOL (%d workers, %d signatures per rate)\n", ctx->pool->nworkers, nsigs);
+	printf("  --------------------------------------------------------------------------------\n");
+
+	Status = isogeny_keygen(CurveIsogeny, PrivateKey, PublicKey);
+	if (Status != CRYPTO_SUCCESS) {
+		goto cleanup;
+	}
+
+	for (i = 0; i < 3; i++) {
+		Status = run_paced_signatures(CurveIsogeny, NULL, PrivateKey, PublicKey, rates[i], nsigs);
+		if (Status != CRYPTO_SUCCESS) {
+			goto cleanup;
+		}
+		Status = run_paced_signatures(CurveIsogeny, ctx, PrivateKey, PublicKey, rates[i], nsigs);
+		if (Status != CRYPTO_SUCCESS) {
+			goto cleanup;
+		}
+	}
+
+	// Dispenser contention: one worker per round is the worst case for the shared round counter
+	wide = signature_context_allocate(CurveIsogeny, NUM_ROUNDS);
+	if (wide == NULL) {
+		Status = CRYPTO_ERROR_NO_MEMORY;
+		goto cleanup;
+	}
+
+	printf("\n  ROUND DISPENSER CONTENTION\n");
+	printf("  --------------------------------------------------------------------------------\n");
+	for (i = 0; i < 4; i++) {
+		Status = run_chunk_sweep(ctx, PrivateKey, PublicKey, chunks[i]);
+		if (Status != CRYPTO_SUCCESS) {
+			goto cleanup;
+		}
+		Status = run_chunk_sweep(wide, PrivateKey, PublicKey, chunks[i]);
+		if (Status != CRYPTO_SUCCESS) {
+			goto cleanup;
+		}
+	}
+
+	// Fewer workers than rounds: the round queues are dealt longest first and drained by stealing
+	printf("\n  VERIFY ROUND SCHEDULING\n");
+	printf("  --------------------------------------------------------------------------------\n");
+	Status = isogeny_sign_ctx(ctx, PrivateKey, PublicKey, &sig, 0, 0);
+	if (Status != CRYPTO_SUCCESS) {
+		goto cleanup;
+	}
+	for (i = 0; i < 3; i++) {
+		Status = run_verify_schedule(CurveIsogeny, PublicKey, &sig, workers[i]);
+		if (Status != CRYPTO_SUCCESS) {
+			goto cleanup;
+		}
+	}
+
+cleanup:
+	signature_free(&sig);
+	signature_context_free(wide);
+	signature_context_free(ctx);
+	SIDH_curve_free(CurveIsogeny);
+	free(PrivateKey);
+	free(PublicKey);
+
+	return Status;
+}
+
+
+// Verifies nsigs signatures one call at a time and then all at once with isogeny_verify_batch_ctx
+// Verifies under two signer keys on one context: a key is prepared the first time it is seen and found in the
+// context's cache afterwards, also when it comes back inside a batch
+CRYPTO_STATUS cryptotest_signature_prepared_keys(void) {
+	CRYPTO_STATUS Status = CRYPTO_SUCCESS;
+	// Number of bytes in a field element
+	unsigned int pbytes = (CurveIsogeny_SIDHp751.pwordbits + 7)/8;
+	// Number of bytes in an element in [1, order]
+	unsigned int obytes = (CurveIsogeny_SIDHp751.owordbits + 7)/8;
+	struct timespec t0, t1;
+	double first, second;
+	int i;
+
+	unsigned char *PrivateKey, *PublicKeys[2];
+	PrivateKey = (unsigned char*)calloc(1, obytes);        // One element in [1, order]
+	PublicKeys[0] = (unsigned char*)calloc(1, 4*2*pbytes); // Four elements in GF(p^2)
+	PublicKeys[1] = (unsigned char*)calloc(1, 4*2*pbytes);
+
+	// sigs[0] and sigs[1] under the first key, sigs[2] under the second
+	struct Signature sigs[3] = {0};
+	struct Signature *batch[2] = {&sigs[2], &sigs[0]};
+	unsigned char *keys[2];
+	CRYPTO_STATUS verdicts[2];
+
+	PCurveIsogenyStruct CurveIsogeny = {0};
+	SignatureContext *ctx = NULL;
+
+	printf("\n  TESTING PREPARED PUBLIC KEYS\n");
+	printf("  ---------------------------------------------------------\n");
+
+	CurveIsogeny = SIDH_curve_allocate(&CurveIsogeny_SIDHp751);
+	if (CurveIsogeny == NULL) {
+		Status = CRYPTO_ERROR_NO_MEMORY;
+		goto cleanup;
+	}
+
+	Status = SIDH_curve_initialize(CurveIsogeny, &random_bytes_test, &CurveIsogeny_SIDHp751);
+	if (Status != CRYPTO_SUCCESS) {
+		goto cleanup;
+	}
+
+	ctx = signature_context_allocate(CurveIsogeny, 0);
+	if (ctx == NULL) {
+		Status = CRYPTO_ERROR_NO_MEMORY;
+		goto cleanup;
+	}
+
+	for (i = 0; i < 3; i++) {
+		if (i != 1) {
+			Status = isogeny_keygen(CurveIsogeny, PrivateKey, PublicKeys[i/2]);
+			if (Status != CRYPTO_SUCCESS) {
+				goto cleanup;
+			}
+		}
+		Status = isogeny_sign_ctx(ctx, PrivateKey, PublicKeys[i/2], &sigs[i], 0, 0);
+		if (Status != CRYPTO_SUCCESS) {
+			goto cleanup;
+		}
+	}
+
+	clock_gettime(CLOCK_MONOTONIC, &t0);
+	Status = isogeny_verify_ctx(ctx, PublicKeys[0], &sigs[0], 0, 0);
+	clock_gettime(CLOCK_MONOTONIC, &t1);
+	first = elapsed_seconds(&t0, &t1);
+	if (Status != CRYPTO_SUCCESS || ctx->stats.preparedMisses != 1 || ctx->stats.preparedHits != 0) {
+		Status = (Status != CRYPTO_SUCCESS) ? Status : CRYPTO_ERROR;
+		goto cleanup;
+	}
+
+	clock_gettime(CLOCK_MONOTONIC, &t0);
+	Status = isogeny_verify_ctx(ctx, PublicKeys[0], &sigs[1], 0, 0);
+	clock_gettime(CLOCK_MONOTONIC, &t1);
+	second = elapsed_seconds(&t0, &t1);
+	if (Status != CRYPTO_SUCCESS || ctx->stats.preparedMisses != 0 || ctx->stats.preparedHits != 1) {
+		Status = (Status != CRYPTO_SUCCESS) ? Status : CRYPTO_ERROR;
+		goto cleanup;
+	}
+	printf("  verify, key prepared %9.2f ms, key cached %9.2f ms\n", 1000 * first, 1000 * second);
+
+	// a key must never pass for another one: both signatures are checked against the first key
+	keys[0] = keys[1] = PublicKeys[0];
+	Status = isogeny_verify_batch_ctx(ctx, 2, keys, batch, verdicts, 0, 0);
+	if (Status == CRYPTO_SUCCESS || verdicts[0] == CRYPTO_SUCCESS || verdicts[1] != CRYPTO_SUCCESS || ctx->stats.preparedHits != 2) {
+		Status = CRYPTO_ERROR;
+		goto cleanup;
+	}
+
+	keys[0] = PublicKeys[1];
+	Status = isogeny_verify_batch_ctx(ctx, 2, keys, batch, verdicts, 0, 0);
+	if (Status != CRYPTO_SUCCESS || ctx->stats.preparedMisses != 1 || ctx->stats.preparedHits != 1) {
+		Status = (Status != CRYPTO_SUCCESS) ? Status : CRYPTO_ERROR;
+		goto cleanup;
+	}
+	printf("  PREPARED KEY CACHE ....................... SUCCESSFUL\n");
+
+cleanup:
+	for (i = 0; i < 3; i++) {
+		signature_free(&sigs[i]);
+	}
+	signature_context_free(ctx);
+	SIDH_curve_free(CurveIsogeny);
+	free(PrivateKey);
+	free(PublicKeys[0]);
+	free(PublicKeys[1]);
+
+	return Status;
+}
+
+
+// Signs and verifies with batched inversions on contexts with fewer workers than rounds, then verifies a signature with
+// one corrupted round, whose cancelled rounds leave the batches early; reports the batch sizes achieved
+CRYPTO_STATUS cryptotest_signature_batched_workers(int compressed) {
+	CRYPTO_STATUS Status = CRYPTO_SUCCESS;
+	// Number of bytes in a field element
+	unsigned int pbytes = (CurveIsogeny_SIDHp751.pwordbits + 7)/8;
+	// Number of bytes in an element in [1, order]
+	unsigned int n, obytes = (CurveIsogeny_SIDHp751.owordbits + 7)/8;
+	int workers[3] = {1, 3, 8};
+	int i, r;
+
+	// Allocate space for keys
+	unsigned char *PrivateKey, *PublicKey;
+	PrivateKey = (unsigned char*)calloc(1, obytes);        // One element in [1, order]
+	PublicKey = (unsigned char*)calloc(1, 4*2*pbytes);     // Four elements in GF(p^2)
+
+	struct Signature sig = {0};
+
+	PCurveIsogenyStruct CurveIsogeny = {0};
+	SignatureContext *ctx = NULL;
+
+	CurveIsogeny = SIDH_curve_allocate(&CurveIsogeny_SIDHp751);
+	if (CurveIsogeny == NULL) {
+		Status = CRYPTO_ERROR_NO_MEMORY;
+		goto cleanup;
+	}
+
+	Status = SIDH_curve_initialize(CurveIsogeny, &random_bytes_test, &CurveIsogeny_SIDHp751);
+	if (Status != CRYPTO_SUCCESS) {
+		goto cleanup;
+	}
+
+	Status = isogeny_keygen(CurveIsogeny, PrivateKey, PublicKey);
+	if (Status != CRYPTO_SUCCESS) {
+		goto cleanup;
+	}
+
+	printf("\n  BATCHED INVERSIONS (%s)\n", compressed ? "compressed" : "uncompressed");
+	printf("  --------------------------------------------------------------------------------\n");
+
+	for (i = 0; i < 3; i++) {
+		ctx = signature_context_allocate(CurveIsogeny, workers[i]);
+		if (ctx == NULL) {
+			Status = CRYPTO_ERROR_NO_MEMORY;
+			goto cleanup;
+		}
+
+		Status = isogeny_sign_ctx(ctx, PrivateKey, PublicKey, &sig, 1, compressed);
+		if (Status != CRYPTO_SUCCESS) {
+			goto cleanup;
+		}
+		printf("  %d workers, sign ...... %4llu epochs, %5.2f inversions each, largest %2d, %4llu timeouts\n", workers[i], ctx->stats.invEpochs,
+		       (double)ctx->stats.invElements / (ctx->stats.invEpochs ? ctx->stats.invEpochs : 1), ctx->stats.invMaxBatch, ctx->stats.invTimeouts);
+
+		Status = isogeny_verify_ctx(ctx, PublicKey, &sig, 1, compressed);
+		if (Status != CRYPTO_SUCCESS) {
+			goto cleanup;
+		}
+		printf("  %d workers, verify .... %4llu epochs, %5.2f inversions each, largest %2d, %4llu timeouts\n", workers[i], ctx->stats.invEpochs,
+		       (double)ctx->stats.invElements / (ctx->stats.invEpochs ? ctx->stats.invEpochs : 1), ctx->stats.invMaxBatch, ctx->stats.invTimeouts);
+
+		// the round after the first bit-0 round fails, the rounds of the signature still running are cancelled
+		for (r = 0; r < NUM_ROUNDS && (sig.cHash[r/8] & (1 << (r%8))); r++);
+		sig.Randoms[r][1] ^= 1;
+		Status = isogeny_verify_ctx(ctx, PublicKey, &sig, 1, compressed);
+		sig.Randoms[r][1] ^= 1;
+		if (Status == CRYPTO_SUCCESS) {
+			Status = CRYPTO_ERROR;
+			goto cleanup;
+		}
+		Status = CRYPTO_SUCCESS;
+
+		signature_free(&sig);
+		signature_context_free(ctx);
+		ctx = NULL;
+	}
+
+cleanup:
+	signature_free(&sig);
+	signature_context_free(ctx);
+	SIDH_curve_free(CurveIsogeny);
+	free(PrivateKey);
+	free(PublicKey);
+
+	return Status;
+}
+
+
+CRYPTO_STATUS cryptorun_signature_verify_batch (int nsigs) {
+	CRYPTO_STATUS Status = CRYPTO_SUCCESS;
+	// Number of bytes in a field element
+	unsigned int pbytes = (CurveIsogeny_SIDHp751.pwordbits + 7)/8;
+	// Number of bytes in an element in [1, order]
+	unsigned int n, obytes = (CurveIsogeny_SIDHp751.owordbits + 7)/8;
+	struct timespec t0, t1;
+	double sequential, batch;
+	int i;
+
+	// Allocate space for keys, one signer per signature
+	unsigned char *PrivateKey, **PublicKeys;
+	struct Signature *sigs, **sigp;
+	CRYPTO_STATUS *verdicts;
+	PrivateKey = (unsigned char*)calloc(1, obytes);        // One element in [1, order]
+	PublicKeys = (unsigned char**)calloc(nsigs, sizeof(unsigned char*));
+	sigs = (struct Signature*)calloc(nsigs, sizeof(struct Signature));
+	sigp = (struct Signature**)calloc(nsigs, sizeof(struct Signature*));
+	verdicts = (CRYPTO_STATUS*)calloc(nsigs, sizeof(CRYPTO_STATUS));
+
+	PCurveIsogenyStruct CurveIsogeny = {0};
+	SignatureContext *ctx = NULL;
+
+	CurveIsogeny = SIDH_curve_allocate(&CurveIsogeny_SIDHp751);
+	if (CurveIsogeny == NULL) {
+		Status = CRYPTO_ERROR_NO_MEMORY;
+		goto cleanup;
+	}
+
+	Status = SIDH_curve_initialize(CurveIsogeny, &random_bytes_test, &CurveIsogeny_SIDHp751);
+	if (Status != CRYPTO_SUCCESS) {
+		goto cleanup;
+	}
+
+	ctx = signature_context_allocate(CurveIsogeny, 0);
+	if (ctx == NULL) {
+		Status = CRYPTO_ERROR_NO_MEMORY;
+		goto cleanup;
+	}
+
+	for (i = 0; i < nsigs; i++) {
+		PublicKeys[i] = (unsigned char*)calloc(1, 4*2*pbytes);     // Four elements in GF(p^2)
+		sigp[i] = &sigs[i];
+
+		Status = isogeny_keygen(CurveIsogeny, PrivateKey, PublicKeys[i]);
+		if (Status != CRYPTO_SUCCESS) {
+			goto cleanup;
+		}
+		Status = isogeny_sign_ctx(ctx, PrivateKey, PublicKeys[i], &sigs[i], 0, 0);
+		if (Status != CRYPTO_SUCCESS) {
+			goto cleanup;
+		}
+	}
+
+	printf("\n  BENCHMARKING SEQUENTIAL VS BATCH VERIFICATION (%d signatures, %d workers)\n", nsigs, ctx->pool->nworkers);
+	printf("  --------------------------------------------------------------------------------\n");
+
+	clock_gettime(CLOCK_MONOTONIC, &t0);
+	for (i = 0; i < nsigs; i++) {
+		Status = isogeny_verify_ctx(ctx, PublicKeys[i], &sigs[i], 1, 0);
+		if (Status != CRYPTO_SUCCESS) {
+			goto cleanup;
+		}
+	}
+	clock_gettime(CLOCK_MONOTONIC, &t1);
+	sequential = elapsed_seconds(&t0, &t1);
+
+	clock_gettime(CLOCK_MONOTONIC, &t0);
+	Status = isogeny_verify_batch_ctx(ctx, nsigs, PublicKeys, sigp, verdicts, 1, 0);
+	clock_gettime(CLOCK_MONOTONIC, &t1);
+	batch = elapsed_seconds(&t0, &t1);
+	if (Status != CRYPTO_SUCCESS) {
+		goto cleanup;
+	}
+	for (i = 0; i < nsigs; i++) {
+		if (verdicts[i] != CRYPTO_SUCCESS) {
+			Status = verdicts[i];
+			goto cleanup;
+		}
+	}
+
+	printf("  sequential isogeny_verify ....... %7.3f sig/s\n", nsigs / sequential);
+	printf("  isogeny_verify_batch ............ %7.3f sig/s\n", nsigs / batch);
+
+cleanup:
+	for (i = 0; i < nsigs; i++) {
+		signature_free(&sigs[i]);
+		free(PublicKeys[i]);
+	}
+	signature_context_free(ctx);
+	SIDH_curve_free(CurveIsogeny);
+	free(PrivateKey);
+	free(PublicKeys);
+	free(sigs);
+	free(sigp);
+	free(verdicts);
+
+	return Status;
+}
+
+
+// Signs nsigs times from a commitment pool, letting the pool refill in between, and compares the signing latency
+// against a full isogeny_sign
+CRYPTO_STATUS cryptorun_signature_online (int nsigs) {
+	CRYPTO_STATUS Status = CRYPTO_SUCCESS;
+	// Number of bytes in a field element
+	unsigned int pbytes = (CurveIsogeny_SIDHp751.pwordbits + 7)/8;
+	// Number of bytes in an element in [1, order]
+	unsigned int n, obytes = (CurveIsogeny_SIDHp751.owordbits + 7)/8;
+	struct timespec t0, t1, pause = {0, 100000000};
+	double full, online = 0;
+	int i;
+
+	// Allocate space for keys
+	unsigned char *PrivateKey, *PublicKey;
+	PrivateKey = (unsigned char*)calloc(1, obytes);        // One element in [1, order]
+	PublicKey = (unsigned char*)calloc(1, 4*2*pbytes);     // Four elements in GF(p^2)
+
+	struct Signature sig = {0};
+
+	PCurveIsogenyStruct CurveIsogeny = {0};
+	CommitmentPool *pool = NULL;
+
+	CurveIsogeny = SIDH_curve_allocate(&CurveIsogeny_SIDHp751);
+	if (CurveIsogeny == NULL) {
+		Status = CRYPTO_ERROR_NO_MEMORY;
+		goto cleanup;
+	}
+
+	Status = SIDH_curve_initialize(CurveIsogeny, &random_bytes_test, &CurveIsogeny_SIDHp751);
+	if (Status != CRYPTO_SUCCESS) {
+		goto cleanup;
+	}
+
+	Status = isogeny_keygen(CurveIsogeny, PrivateKey, PublicKey);
+	if (Status != CRYPTO_SUCCESS) {
+		goto cleanup;
+	}
+
+	printf("\n  BENCHMARKING OFFLINE/ONLINE SIGNING (%d signatures)\n", nsigs);
+	printf("  --------------------------------------------------------------------------------\n");
+
+	clock_gettime(CLOCK_MONOTONIC, &t0);
+	Status = isogeny_sign(CurveIsogeny, PrivateKey, PublicKey, &sig, 0, 0);
+	clock_gettime(CLOCK_MONOTONIC, &t1);
+	full = elapsed_seconds(&t0, &t1);
+	signature_free(&sig);
+	if (Status != CRYPTO_SUCCESS) {
+		goto cleanup;
+	}
+
+	pool = commitment_pool_create(CurveIsogeny, PrivateKey, NUM_ROUNDS, 0, 0);
+	if (pool == NULL) {
+		Status = CRYPTO_ERROR_NO_MEMORY;
+		goto cleanup;
+	}
+
+	for (i = 0; i < nsigs; i++) {
+		// idle period between bursts: the pool refills in the background
+		while (commitment_pool_available(pool) < NUM_ROUNDS) {
+			nanosleep(&pause, NULL);
+		}
+
+		clock_gettime(CLOCK_MONOTONIC, &t0);
+		Status = isogeny_sign_online(pool, &sig);
+		clock_gettime(CLOCK_MONOTONIC, &t1);
+		online += elapsed_seconds(&t0, &t1);
+		if (Status != CRYPTO_SUCCESS) {
+			goto cleanup;
+		}
+
+		Status = isogeny_verify(CurveIsogeny, PublicKey, &sig, 0, 0);
+		signature_free(&sig);
+		if (Status != CRYPTO_SUCCESS) {
+			goto cleanup;
+		}
+	}
+
+	printf("  isogeny_sign ................... %10.2f ms\n", 1000 * full);
+	printf("  isogeny_sign_online ............ %10.2f ms (pool of %d rounds, %d refill threads)\n", 1000 * online / nsigs, pool->capacity, pool->nthreads);
+
+cleanup:
+	commitment_pool_free(pool);
+	signature_free(&sig);
+	SIDH_curve_free(CurveIsogeny);
+	free(PrivateKey);
+	free(PublicKey);
+
+	return Status;
+}
+
+
+// Hashes/second of the response hash for each keccak variant the processor supports, at the two response
+// lengths of p751 (a 48-byte random or compressed psi(S), a 384-byte projective psi(S)). Also checks that
+// every multi-buffer variant gives the same hashes as keccak()
+CRYPTO_STATUS cryptorun_keccak (int nhashes) {
+	static const char *names[] = {"keccak (scalar)", "keccak_x4 (AVX2)", "keccak_x8 (AVX-512)"};
+	int lengths[] = {48, sizeof(point_proj)};
+	uint8_t in[8][sizeof(point_proj)], md[8][HASH_LENGTH], ref[HASH_LENGTH];
+	const uint8_t *inp[8];
+	uint8_t *mdp[8];
+	struct timespec t0, t1;
+	int best = keccak_simd_level(), level, l, i, k;
+	CRYPTO_STATUS Status = CRYPTO_SUCCESS;
+
+	random_bytes_test(sizeof(in), (unsigned char*) in);
+	for (k = 0; k < 8; k++) {
+		inp[k] = in[k];
+		mdp[k] = md[k];
+	}
+
+	printf("\n  BENCHMARKING MULTI-BUFFER KECCAK (%d hashes per variant)\n", nhashes);
+	printf("  --------------------------------------------------------------------------------\n");
+
+	for (level = KECCAK_SIMD_NONE; level <= best; level++) {
+		keccak_set_simd_level(level);
+		for (l = 0; l < 2; l++) {
+			clock_gettime(CLOCK_MONOTONIC, &t0);
+			if (level == KECCAK_SIMD_NONE) {
+				for (i = 0; i < nhashes; i++) {
+					keccak(in[i & 7], lengths[l], md[i & 7], HASH_LENGTH);
+				}
+			} else if (level == KECCAK_SIMD_AVX2) {
+				for (i = 0; i < nhashes; i += 4) {
+					keccak_x4(inp, lengths[l], mdp, HASH_LENGTH);
+				}
+			} else {
+				for (i = 0; i < nhashes; i += 8) {
+					keccak_x8(inp, lengths[l], mdp, HASH_LENGTH);
+				}
+			}
+			clock_gettime(CLOCK_MONOTONIC, &t1);
+			printf("  %-20s %3d bytes ...... %12.0f hashes/s\n", names[level], lengths[l], i / elapsed_seconds(&t0, &t1));
+
+			if (level != KECCAK_SIMD_NONE) {
+				for (k = 0; k < ((level == KECCAK_SIMD_AVX2) ? 4 : 8); k++) {
+					keccak(in[k], lengths[l], ref, HASH_LENGTH);
+					if (memcmp(ref, md[k], HASH_LENGTH) != 0) {
+						Status = CRYPTO_ERROR;
+					}
+				}
+			}
+		}
+	}
+	keccak_set_simd_level(KECCAK_SIMD_AVX512);
+
+	return Status;
+}
+
+
+// Resident set size of the process in kilobytes, or -1 if it cannot be read
+static long resident_kbytes(void) {
+	long pages = -1, resident = -1;
+	FILE *statm = fopen("/proc/self/statm", "r");
+
+	if (statm == NULL) {
+		return -1;
+	}
+	if (fscanf(statm, "%ld %ld", &pages, &resident) != 2) {
+		resident = -1;
+	}
+	fclose(statm);
+
+	return (resident < 0) ? -1 : resident * (sysconf(_SC_PAGESIZE) / 1024);
+}
+
+
+// Runs nsigs sign/verify cycles on one context and reports the resident set size as it goes;
+// with signatures released by signature_free it should stay flat after the first cycle
+CRYPTO_STATUS cryptorun_signature_memory (int nsigs) {
+	CRYPTO_STATUS Status = CRYPTO_SUCCESS;
+	// Number of bytes in a field element
+	unsigned int pbytes = (CurveIsogeny_SIDHp751.pwordbits + 7)/8;
+	// Number of bytes in an element in [1, order]
+	unsigned int n, obytes = (CurveIsogeny_SIDHp751.owordbits + 7)/8;
+	int i, step = (nsigs >= 10) ? nsigs/10 : 1;
+	long first = 0, rss;
+
+	// Allocate space for keys
+	unsigned char *PrivateKey, *PublicKey;
+	PrivateKey = (unsigned char*)calloc(1, obytes);        // One element in [1, order]
+	PublicKey = (unsigned char*)calloc(1, 4*2*pbytes);     // Four elements in GF(p^2)
+
+	struct Signature sig = {0};
+
+	PCurveIsogenyStruct CurveIsogeny = {0};
+	SignatureContext *ctx = NULL;
+
+	CurveIsogeny = SIDH_curve_allocate(&CurveIsogeny_SIDHp751);
+	if (CurveIsogeny == NULL) {
+		Status = CRYPTO_ERROR_NO_MEMORY;
+		goto cleanup;
+	}
+
+	Status = SIDH_curve_initialize(CurveIsogeny, &random_bytes_test, &CurveIsogeny_SIDHp751);
+	if (Status != CRYPTO_SUCCESS) {
+		goto cleanup;
+	}
+
+	ctx = signature_context_allocate(CurveIsogeny, 0);
+	if (ctx == NULL) {
+		Status = CRYPTO_ERROR_NO_MEMORY;
+		goto cleanup;
+	}
+
+	Status = isogeny_keygen(CurveIsogeny, PrivateKey, PublicKey);
+	if (Status != CRYPTO_SUCCESS) {
+		goto cleanup;
+	}
+
+	printf("\n  RESIDENT MEMORY OVER %d SIGN/VERIFY CYCLES\n", nsigs);
+	printf("  --------------------------------------------------------------------------------\n");
+	printf("  before first cycle ....... %8ld KB\n", resident_kbytes());
+
+	for (i = 1; i <= nsigs; i++) {
+		Status = isogeny_sign_ctx(ctx, PrivateKey, PublicKey, &sig, 0, 0);
+		if (Status == CRYPTO_SUCCESS) {
+			Status = isogeny_verify_ctx(ctx, PublicKey, &sig, 0, 0);
+		}
+		signature_free(&sig);
+		if (Status != CRYPTO_SUCCESS) {
+			goto cleanup;
+		}
+
+		if (i == 1 || i % step == 0) {
+			rss = resident_kbytes();
+			if (i == 1) {
+				first = rss;
+			}
+			printf("  after %6d cycles ....... %8ld KB (%+ld KB since the first cycle)\n", i, rss, rss - first);
+		}
+	}
+
+cleanup:
+	signature_context_free(ctx);
+	SIDH_curve_free(CurveIsogeny);
+	free(PrivateKey);
+	free(PublicKey);
+
+	return Status;
+}
+
+
+int main (int argc, char** argv) {
+	srand(2);
+	CRYPTO_STATUS Status = CRYPTO_SUCCESS;
+
+  int vanilla_rounds = atoi(argv[1]);
+  int batched_rounds = atoi(argv[2]);
+  int compressed_rounds = atoi(argv[3]);
+  int CB_rounds = atoi(argv[4]);
+  int pool_sigs = (argc > 5) ? atoi(argv[5]) : 0;
+  int concurrent_signers = (argc > 6) ? atoi(argv[6]) : 0;
+  int memory_sigs = (argc > 7) ? atoi(argv[7]) : 0;
+  int wire_rounds = (argc > 8) ? atoi(argv[8]) : 0;
+  int batch_sigs = (argc > 9) ? atoi(argv[9]) : 0;
+  int online_sigs = (argc > 10) ? atoi(argv[10]) : 0;
+  int keccak_hashes = (argc > 11) ? atoi(argv[11]) : 0;
+  int abort_rounds = (argc > 12) ? atoi(argv[12]) : 0;
+  int prepared_rounds = (argc > 13) ? atoi(argv[13]) : 0;
+  int batcher_rounds = (argc > 14) ? atoi(argv[14]) : 0;
+  int retry_rounds = (argc > 15) ? atoi(argv[15]) : 0;
 
 	//signature tests --------------------------------------------------------------
 	/*Status = cryptotest_signature(current_keygen_cycles, current_sign_cycles, current_verify_cycles);
@@ -708,6 +1899,115 @@ int main (int argc, char** argv) {
     }
   }
 
+  //per-call threads vs worker pool benchmark ------------------------------------
+  if (pool_sigs > 0) {
+    Status = cryptorun_signature_pool(pool_sigs);
+    if (Status != CRYPTO_SUCCESS) {
+      printf("\n\n   Error detected: %s \n\n", SIDH_get_error_message(Status));
+    }
+  }
+
+  //independent contexts signing and verifying concurrently ---------------------
+  if (concurrent_signers > 0) {
+    Status = cryptotest_signature_concurrent(concurrent_signers);
+    if (Status != CRYPTO_SUCCESS) {
+      printf("\n\n   Error detected: %s \n\n", SIDH_get_error_message(Status));
+    } else {
+      printf("\n  CONCURRENT SIGNATURE CONTEXTS RUN SUCCESSFUL\n\n");
+    }
+  }
+
+  //resident memory across repeated sign/verify cycles (e.g. 10000) ------------
+  if (memory_sigs > 0) {
+    Status = cryptorun_signature_memory(memory_sigs);
+    if (Status != CRYPTO_SUCCESS) {
+      printf("\n\n   Error detected: %s \n\n", SIDH_get_error_message(Status));
+    }
+  }
+
+  //serialized signatures, uncompressed and compressed ---------------------------
+  for (int i = 1; i <= wire_rounds; i++) {
+    Status = cryptotest_signature_wire(0);
+    if (Status == CRYPTO_SUCCESS) {
+      Status = cryptotest_signature_wire(1);
+    }
+    if (Status != CRYPTO_SUCCESS) {
+      printf("\n\n   Error detected: %s \n\n", SIDH_get_error_message(Status));
+    } else {
+      printf("\n  SERIALIZED SIGNATURE RUN SUCCESSFUL\n\n");
+    }
+  }
+
+  //verification of many signatures in one batch --------------------------------
+  if (batch_sigs > 0) {
+    Status = cryptorun_signature_verify_batch(batch_sigs);
+    if (Status != CRYPTO_SUCCESS) {
+      printf("\n\n   Error detected: %s \n\n", SIDH_get_error_message(Status));
+    }
+  }
+
+  //signing from a pool of precomputed rounds ----------------------------------
+  if (online_sigs > 0) {
+    Status = cryptorun_signature_online(online_sigs);
+    if (Status != CRYPTO_SUCCESS) {
+      printf("\n\n   Error detected: %s \n\n", SIDH_get_error_message(Status));
+    }
+  }
+
+  //multi-buffer keccak throughput -----------------------------------------------
+  if (keccak_hashes > 0) {
+    Status = cryptorun_keccak(keccak_hashes);
+    if (Status != CRYPTO_SUCCESS) {
+      printf("\n\n   Error detected: %s \n\n", SIDH_get_error_message(Status));
+    }
+  }
+
+  //rejection of a signature with one corrupted round ----------------------------
+  for (int i = 1; i <= abort_rounds; i++) {
+    Status = cryptotest_signature_early_abort(0);
+    if (Status == CRYPTO_SUCCESS) {
+      Status = cryptotest_signature_early_abort(1);
+    }
+    if (Status != CRYPTO_SUCCESS) {
+      printf("\n\n   Error detected: %s \n\n", SIDH_get_error_message(Status));
+    } else {
+      printf("\n  EARLY ABORT RUN SUCCESSFUL\n\n");
+    }
+  }
+
+  //verification under prepared, cached public keys ---------------------------
+  for (int i = 1; i <= prepared_rounds; i++) {
+    Status = cryptotest_signature_prepared_keys();
+    if (Status != CRYPTO_SUCCESS) {
+      printf("\n\n   Error detected: %s \n\n", SIDH_get_error_message(Status));
+    } else {
+      printf("\n  PREPARED PUBLIC KEY RUN SUCCESSFUL\n\n");
+    }
+  }
+
+  //batched inversions with fewer workers than rounds -----------------------------
+  for (int i = 1; i <= batcher_rounds; i++) {
+    Status = cryptotest_signature_batched_workers(0);
+    if (Status == CRYPTO_SUCCESS) {
+      Status = cryptotest_signature_batched_workers(1);
+    }
+    if (Status != CRYPTO_SUCCESS) {
+      printf("\n\n   Error detected: %s \n\n", SIDH_get_error_message(Status));
+    } else {
+      printf("\n  BATCHED INVERSION RUN SUCCESSFUL\n\n");
+    }
+  }
+
+  //signing rounds redone after a failure --------------------------------------
+  for (int i = 1; i <= retry_rounds; i++) {
+    Status = cryptotest_signature_retries();
+    if (Status != CRYPTO_SUCCESS) {
+      printf("\n\n   Error detected: %s \n\n", SIDH_get_error_message(Status));
+    } else {
+      printf("\n  SIGNING RETRY RUN SUCCESSFUL\n\n");
+    }
+  }
+
 cleanup:
 
 	return 0;
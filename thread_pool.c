@@ -0,0 +1,155 @@
+/********************************************************************************************
+* SIDH: an efficient supersingular isogeny-based cryptography library for ephemeral
+*       Diffie-Hellman key exchange.
+*
+*    Copyright (c) Microsoft Corporation. All rights reserved.
+*
+*
+* Abstract: persistent worker pool used to run signature rounds
+*
+*********************************************************************************************/
+
+#include "thread_pool.h"
+#include <stdlib.h>
+#include <unistd.h>
+
+
+int pool_default_size(void)
+{ // Number of online cores, at least one
+	long ncores = sysconf(_SC_NPROCESSORS_ONLN);
+
+	if (ncores < 1) {
+		return 1;
+	}
+	return (int)ncores;
+}
+
+
+static void *pool_worker(void *arg)
+{ // Worker loop: sleep until a new generation is published, run the job if this worker takes part, report back
+	worker_pool *pool = (worker_pool*)arg;
+	unsigned long seen = 0;    // a job published before this worker got scheduled must still be picked up
+	int index;
+
+	pthread_mutex_lock(&pool->lock);
+	index = pool->nstarted++;
+
+	while (1) {
+		while (!pool->shutdown && pool->generation == seen) {
+			pthread_cond_wait(&pool->start_cond, &pool->lock);
+		}
+		if (pool->shutdown) {
+			break;
+		}
+		seen = pool->generation;
+
+		if (index < pool->nactive) {
+			pool_job job = pool->job;
+			void *job_arg = pool->arg;
+
+			pthread_mutex_unlock(&pool->lock);
+			job(job_arg);
+			pthread_mutex_lock(&pool->lock);
+
+			pool->running--;
+			if (pool->running == 0) {
+				pthread_cond_signal(&pool->done_cond);
+			}
+		}
+	}
+	pthread_mutex_unlock(&pool->lock);
+
+	return NULL;
+}
+
+
+worker_pool* pool_create(int nworkers)
+{ // Create a pool of nworkers threads (nworkers <= 0 selects pool_default_size())
+	worker_pool *pool;
+	int t;
+
+	if (nworkers <= 0) {
+		nworkers = pool_default_size();
+	}
+
+	pool = (worker_pool*)calloc(1, sizeof(worker_pool));
+	if (pool == NULL) {
+		return NULL;
+	}
+	pool->threads = (pthread_t*)calloc(nworkers, sizeof(pthread_t));
+	if (pool->threads == NULL) {
+		free(pool);
+		return NULL;
+	}
+
+	pthread_mutex_init(&pool->lock, NULL);
+	pthread_mutex_init(&pool->run_lock, NULL);
+	pthread_cond_init(&pool->start_cond, NULL);
+	pthread_cond_init(&pool->done_cond, NULL);
+
+	for (t = 0; t < nworkers; t++) {
+		if (pthread_create(&pool->threads[t], NULL, pool_worker, pool)) {
+			break;
+		}
+	}
+	pool->nworkers = t;
+
+	if (pool->nworkers == 0) {
+		pool_free(pool);
+		return NULL;
+	}
+
+	return pool;
+}
+
+
+void pool_run(worker_pool *pool, pool_job job, void *arg, int nactive)
+{ // Run job(arg) on the first nactive workers of the pool and wait until all of them return
+	if (nactive > pool->nworkers) {
+		nactive = pool->nworkers;
+	}
+	if (nactive <= 0) {
+		return;
+	}
+
+	pthread_mutex_lock(&pool->run_lock);
+	pthread_mutex_lock(&pool->lock);
+	pool->job = job;
+	pool->arg = arg;
+	pool->nactive = nactive;
+	pool->running = nactive;
+	pool->generation++;
+	pthread_cond_broadcast(&pool->start_cond);
+
+	while (pool->running > 0) {
+		pthread_cond_wait(&pool->done_cond, &pool->lock);
+	}
+	pthread_mutex_unlock(&pool->lock);
+	pthread_mutex_unlock(&pool->run_lock);
+}
+
+
+void pool_free(worker_pool *pool)
+{ // Stop and join all workers, then release the pool
+	int t;
+
+	if (pool == NULL) {
+		return;
+	}
+
+	pthread_mutex_lock(&pool->lock);
+	pool->shutdown = 1;
+	pthread_cond_broadcast(&pool->start_cond);
+	pthread_mutex_unlock(&pool->lock);
+
+	for (t = 0; t < pool->nworkers; t++) {
+		pthread_join(pool->threads[t], NULL);
+	}
+
+	pthread_cond_destroy(&pool->start_cond);
+	pthread_cond_destroy(&pool->done_cond);
+	pthread_mutex_destroy(&pool->run_lock);
+	pthread_mutex_destroy(&pool->lock);
+	free(pool->threads);
+	free(pool);
+}
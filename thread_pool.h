@@ -0,0 +1,63 @@
+/********************************************************************************************
+* SIDH: an efficient supersingular isogeny-based cryptography library for ephemeral
+*       Diffie-Hellman key exchange.
+*
+*    Copyright (c) Microsoft Corporation. All rights reserved.
+*
+*
+* Abstract: persistent worker pool used to run signature rounds
+*
+*********************************************************************************************/
+
+#ifndef __THREAD_POOL_H__
+#define __THREAD_POOL_H__
+
+
+// For C++
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <pthread.h>
+
+
+// Work function run by each participating worker, same signature as a pthread start routine
+typedef void *(*pool_job)(void *arg);
+
+// Long-lived pool of worker threads. Only one job runs on a pool at any time.
+typedef struct worker_pool {
+	int nworkers;                 // number of worker threads owned by the pool
+	pthread_t *threads;
+	pthread_mutex_t lock;
+	pthread_cond_t start_cond;    // signalled when a new job is published
+	pthread_cond_t done_cond;     // signalled when the last participant finishes a job
+	pthread_mutex_t run_lock;     // serializes callers of pool_run
+	pool_job job;
+	void *arg;
+	int nactive;                  // number of workers taking part in the current job
+	int running;                  // participants still busy with the current job
+	int nstarted;                 // used by workers to claim their index at startup
+	unsigned long generation;     // bumped each time a job is published
+	int shutdown;
+} worker_pool;
+
+
+// Number of online cores, used as the default pool size
+int pool_default_size(void);
+
+// Create a pool of nworkers threads (nworkers <= 0 selects pool_default_size()). Returns NULL on error.
+worker_pool* pool_create(int nworkers);
+
+// Run job(arg) on the first nactive workers of the pool and wait until all of them return
+void pool_run(worker_pool *pool, pool_job job, void *arg, int nactive);
+
+// Stop and join all workers, then release the pool
+void pool_free(worker_pool *pool);
+
+
+#ifdef __cplusplus
+}
+#endif
+
+
+#endif